@@ -0,0 +1,58 @@
+#include "ai.h"
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <sstream>
+
+std::optional<AIMove> requestAIMoveFromChatGPT(const Game& game) {
+    const char* apiKey = std::getenv("OPENAI_API_KEY");
+    if (!apiKey) return std::nullopt;
+
+    std::string boardState = boardToSimpleString(game);
+    std::string cmd = "python3 chatgpt_move.py \"" + boardState + "\"";
+    FILE* pipe = popen(cmd.c_str(), "r");
+    if (!pipe) return std::nullopt;
+    char buffer[128];
+    std::string result;
+    while (fgets(buffer, sizeof(buffer), pipe)) {
+        result += buffer;
+    }
+    pclose(pipe);
+    std::istringstream iss(result);
+    AIMove m;
+    if (iss >> m.sr >> m.sc >> m.er >> m.ec) {
+        m.score = 0;
+        return m;
+    }
+    return std::nullopt;
+}
+
+std::optional<AIMove> chooseGreedyMove(Game& game) {
+    auto moves = generateLegalMoves(game, game.isWhiteTurn);
+    if (moves.empty()) return std::nullopt;
+
+    int bestScore = 0;
+    for (const auto& m : moves) {
+        if (m.score > bestScore) bestScore = m.score;
+    }
+    std::vector<AIMove> candidates;
+    for (const auto& m : moves) {
+        if (m.score == bestScore) candidates.push_back(m);
+    }
+    std::random_device rd;
+    std::mt19937 gen(rd());
+    std::uniform_int_distribution<> dist(0, candidates.size() - 1);
+    return candidates[dist(gen)];
+}
+
+void aiMove(Game& game) {
+    if (game.isWhiteTurn) return;
+
+    if (auto move = requestAIMoveFromChatGPT(game)) {
+        if (applyMove(game, *move)) return;
+    }
+
+    if (auto move = chooseGreedyMove(game)) {
+        applyMove(game, *move);
+    }
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+#include "game.h"
+#include <optional>
+
+// Asks chatgpt_move.py for a move. Needs OPENAI_API_KEY to be set.
+std::optional<AIMove> requestAIMoveFromChatGPT(const Game& game);
+// Picks one of the side to move's highest-scoring captures (or any move) at random
+std::optional<AIMove> chooseGreedyMove(Game& game);
+// Plays black's move, preferring ChatGPT and falling back to the greedy pick
+void aiMove(Game& game);
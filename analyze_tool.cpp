@@ -0,0 +1,366 @@
+// Batch analysis of FEN positions, one per line, from a file or stdin ("-").
+// Every line gets one output line, in input order:
+//
+//   <fen> TAB <best move> TAB <score> TAB <depth> TAB <nodes>
+//
+// The score is in centipawns for the side to move, or "#n" for a mate. Lines
+// that are not a legal position come out as "<fen> TAB error TAB <reason>" and
+// empty lines are skipped. The best move is "-" when there is none.
+//
+// The reader deals positions round robin onto per-worker queues; a worker that
+// runs dry steals from the back of another's queue. All workers share one
+// transposition table. Finished results wait in a reorder buffer until every
+// earlier line is written. When writing to a file, the number of lines done
+// and the output size are saved to FILE.checkpoint (or --checkpoint) every few
+// seconds and on SIGINT/SIGTERM, and --resume picks the run up from there.
+// --stats-log appends the hot-path counters to FILE as a JSON line every
+// second (all zero unless built with -DCHESS_STATS=ON).
+//
+// --shared-hash NAME puts the table in the POSIX shared-memory segment NAME,
+// so analyses running side by side on one host reuse each other's work.
+// The first process to create it sets its size from --hash.
+//
+// Usage: chess_analyze [--threads N] [--depth N] [--nodes N] [--hash MB] [--shared-hash NAME]
+//                      [--output FILE] [--checkpoint FILE] [--resume] [--quiet] [--stats-log FILE]
+//                      [input.fen|-]
+#include "search.h"
+#include "stats.h"
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+static std::atomic<bool> interrupted{false};
+
+static void onSignal(int) {
+    interrupted = true;
+}
+
+struct Job {
+    uint64_t line;
+    std::string fen;
+};
+
+struct alignas(64) WorkQueue {
+    std::mutex mutex;
+    std::deque<Job> jobs;
+};
+
+struct Checkpoint {
+    std::string input;
+    uint64_t lines = 0;  // input lines fully written
+    uint64_t bytes = 0;  // output size at that point
+};
+
+static bool readCheckpoint(const std::string& path, Checkpoint& checkpoint) {
+    std::ifstream in(path);
+    if (!in) return false;
+    std::string key;
+    while (in >> key) {
+        if (key == "input") in >> checkpoint.input;
+        else if (key == "lines") in >> checkpoint.lines;
+        else if (key == "bytes") in >> checkpoint.bytes;
+    }
+    return true;
+}
+
+// Written to a temporary file and renamed, so a crash leaves either the old
+// checkpoint or the new one
+static bool writeCheckpoint(const std::string& path, const Checkpoint& checkpoint) {
+    std::string temp = path + ".tmp";
+    FILE* file = fopen(temp.c_str(), "w");
+    if (!file) return false;
+    std::fprintf(file, "input %s\nlines %llu\nbytes %llu\n", checkpoint.input.c_str(),
+                 static_cast<unsigned long long>(checkpoint.lines),
+                 static_cast<unsigned long long>(checkpoint.bytes));
+    bool ok = fflush(file) == 0 && fsync(fileno(file)) == 0;
+    ok = fclose(file) == 0 && ok;
+    return ok && std::rename(temp.c_str(), path.c_str()) == 0;
+}
+
+static std::string analyzeLine(SearchContext& context, const std::string& fen, const SearchLimits& limits) {
+    Game game;
+    std::string error;
+    if (!loadFen(game, fen, error)) return fen + "\terror\t" + error + "\n";
+    SearchResult result = searchPosition(context, game, limits);
+    std::string move = result.bestMove ? packedMoveToString(result.bestMove) : "-";
+    return fen + "\t" + move + "\t" + scoreToString(result.score) + "\t" + std::to_string(result.depth) + "\t" +
+           std::to_string(result.nodes) + "\n";
+}
+
+static void usage() {
+    std::cerr << "Usage: chess_analyze [--threads N] [--depth N] [--nodes N] [--hash MB] [--shared-hash NAME]\n"
+                 "                     [--output FILE] [--checkpoint FILE] [--resume] [--quiet] [--stats-log FILE]\n"
+                 "                     [input.fen|-]\n";
+}
+
+int main(int argc, char* argv[]) {
+    unsigned threadCount = std::thread::hardware_concurrency();
+    SearchLimits limits;
+    limits.abort = [] { return interrupted.load(std::memory_order_relaxed); };
+    std::size_t hashMb = 64;
+    std::string inputPath = "-";
+    std::string outputPath;
+    std::string checkpointPath;
+    std::string statsPath;
+    std::string sharedHash;
+    bool resume = false;
+    bool quiet = false;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--threads" && i + 1 < argc) {
+            threadCount = static_cast<unsigned>(std::atoi(argv[++i]));
+        } else if (arg == "--depth" && i + 1 < argc) {
+            limits.depth = std::atoi(argv[++i]);
+        } else if (arg == "--nodes" && i + 1 < argc) {
+            limits.nodes = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--hash" && i + 1 < argc) {
+            hashMb = static_cast<std::size_t>(std::atoi(argv[++i]));
+        } else if (arg == "--shared-hash" && i + 1 < argc) {
+            sharedHash = argv[++i];
+        } else if (arg == "--output" && i + 1 < argc) {
+            outputPath = argv[++i];
+        } else if (arg == "--checkpoint" && i + 1 < argc) {
+            checkpointPath = argv[++i];
+        } else if (arg == "--resume") {
+            resume = true;
+        } else if (arg == "--quiet") {
+            quiet = true;
+        } else if (arg == "--stats-log" && i + 1 < argc) {
+            statsPath = argv[++i];
+        } else if (arg != "-" && !arg.empty() && arg[0] == '-') {
+            usage();
+            return 1;
+        } else {
+            inputPath = arg;
+        }
+    }
+    if (threadCount == 0) threadCount = 1;
+    if (hashMb == 0) hashMb = 1;
+    if (outputPath.empty() && (resume || !checkpointPath.empty())) {
+        std::cerr << "checkpoints need --output\n";
+        return 1;
+    }
+    if (checkpointPath.empty() && !outputPath.empty()) checkpointPath = outputPath + ".checkpoint";
+    std::unique_ptr<StatsDump> statsDump;
+    if (!statsPath.empty()) {
+        statsDump.reset(new StatsDump(statsPath));
+        if (!statsDump->ok()) {
+            std::cerr << statsPath << ": " << std::strerror(errno) << "\n";
+            return 1;
+        }
+    }
+
+    Checkpoint done;
+    done.input = inputPath;
+    if (resume && readCheckpoint(checkpointPath, done)) {
+        if (done.input != inputPath) {
+            std::cerr << checkpointPath << ": checkpoint is for " << done.input << ", not " << inputPath << "\n";
+            return 1;
+        }
+        // Drop anything written after the checkpoint; those lines are redone
+        if (truncate(outputPath.c_str(), static_cast<off_t>(done.bytes)) != 0) {
+            std::cerr << outputPath << ": " << std::strerror(errno) << "\n";
+            return 1;
+        }
+        if (!quiet) std::cerr << "resuming after line " << done.lines << "\n";
+    } else {
+        done = Checkpoint{};
+        done.input = inputPath;
+    }
+
+    std::ifstream inputFile;
+    std::istream* input = &std::cin;
+    if (inputPath != "-") {
+        inputFile.open(inputPath);
+        if (!inputFile) {
+            std::cerr << inputPath << ": " << std::strerror(errno) << "\n";
+            return 1;
+        }
+        input = &inputFile;
+    }
+    FILE* output = stdout;
+    if (!outputPath.empty()) {
+        output = fopen(outputPath.c_str(), done.lines > 0 ? "ab" : "wb");
+        if (!output) {
+            std::cerr << outputPath << ": " << std::strerror(errno) << "\n";
+            return 1;
+        }
+    }
+    setvbuf(output, nullptr, _IOFBF, 1 << 16);
+    std::signal(SIGINT, onSignal);
+    std::signal(SIGTERM, onSignal);
+
+    TranspositionTable tt(hashMb);
+    std::string error;
+    if (!sharedHash.empty() && !tt.openShared(sharedHash, hashMb, error)) {
+        std::cerr << error << "\n";
+        return 1;
+    }
+    std::vector<WorkQueue> queues(threadCount);
+    std::atomic<long> queued{0};
+    bool inputDone = false;
+    std::mutex idleMutex;
+    std::condition_variable workReady;
+
+    // Reorder buffer: slot line % window holds a finished line until every
+    // earlier line has been written. The reader stays within one window of
+    // the oldest unwritten line.
+    const uint64_t window = threadCount * 256;
+    std::vector<std::string> pending(window);
+    std::vector<bool> ready(window, false);
+    std::mutex outputMutex;
+    std::condition_variable spaceFree;
+    uint64_t nextToWrite = done.lines;
+    uint64_t bytesWritten = done.bytes;
+    auto lastCheckpoint = std::chrono::steady_clock::now();
+    auto start = lastCheckpoint;
+    uint64_t startLine = done.lines;
+
+    auto saveCheckpoint = [&]() {
+        // Called with outputMutex held
+        fflush(output);
+        fsync(fileno(output));
+        Checkpoint c{inputPath, nextToWrite, bytesWritten};
+        if (!writeCheckpoint(checkpointPath, c)) {
+            std::cerr << checkpointPath << ": could not write checkpoint\n";
+        }
+    };
+
+    auto finish = [&](uint64_t line, std::string text) {
+        std::lock_guard<std::mutex> lock(outputMutex);
+        pending[line % window] = std::move(text);
+        ready[line % window] = true;
+        bool advanced = false;
+        while (ready[nextToWrite % window]) {
+            std::string& out = pending[nextToWrite % window];
+            fwrite(out.data(), 1, out.size(), output);
+            bytesWritten += out.size();
+            out.clear();
+            ready[nextToWrite % window] = false;
+            ++nextToWrite;
+            advanced = true;
+        }
+        if (!advanced) return;
+        spaceFree.notify_one();
+        auto now = std::chrono::steady_clock::now();
+        if (now - lastCheckpoint >= std::chrono::seconds(5)) {
+            lastCheckpoint = now;
+            if (!checkpointPath.empty()) saveCheckpoint();
+            if (!quiet) {
+                double seconds = std::chrono::duration<double>(now - start).count();
+                std::fprintf(stderr, "%llu lines, %.1f positions/sec\n",
+                             static_cast<unsigned long long>(nextToWrite), (nextToWrite - startLine) / seconds);
+            }
+        }
+    };
+
+    auto takeJob = [&](unsigned self, Job& job) {
+        // Own queue from the front, other queues from the back
+        for (unsigned i = 0; i < threadCount; ++i) {
+            WorkQueue& q = queues[(self + i) % threadCount];
+            std::lock_guard<std::mutex> lock(q.mutex);
+            if (q.jobs.empty()) continue;
+            if (i == 0) {
+                job = std::move(q.jobs.front());
+                q.jobs.pop_front();
+            } else {
+                job = std::move(q.jobs.back());
+                q.jobs.pop_back();
+            }
+            --queued;
+            return true;
+        }
+        return false;
+    };
+
+    std::vector<std::thread> workers;
+    for (unsigned t = 0; t < threadCount; ++t) {
+        workers.emplace_back([&, t] {
+            SearchContext context;
+            context.tt = &tt;
+            Job job;
+            for (;;) {
+                // Queued lines are dropped on a signal; the checkpoint covers
+                // only what was written
+                if (interrupted) return;
+                if (takeJob(t, job)) {
+                    std::string text = job.fen.empty() ? "" : analyzeLine(context, job.fen, limits);
+                    if (interrupted) return; // the search was cut short
+                    finish(job.line, std::move(text));
+                    continue;
+                }
+                std::unique_lock<std::mutex> lock(idleMutex);
+                if (inputDone && queued == 0) return;
+                workReady.wait(lock, [&] { return queued > 0 || inputDone; });
+            }
+        });
+    }
+
+    uint64_t line = 0;
+    std::string text;
+    while (!interrupted && std::getline(*input, text)) {
+        uint64_t current = line++;
+        if (current < done.lines) continue;
+        // Trim, and treat comment lines like empty ones
+        std::size_t first = text.find_first_not_of(" \t\r");
+        std::size_t last = text.find_last_not_of(" \t\r");
+        std::string fen = first == std::string::npos || text[first] == '#' ? "" : text.substr(first, last - first + 1);
+        {
+            std::unique_lock<std::mutex> lock(outputMutex);
+            while (!spaceFree.wait_for(lock, std::chrono::milliseconds(100),
+                                       [&] { return current < nextToWrite + window; })) {
+                if (interrupted) break;
+            }
+        }
+        if (interrupted) break;
+        {
+            WorkQueue& q = queues[current % threadCount];
+            std::lock_guard<std::mutex> lock(q.mutex);
+            q.jobs.push_back({current, std::move(fen)});
+        }
+        ++queued;
+        std::lock_guard<std::mutex> lock(idleMutex);
+        workReady.notify_one();
+    }
+    {
+        std::lock_guard<std::mutex> lock(idleMutex);
+        inputDone = true;
+    }
+    workReady.notify_all();
+    for (auto& w : workers) w.join();
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    {
+        std::lock_guard<std::mutex> lock(outputMutex);
+        if (!checkpointPath.empty()) saveCheckpoint();
+        fflush(output);
+    }
+    bool ok = !ferror(output);
+    if (output != stdout) ok = fclose(output) == 0 && ok;
+    if (!quiet) {
+        std::fprintf(stderr, "%llu lines in %.2f s (%.1f positions/sec, %u threads)%s\n",
+                     static_cast<unsigned long long>(nextToWrite - startLine), seconds,
+                     seconds > 0 ? (nextToWrite - startLine) / seconds : 0.0, threadCount,
+                     interrupted ? ", interrupted" : "");
+    }
+    if (!ok) {
+        std::cerr << "failed to write output\n";
+        return 1;
+    }
+    return interrupted ? 130 : 0;
+}
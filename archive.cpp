@@ -0,0 +1,201 @@
+#include "archive.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <map>
+#include <queue>
+#include <thread>
+
+ArchiveResult archiveResultFromString(const std::string& result) {
+    if (result == "1-0") return RESULT_WHITE_WINS;
+    if (result == "0-1") return RESULT_BLACK_WINS;
+    if (result == "1/2-1/2") return RESULT_DRAW;
+    return RESULT_UNKNOWN;
+}
+
+ArchiveWriter::~ArchiveWriter() {
+    if (file) fclose(file);
+}
+
+bool ArchiveWriter::open(const std::string& path, std::string& error) {
+    file = fopen(path.c_str(), "wb");
+    if (!file) {
+        error = path + ": " + std::strerror(errno);
+        return false;
+    }
+    // Large sequential writes; the header is filled in by finish()
+    setvbuf(file, nullptr, _IOFBF, 1 << 20);
+    ArchiveHeader header{};
+    fwrite(&header, sizeof(header), 1, file);
+    games.clear();
+    moveCount = 0;
+    return true;
+}
+
+void ArchiveWriter::addGame(const std::vector<uint16_t>& moves, ArchiveResult result) {
+    ArchiveGame game{};
+    game.firstMove = moveCount;
+    game.plyCount = static_cast<uint32_t>(moves.size());
+    game.result = result;
+    games.push_back(game);
+    fwrite(moves.data(), sizeof(uint16_t), moves.size(), file);
+    moveCount += moves.size();
+}
+
+bool ArchiveWriter::finish(std::string& error) {
+    ArchiveHeader header{};
+    std::memcpy(header.magic, "CGA1", 4);
+    header.version = ARCHIVE_VERSION;
+    header.gameCount = games.size();
+    header.moveCount = moveCount;
+    header.gameTableOffset = sizeof(ArchiveHeader) + moveCount * sizeof(uint16_t);
+    // Keep the game table 8-byte aligned inside the mapping
+    uint64_t padding = (8 - header.gameTableOffset % 8) % 8;
+    static const char zeros[8] = {};
+    fwrite(zeros, 1, padding, file);
+    header.gameTableOffset += padding;
+    fwrite(games.data(), sizeof(ArchiveGame), games.size(), file);
+    fseek(file, 0, SEEK_SET);
+    fwrite(&header, sizeof(header), 1, file);
+    bool ok = !ferror(file);
+    ok = fclose(file) == 0 && ok;
+    file = nullptr;
+    if (!ok) error = "failed to write archive";
+    return ok;
+}
+
+bool Archive::open(const std::string& path, std::string& error) {
+    if (!file.open(path, error)) return false;
+    const ArchiveHeader* h = header();
+    if (file.size() < sizeof(ArchiveHeader) || std::memcmp(h->magic, "CGA1", 4) != 0 ||
+        h->version != ARCHIVE_VERSION) {
+        error = path + ": not a game archive";
+        return false;
+    }
+    if (h->gameTableOffset + h->gameCount * sizeof(ArchiveGame) > file.size() ||
+        sizeof(ArchiveHeader) + h->moveCount * sizeof(uint16_t) > h->gameTableOffset) {
+        error = path + ": archive is truncated";
+        return false;
+    }
+    moveData = reinterpret_cast<const uint16_t*>(file.data() + sizeof(ArchiveHeader));
+    games = reinterpret_cast<const ArchiveGame*>(file.data() + h->gameTableOffset);
+    return true;
+}
+
+bool PositionIndex::open(const std::string& path, std::string& error) {
+    if (!file.open(path, error)) return false;
+    const IndexHeader* h = reinterpret_cast<const IndexHeader*>(file.data());
+    if (file.size() < sizeof(IndexHeader) || std::memcmp(h->magic, "CGI1", 4) != 0 ||
+        h->version != ARCHIVE_VERSION) {
+        error = path + ": not a position index";
+        return false;
+    }
+    std::size_t offset = sizeof(IndexHeader);
+    if (offset + h->entryCount * sizeof(IndexEntry) > file.size()) {
+        error = path + ": index is truncated";
+        return false;
+    }
+    entries = reinterpret_cast<const IndexEntry*>(file.data() + offset);
+    count = h->entryCount;
+    return true;
+}
+
+std::pair<const IndexEntry*, const IndexEntry*> PositionIndex::find(uint64_t key) const {
+    auto first = std::lower_bound(entries, entries + count, key,
+                                  [](const IndexEntry& e, uint64_t k) { return e.key < k; });
+    auto last = std::upper_bound(first, entries + count, key,
+                                 [](uint64_t k, const IndexEntry& e) { return k < e.key; });
+    return {first, last};
+}
+
+static bool entryLess(const IndexEntry& a, const IndexEntry& b) {
+    if (a.key != b.key) return a.key < b.key;
+    if (a.gameId != b.gameId) return a.gameId < b.gameId;
+    return a.ply < b.ply;
+}
+
+// Replays games [begin, end) and collects a sorted run of index entries
+static void indexGames(const Archive& archive, uint64_t begin, uint64_t end, std::vector<IndexEntry>& run) {
+    Game game;
+    std::string promotion;
+    for (uint64_t id = begin; id < end; ++id) {
+        default_board(game);
+        const uint16_t* moves = archive.moves(id);
+        uint32_t plies = std::min<uint32_t>(archive.game(id).plyCount, UINT16_MAX);
+        for (uint32_t ply = 0; ply <= plies; ++ply) {
+            uint16_t next = ply < plies ? moves[ply] : 0;
+            run.push_back({zobristKey(game), static_cast<uint32_t>(id), static_cast<uint16_t>(ply), next});
+            if (ply == plies || !applyMove(game, unpackMove(next, promotion), promotion)) break;
+        }
+    }
+    std::sort(run.begin(), run.end(), entryLess);
+}
+
+bool buildPositionIndex(const Archive& archive, const std::string& path, unsigned threadCount,
+                        std::string& error) {
+    if (threadCount == 0) threadCount = 1;
+    uint64_t gameCount = archive.gameCount();
+    std::vector<std::vector<IndexEntry>> runs(threadCount);
+    std::vector<std::thread> workers;
+    for (unsigned t = 0; t < threadCount; ++t) {
+        uint64_t begin = gameCount * t / threadCount;
+        uint64_t end = gameCount * (t + 1) / threadCount;
+        workers.emplace_back([&archive, &runs, t, begin, end] { indexGames(archive, begin, end, runs[t]); });
+    }
+    for (auto& w : workers) w.join();
+
+    FILE* out = fopen(path.c_str(), "wb");
+    if (!out) {
+        error = path + ": " + std::strerror(errno);
+        return false;
+    }
+    setvbuf(out, nullptr, _IOFBF, 1 << 20);
+    IndexHeader header{};
+    std::memcpy(header.magic, "CGI1", 4);
+    header.version = ARCHIVE_VERSION;
+    header.gameCount = gameCount;
+    for (const auto& run : runs) header.entryCount += run.size();
+    fwrite(&header, sizeof(header), 1, out);
+
+    // k-way merge of the sorted runs straight into the file
+    using Cursor = std::pair<std::size_t, std::size_t>; // run, position
+    auto greater = [&runs](const Cursor& a, const Cursor& b) {
+        return entryLess(runs[b.first][b.second], runs[a.first][a.second]);
+    };
+    std::priority_queue<Cursor, std::vector<Cursor>, decltype(greater)> heap(greater);
+    for (std::size_t r = 0; r < runs.size(); ++r) {
+        if (!runs[r].empty()) heap.push({r, 0});
+    }
+    while (!heap.empty()) {
+        Cursor c = heap.top();
+        heap.pop();
+        fwrite(&runs[c.first][c.second], sizeof(IndexEntry), 1, out);
+        if (++c.second < runs[c.first].size()) heap.push(c);
+    }
+    bool ok = !ferror(out);
+    ok = fclose(out) == 0 && ok;
+    if (!ok) error = path + ": write failed";
+    return ok;
+}
+
+std::vector<ExplorerMove> explorePosition(const Archive& archive, const PositionIndex& index, uint64_t key) {
+    std::map<uint16_t, ExplorerMove> byMove;
+    auto range = index.find(key);
+    for (const IndexEntry* e = range.first; e != range.second; ++e) {
+        if (e->nextMove == 0 || e->gameId >= archive.gameCount()) continue;
+        ExplorerMove& m = byMove[e->nextMove];
+        m.move = e->nextMove;
+        ++m.games;
+        switch (archive.game(e->gameId).result) {
+            case RESULT_WHITE_WINS: ++m.whiteWins; break;
+            case RESULT_BLACK_WINS: ++m.blackWins; break;
+            case RESULT_DRAW: ++m.draws; break;
+            default: break;
+        }
+    }
+    std::vector<ExplorerMove> moves;
+    for (auto& entry : byMove) moves.push_back(entry.second);
+    std::sort(moves.begin(), moves.end(),
+              [](const ExplorerMove& a, const ExplorerMove& b) { return a.games > b.games; });
+    return moves;
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+#include "game.h"
+#include "mapped_file.h"
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Compact binary game store and position index. Both files are written in
+// native (little-endian) byte order and are read through a memory mapping,
+// so queries only touch the pages they need.
+//
+// Game archive (.cga):   ArchiveHeader | packed moves (uint16 each) | ArchiveGame table
+// Position index (.cgi): IndexHeader | IndexEntry[] sorted by key
+//
+// The index holds one entry per position reached in every game (ply 0 is the
+// start position) together with the move that was played from it.
+
+const uint32_t ARCHIVE_VERSION = 1;
+
+enum ArchiveResult : uint8_t { RESULT_UNKNOWN, RESULT_WHITE_WINS, RESULT_BLACK_WINS, RESULT_DRAW };
+
+struct ArchiveHeader {
+    char magic[4];            // "CGA1"
+    uint32_t version;
+    uint64_t gameCount;
+    uint64_t moveCount;
+    uint64_t gameTableOffset; // byte offset of the ArchiveGame table
+};
+
+struct ArchiveGame {
+    uint64_t firstMove;       // index into the packed move array
+    uint32_t plyCount;
+    uint8_t result;           // ArchiveResult
+    uint8_t reserved[3];
+};
+
+struct IndexHeader {
+    char magic[4];            // "CGI1"
+    uint32_t version;
+    uint64_t entryCount;
+    uint64_t gameCount;       // games in the archive the index was built from
+};
+
+struct IndexEntry {
+    uint64_t key;             // zobristKey() of the position
+    uint32_t gameId;
+    uint16_t ply;
+    uint16_t nextMove;        // packed move played from here, 0 at the end of the game
+};
+
+static_assert(sizeof(ArchiveHeader) == 32, "archive header layout");
+static_assert(sizeof(ArchiveGame) == 16, "archive game layout");
+static_assert(sizeof(IndexHeader) == 24, "index header layout");
+static_assert(sizeof(IndexEntry) == 16, "index entry layout");
+
+ArchiveResult archiveResultFromString(const std::string& result);
+
+// Streams games into a new archive
+class ArchiveWriter {
+public:
+    ArchiveWriter() = default;
+    ArchiveWriter(const ArchiveWriter&) = delete;
+    ArchiveWriter& operator=(const ArchiveWriter&) = delete;
+    ~ArchiveWriter();
+
+    bool open(const std::string& path, std::string& error);
+    void addGame(const std::vector<uint16_t>& moves, ArchiveResult result);
+    // Writes the game table and header. Must be called for a usable file.
+    bool finish(std::string& error);
+
+private:
+    FILE* file = nullptr;
+    std::vector<ArchiveGame> games;
+    uint64_t moveCount = 0;
+};
+
+class Archive {
+public:
+    bool open(const std::string& path, std::string& error);
+    uint64_t gameCount() const { return header()->gameCount; }
+    const ArchiveGame& game(uint64_t id) const { return games[id]; }
+    const uint16_t* moves(uint64_t id) const { return moveData + games[id].firstMove; }
+
+private:
+    const ArchiveHeader* header() const { return reinterpret_cast<const ArchiveHeader*>(file.data()); }
+
+    MappedFile file;
+    const uint16_t* moveData = nullptr;
+    const ArchiveGame* games = nullptr;
+};
+
+class PositionIndex {
+public:
+    bool open(const std::string& path, std::string& error);
+    uint64_t size() const { return count; }
+    // Entries for key as a [first, last) range inside the mapping
+    std::pair<const IndexEntry*, const IndexEntry*> find(uint64_t key) const;
+
+private:
+    MappedFile file;
+    const IndexEntry* entries = nullptr;
+    uint64_t count = 0;
+};
+
+// Replays every game on threadCount threads and writes the sorted index
+bool buildPositionIndex(const Archive& archive, const std::string& path, unsigned threadCount,
+                        std::string& error);
+
+struct ExplorerMove {
+    uint16_t move;
+    long games = 0;
+    long whiteWins = 0;
+    long draws = 0;
+    long blackWins = 0;
+};
+
+// Moves played from the position, most popular first, with their results
+std::vector<ExplorerMove> explorePosition(const Archive& archive, const PositionIndex& index, uint64_t key);
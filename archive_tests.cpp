@@ -0,0 +1,93 @@
+#include "archive.h"
+#include <cassert>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+
+void play(Game& game, const std::vector<std::string>& moves) {
+    for (const auto& text : moves) {
+        AIMove m;
+        std::string promotion;
+        [[maybe_unused]] bool ok = parseMove(text, m, promotion);
+        assert(ok);
+        ok = applyMove(game, m, promotion);
+        assert(ok);
+    }
+}
+
+void testTranspositionsShareKeys() {
+    Game a, b, c;
+    default_board(a);
+    default_board(b);
+    default_board(c);
+    play(a, {"g1f3", "g8f6", "b1c3"});
+    play(b, {"b1c3", "g8f6", "g1f3"});
+    play(c, {"b1c3", "g8f6"});
+    assert(zobristKey(a) == zobristKey(b));
+    assert(zobristKey(a) != zobristKey(c));
+}
+
+void testPackedMoves() {
+    Game game;
+    default_board(game);
+    uint16_t packed = packMove(game, {6, 4, 4, 4, 0});
+    assert(packedMoveToString(packed) == "e2e4");
+    std::string promotion;
+    [[maybe_unused]] AIMove m = unpackMove(packed, promotion);
+    assert(m.sr == 6 && m.sc == 4 && m.er == 4 && m.ec == 4);
+
+    clearBoard(game);
+    game.board[1][0] = createPiece("white-pawn");
+    packed = packMove(game, {1, 0, 0, 0, 0}, "knight");
+    assert(packedMoveToString(packed) == "a7a8n");
+    unpackMove(packed, promotion);
+    assert(promotion == "knight");
+}
+
+void testArchiveRoundTrip() {
+    std::string archivePath = "archive_tests.cga";
+    std::string indexPath = "archive_tests.cgi";
+    std::string error;
+    Game game;
+    default_board(game);
+    std::vector<uint16_t> first = {packMove(game, {6, 4, 4, 4, 0})};
+    std::vector<uint16_t> second = {packMove(game, {6, 3, 4, 3, 0})};
+    {
+        ArchiveWriter writer;
+        [[maybe_unused]] bool ok = writer.open(archivePath, error);
+        assert(ok);
+        writer.addGame(first, RESULT_WHITE_WINS);
+        writer.addGame(first, RESULT_DRAW);
+        writer.addGame(second, RESULT_BLACK_WINS);
+        ok = writer.finish(error);
+        assert(ok);
+    }
+    Archive archive;
+    [[maybe_unused]] bool ok = archive.open(archivePath, error);
+    assert(ok);
+    assert(archive.gameCount() == 3);
+    assert(archive.moves(2)[0] == second[0]);
+    ok = buildPositionIndex(archive, indexPath, 2, error);
+    assert(ok);
+
+    PositionIndex index;
+    ok = index.open(indexPath, error);
+    assert(ok);
+    assert(index.size() == 6);
+    auto moves = explorePosition(archive, index, zobristKey(game));
+    assert(moves.size() == 2);
+    assert(packedMoveToString(moves[0].move) == "e2e4" && moves[0].games == 2);
+    assert(moves[0].whiteWins == 1 && moves[0].draws == 1);
+    assert(moves[1].games == 1 && moves[1].blackWins == 1);
+    std::remove(archivePath.c_str());
+    std::remove(indexPath.c_str());
+}
+
+int main() {
+    testTranspositionsShareKeys();
+    testPackedMoves();
+    testArchiveRoundTrip();
+    std::cout << "All archive tests passed\n";
+    return 0;
+}
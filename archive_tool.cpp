@@ -0,0 +1,177 @@
+// Builds and queries the binary game archive and its position index.
+//
+// Usage: chess_archive [--threads N] build games.cga file.pgn...
+//        chess_archive [--threads N] index games.cga games.cgi
+//        chess_archive query games.cga games.cgi [e2e4 e7e5 ...]
+//
+// build imports every valid game from the PGN files, index writes the
+// Zobrist key -> (game, ply) index and query lists the moves played from the
+// position reached by the given moves.
+#include "archive.h"
+#include "pgn.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+struct ImportedGame {
+    std::vector<uint16_t> moves;
+    ArchiveResult result;
+};
+
+void usage() {
+    std::cerr << "Usage: chess_archive [--threads N] build games.cga file.pgn...\n"
+                 "       chess_archive [--threads N] index games.cga games.cgi\n"
+                 "       chess_archive query games.cga games.cgi [e2e4 e7e5 ...]\n";
+}
+
+double secondsSince(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+int buildArchive(const std::string& out, const std::vector<std::string>& inputs, unsigned threadCount) {
+    const std::size_t chunkSize = 8u << 20;
+    ArchiveWriter writer;
+    std::string error;
+    if (!writer.open(out, error)) {
+        std::cerr << error << "\n";
+        return 1;
+    }
+    auto start = Clock::now();
+    long imported = 0;
+    long rejected = 0;
+    for (const auto& path : inputs) {
+        MappedFile file;
+        if (!file.open(path, error)) {
+            std::cerr << error << "\n";
+            return 1;
+        }
+        std::string_view data = file.view();
+        std::size_t chunkCount = (data.size() + chunkSize - 1) / chunkSize;
+        // Chunks are parsed a wave at a time and written in file order, so
+        // game ids follow the input and memory stays bounded
+        for (std::size_t wave = 0; wave < chunkCount; wave += threadCount) {
+            std::vector<std::vector<ImportedGame>> parsed(threadCount);
+            std::vector<long> bad(threadCount, 0);
+            std::vector<std::thread> workers;
+            for (unsigned t = 0; t < threadCount && wave + t < chunkCount; ++t) {
+                workers.emplace_back([&, t] {
+                    std::size_t begin = (wave + t) * chunkSize;
+                    std::size_t end = std::min(begin + chunkSize, data.size());
+                    std::size_t pos = findGameStart(data, begin);
+                    while (pos < end && pos < data.size()) {
+                        PgnGame game = readGame(data, pos);
+                        PgnCheck check = checkPgnGame(game.text, true);
+                        // Archived games always replay from the standard start
+                        if (check.ok && pgnTag(game.text, "FEN").empty()) {
+                            parsed[t].push_back({std::move(check.moves), archiveResultFromString(check.result)});
+                        } else {
+                            ++bad[t];
+                        }
+                        pos = game.offset + game.text.size();
+                    }
+                });
+            }
+            for (auto& w : workers) w.join();
+            for (unsigned t = 0; t < threadCount; ++t) {
+                for (const auto& g : parsed[t]) writer.addGame(g.moves, g.result);
+                imported += static_cast<long>(parsed[t].size());
+                rejected += bad[t];
+            }
+        }
+    }
+    if (!writer.finish(error)) {
+        std::cerr << error << "\n";
+        return 1;
+    }
+    std::printf("%s: %ld games imported, %ld rejected in %.2f s\n", out.c_str(), imported, rejected,
+                secondsSince(start));
+    return 0;
+}
+
+int buildIndex(const std::string& archivePath, const std::string& indexPath, unsigned threadCount) {
+    Archive archive;
+    std::string error;
+    if (!archive.open(archivePath, error)) {
+        std::cerr << error << "\n";
+        return 1;
+    }
+    auto start = Clock::now();
+    if (!buildPositionIndex(archive, indexPath, threadCount, error)) {
+        std::cerr << error << "\n";
+        return 1;
+    }
+    PositionIndex index;
+    if (!index.open(indexPath, error)) {
+        std::cerr << error << "\n";
+        return 1;
+    }
+    std::printf("%s: %llu positions from %llu games in %.2f s (%u threads)\n", indexPath.c_str(),
+                static_cast<unsigned long long>(index.size()),
+                static_cast<unsigned long long>(archive.gameCount()), secondsSince(start), threadCount);
+    return 0;
+}
+
+int query(const std::string& archivePath, const std::string& indexPath, const std::vector<std::string>& moves) {
+    Game game;
+    default_board(game);
+    for (const auto& text : moves) {
+        AIMove move;
+        std::string promotion;
+        if (!parseMove(text, move, promotion) || !applyMove(game, move, promotion)) {
+            std::cerr << "Illegal move: " << text << "\n";
+            return 1;
+        }
+    }
+
+    auto start = Clock::now();
+    Archive archive;
+    PositionIndex index;
+    std::string error;
+    if (!archive.open(archivePath, error) || !index.open(indexPath, error)) {
+        std::cerr << error << "\n";
+        return 1;
+    }
+    auto found = explorePosition(archive, index, zobristKey(game));
+    double ms = secondsSince(start) * 1000.0;
+    for (const auto& m : found) {
+        std::printf("%-6s %8ld games  %5.1f%% white  %5.1f%% draw  %5.1f%% black\n",
+                    packedMoveToString(m.move).c_str(), m.games, 100.0 * m.whiteWins / m.games,
+                    100.0 * m.draws / m.games, 100.0 * m.blackWins / m.games);
+    }
+    std::printf("%zu moves found in %.2f ms\n", found.size(), ms);
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    unsigned threadCount = std::thread::hardware_concurrency();
+    std::vector<std::string> args;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--threads" && i + 1 < argc) {
+            threadCount = static_cast<unsigned>(std::atoi(argv[++i]));
+        } else {
+            args.push_back(arg);
+        }
+    }
+    if (threadCount == 0) threadCount = 1;
+
+    if (args.size() >= 3 && args[0] == "build") {
+        return buildArchive(args[1], std::vector<std::string>(args.begin() + 2, args.end()), threadCount);
+    }
+    if (args.size() == 3 && args[0] == "index") {
+        return buildIndex(args[1], args[2], threadCount);
+    }
+    if (args.size() >= 3 && args[0] == "query") {
+        return query(args[1], args[2], std::vector<std::string>(args.begin() + 3, args.end()));
+    }
+    usage();
+    return 1;
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstddef>
+
+// Piece images and the UI font, compiled into the GUI. chess_pack_assets
+// (pack_assets.cpp) decodes assets/pieces at build time and writes them out
+// as ready-to-upload pixels, so startup reads and decodes no files. The font
+// stays a TrueType file in memory; SFML renders its glyphs as they are needed.
+
+const int ATLAS_TILE = 128;  // pixels per side of one piece
+const int ATLAS_COLUMNS = 6; // pawn, knight, bishop, rook, queen, king
+const int ATLAS_ROWS = 2;    // white, then black, so pieceIndex() i is at column i % 6, row i / 6
+const int ATLAS_WIDTH = ATLAS_TILE * ATLAS_COLUMNS;
+const int ATLAS_HEIGHT = ATLAS_TILE * ATLAS_ROWS;
+
+extern const unsigned char ATLAS_PIXELS[]; // RGBA, ATLAS_WIDTH * ATLAS_HEIGHT * 4 bytes
+extern const unsigned char FONT_DATA[];
+extern const std::size_t FONT_DATA_SIZE;
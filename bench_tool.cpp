@@ -0,0 +1,184 @@
+// Whole-engine benchmark. Searches every position of the fixed corpus
+// (bench_positions.h) to the same depth, one thread and an empty
+// transposition table per position, so the node count only changes when the
+// search or the evaluation does. Prints the nodes and best move of each
+// position, then the total nodes and nodes per second:
+//
+//   bench: <nodes> nodes <nps> nps <ms> ms
+//
+// The hit rates of the pawn hash and the evaluation cache follow. The corpus
+// is then searched again with both caches off, which must give the same node
+// counts, and the time the caches saved is reported:
+//
+//   pawn hash: <probes> probes <rate>% hits
+//   eval cache: <probes> probes <rate>% hits
+//   eval caches: <ms> ms with, <ms> ms without, <percent>% saved
+//
+// --json FILE also writes the figures as one JSON object, with the hot-path
+// counters when built with -DCHESS_STATS=ON, for diffing runs between commits.
+//
+// Usage: chess_bench [--depth N] [--hash MB] [--json FILE]
+#include "bench_positions.h"
+#include "search.h"
+#include "stats.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+struct PositionResult {
+    std::string fen;
+    uint64_t nodes = 0;
+    std::string bestMove;
+    int score = 0;
+};
+
+static std::string jsonString(const std::string& text) {
+    std::string quoted = "\"";
+    for (char c : text) {
+        if (c == '"' || c == '\\') quoted += '\\';
+        quoted += c;
+    }
+    return quoted + "\"";
+}
+
+struct CorpusRun {
+    std::vector<PositionResult> results;
+    uint64_t nodes = 0;
+    double seconds = 0;
+    uint64_t pawnProbes = 0;
+    uint64_t pawnHits = 0;
+    uint64_t evalProbes = 0;
+    uint64_t evalHits = 0;
+};
+
+// Searches every position with a fresh context; false on a bad FEN
+static bool runCorpus(TranspositionTable& tt, const SearchLimits& limits, bool caches, CorpusRun& run) {
+    for (const char* fen : BENCH_POSITIONS) {
+        Game game;
+        std::string error;
+        if (!loadFen(game, fen, error)) {
+            std::cerr << fen << ": " << error << "\n";
+            return false;
+        }
+        tt.clear();
+        SearchContext context;
+        context.tt = &tt;
+        if (!caches) {
+            context.evalCaches.pawns.resize(0);
+            context.evalCaches.evals.resize(0);
+        }
+        // Only the search is timed, not clearing the table
+        auto start = std::chrono::steady_clock::now();
+        SearchResult result = searchPosition(context, game, limits);
+        run.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        PositionResult position;
+        position.fen = fen;
+        position.nodes = result.nodes;
+        position.bestMove = result.bestMove ? packedMoveToString(result.bestMove) : "-";
+        position.score = result.score;
+        run.nodes += result.nodes;
+        run.pawnProbes += context.evalCaches.pawns.probes;
+        run.pawnHits += context.evalCaches.pawns.hits;
+        run.evalProbes += context.evalCaches.evals.probes;
+        run.evalHits += context.evalCaches.evals.hits;
+        run.results.push_back(position);
+    }
+    return true;
+}
+
+static double percent(uint64_t part, uint64_t whole) {
+    return whole ? 100.0 * part / whole : 0.0;
+}
+
+static void usage() {
+    std::cerr << "Usage: chess_bench [--depth N] [--hash MB] [--json FILE]\n";
+}
+
+int main(int argc, char* argv[]) {
+    int depth = 5;
+    std::size_t hashMb = 16;
+    std::string jsonPath;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--depth" && i + 1 < argc) {
+            depth = std::atoi(argv[++i]);
+        } else if (arg == "--hash" && i + 1 < argc) {
+            hashMb = static_cast<std::size_t>(std::atoi(argv[++i]));
+        } else if (arg == "--json" && i + 1 < argc) {
+            jsonPath = argv[++i];
+        } else {
+            usage();
+            return 1;
+        }
+    }
+    if (depth < 1) depth = 1;
+    if (hashMb == 0) hashMb = 1;
+
+    TranspositionTable tt(hashMb);
+    SearchLimits limits;
+    limits.depth = depth;
+    StatTotals statsBefore = statTotals();
+    CorpusRun cached;
+    if (!runCorpus(tt, limits, true, cached)) return 1;
+    StatTotals statsAfter = statTotals();
+    for (const PositionResult& position : cached.results) {
+        std::printf("%-70s %-6s %10llu\n", position.fen.c_str(), position.bestMove.c_str(),
+                    static_cast<unsigned long long>(position.nodes));
+    }
+    uint64_t totalNodes = cached.nodes;
+    double seconds = cached.seconds;
+    uint64_t nps = seconds > 0 ? static_cast<uint64_t>(totalNodes / seconds) : 0;
+    std::printf("bench: %llu nodes %llu nps %.0f ms\n", static_cast<unsigned long long>(totalNodes),
+                static_cast<unsigned long long>(nps), seconds * 1000);
+    std::printf("pawn hash: %llu probes %.1f%% hits\n", static_cast<unsigned long long>(cached.pawnProbes),
+                percent(cached.pawnHits, cached.pawnProbes));
+    std::printf("eval cache: %llu probes %.1f%% hits\n", static_cast<unsigned long long>(cached.evalProbes),
+                percent(cached.evalHits, cached.evalProbes));
+
+    CorpusRun uncached;
+    if (!runCorpus(tt, limits, false, uncached)) return 1;
+    for (std::size_t i = 0; i < cached.results.size(); ++i) {
+        if (uncached.results[i].nodes != cached.results[i].nodes) {
+            std::cerr << cached.results[i].fen << ": " << cached.results[i].nodes << " nodes with the eval caches, "
+                      << uncached.results[i].nodes << " without\n";
+            return 1;
+        }
+    }
+    double saved = uncached.seconds > 0 ? 100.0 * (uncached.seconds - seconds) / uncached.seconds : 0.0;
+    std::printf("eval caches: %.0f ms with, %.0f ms without, %.1f%% saved\n", seconds * 1000,
+                uncached.seconds * 1000, saved);
+
+    if (jsonPath.empty()) return 0;
+    FILE* out = std::fopen(jsonPath.c_str(), "w");
+    if (!out) {
+        std::perror(jsonPath.c_str());
+        return 1;
+    }
+    std::fprintf(out, "{\"depth\":%d,\"nodes\":%llu,\"nps\":%llu,\"ms\":%.1f,\"positions\":[", depth,
+                 static_cast<unsigned long long>(totalNodes), static_cast<unsigned long long>(nps), seconds * 1000);
+    const std::vector<PositionResult>& results = cached.results;
+    for (std::size_t i = 0; i < results.size(); ++i) {
+        std::fprintf(out, "%s{\"fen\":%s,\"best\":\"%s\",\"score\":%d,\"nodes\":%llu}", i ? "," : "",
+                     jsonString(results[i].fen).c_str(), results[i].bestMove.c_str(), results[i].score,
+                     static_cast<unsigned long long>(results[i].nodes));
+    }
+    std::fprintf(out, "],\"pawn_hash\":{\"probes\":%llu,\"hits\":%llu}",
+                 static_cast<unsigned long long>(cached.pawnProbes), static_cast<unsigned long long>(cached.pawnHits));
+    std::fprintf(out, ",\"eval_cache\":{\"probes\":%llu,\"hits\":%llu}",
+                 static_cast<unsigned long long>(cached.evalProbes), static_cast<unsigned long long>(cached.evalHits));
+    std::fprintf(out, ",\"uncached_ms\":%.1f", uncached.seconds * 1000);
+    if (STATS_ENABLED) {
+        StatTotals totals = statsAfter;
+        for (int id = 0; id < STAT_ID_COUNT; ++id) {
+            totals.count[id] -= statsBefore.count[id];
+            totals.nanoseconds[id] -= statsBefore.nanoseconds[id];
+        }
+        std::fprintf(out, ",\"stats\":%s", statsJsonLine(totals, static_cast<int64_t>(seconds * 1000)).c_str());
+    }
+    std::fprintf(out, "}\n");
+    std::fclose(out);
+    return 0;
+}
@@ -0,0 +1,257 @@
+#include "engine.h"
+#include "log.h"
+#include <algorithm>
+
+static int64_t steadyMs() {
+    using namespace std::chrono;
+    return duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+void TimeManager::start(const TimeControl& clock) {
+    int64_t available = std::max<int64_t>(clock.remainingMs - OVERHEAD_MS, 1);
+    int moves = clock.movesToGo > 0 ? std::min(clock.movesToGo, 40) : 30;
+    // Most of the increment can be spent, it comes back after the move
+    soft = available / moves + clock.incrementMs * 3 / 4;
+    int64_t cap = clock.movesToGo == 1 ? available * 9 / 10 : available / 3;
+    hard = std::max<int64_t>(std::min(soft * 4, cap), 1);
+    soft = std::min(soft, hard);
+    lastMove = 0;
+    stableIterations = 0;
+    haveScore = false;
+}
+
+bool TimeManager::iterationDone(const SearchResult& result, int64_t elapsedMs) {
+    stableIterations = result.bestMove == lastMove ? stableIterations + 1 : 0;
+    double factor = 1.0;
+    if (stableIterations >= 4) factor = 0.5;
+    else if (stableIterations >= 2) factor = 0.75;
+    else if (stableIterations == 0 && lastMove != 0) factor = 1.4;
+    if (haveScore && result.score < lastScore - 25) factor *= result.score < lastScore - 75 ? 2.0 : 1.5;
+    lastMove = result.bestMove;
+    lastScore = result.score;
+    haveScore = true;
+    return elapsedMs >= std::min<double>(hard, soft * factor);
+}
+
+static void openSharedTable(TranspositionTable& tt, const std::string& name, std::size_t hashMb) {
+    std::string error;
+    if (!name.empty() && !tt.openShared(name, hashMb, error)) LOG_WARN("Private hash table: " << error);
+}
+
+Engine::Engine(std::size_t hashMb, const std::string& sharedHash) : tt(hashMb) {
+    openSharedTable(tt, sharedHash, hashMb);
+    worker = std::thread(&Engine::run, this);
+}
+
+Engine::~Engine() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        quit = true;
+        abortSearch = true;
+    }
+    wake.notify_all();
+    worker.join();
+}
+
+int64_t Engine::elapsedMs() const {
+    using namespace std::chrono;
+    return duration_cast<milliseconds>(steady_clock::now() - started).count();
+}
+
+void Engine::run() {
+    SearchContext context;
+    context.tt = &tt;
+    SearchLimits limits;
+    limits.depth = MAX_PLY - 1;
+    limits.abort = [this] {
+        if (abortSearch.load(std::memory_order_relaxed)) return true;
+        int64_t deadline = hardDeadlineMs.load(std::memory_order_relaxed);
+        return deadline != 0 && steadyMs() >= deadline;
+    };
+    limits.iterationDone = [this](const SearchResult& result) {
+        std::lock_guard<std::mutex> lock(mutex);
+        // Pondering goes on until it is stopped or turns into a timed search
+        return !timed || !timeManager.iterationDone(result, elapsedMs());
+    };
+
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+        wake.wait(lock, [this] { return quit || hasJob; });
+        if (quit) return;
+        hasJob = false;
+        running = true;
+        Game game = job;
+        lock.unlock();
+        SearchResult result = searchPosition(context, game, limits);
+        lock.lock();
+        running = false;
+        // A search that was stopped (mode back to IDLE) is thrown away
+        if (mode == Mode::THINKING) {
+            finished = result;
+            ready = true;
+            mode = Mode::IDLE;
+        } else if (mode == Mode::PONDERING) {
+            finished = result;
+            mode = Mode::PONDER_DONE;
+        }
+        idle.notify_all();
+    }
+}
+
+void Engine::startJob(const Game& game, Mode newMode) {
+    job = game;
+    hasJob = true;
+    mode = newMode;
+    abortSearch = false;
+    started = std::chrono::steady_clock::now();
+    wake.notify_one();
+}
+
+void Engine::stopLocked(std::unique_lock<std::mutex>& lock) {
+    mode = Mode::IDLE;
+    hasJob = false;
+    if (running) {
+        abortSearch = true;
+        idle.wait(lock, [this] { return !running; });
+    }
+    abortSearch = false;
+    hardDeadlineMs = 0;
+    timed = false;
+}
+
+void Engine::think(const Game& game, const TimeControl& clock) {
+    std::unique_lock<std::mutex> lock(mutex);
+    ready = false;
+    bool hit = (mode == Mode::PONDERING || mode == Mode::PONDER_DONE) && zobristKey(game) == ponderKey;
+    lastThinkWasPonderHit = hit;
+    if (hit) {
+        // Keep the search going. The time spent pondering counts towards the
+        // soft limit, but the hard limit runs on our own clock from now.
+        timeManager.start(clock);
+        timed = true;
+        hardDeadlineMs = steadyMs() + timeManager.hardLimitMs();
+        if (mode == Mode::PONDER_DONE) {
+            ready = true;
+            mode = Mode::IDLE;
+        } else {
+            mode = Mode::THINKING;
+            if (elapsedMs() >= timeManager.softLimitMs()) abortSearch = true;
+        }
+        return;
+    }
+    stopLocked(lock);
+    timeManager.start(clock);
+    timed = true;
+    startJob(game, Mode::THINKING);
+    hardDeadlineMs = steadyMs() + timeManager.hardLimitMs();
+}
+
+bool Engine::ponder(const Game& game) {
+    std::unique_lock<std::mutex> lock(mutex);
+    stopLocked(lock);
+    expectedReply = 0;
+    TTEntry entry;
+    if (game.isOver() || !tt.probe(zobristKey(game), entry) || entry.move == 0) return false;
+    std::string promotion;
+    AIMove reply = unpackMove(entry.move, promotion);
+    Game after(game);
+    if (!applyMove(after, reply, promotion) || after.isOver()) return false;
+    ponderKey = zobristKey(after);
+    expectedReply = entry.move;
+    startJob(after, Mode::PONDERING);
+    return true;
+}
+
+bool Engine::resultReady(SearchResult& result) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!ready) return false;
+    result = finished;
+    ready = false;
+    return true;
+}
+
+void Engine::stop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    stopLocked(lock);
+    ready = false;
+}
+
+Analyzer::Analyzer(std::size_t hashMb, const std::string& sharedHash) : tt(hashMb) {
+    openSharedTable(tt, sharedHash, hashMb);
+    worker = std::thread(&Analyzer::run, this);
+}
+
+Analyzer::~Analyzer() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        quit = true;
+        ++generation;
+    }
+    wake.notify_all();
+    worker.join();
+}
+
+void Analyzer::run() {
+    SearchContext context;
+    context.tt = &tt;
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+        wake.wait(lock, [this] { return quit || hasJob; });
+        if (quit) return;
+        hasJob = false;
+        Game game = job;
+        uint64_t mine = generation;
+        SearchLimits limits;
+        limits.depth = MAX_PLY - 1;
+        limits.multiPv = jobLines;
+        lock.unlock();
+
+        uint64_t key = zobristKey(game);
+        int64_t start = steadyMs();
+        limits.abort = [this, mine] { return generation.load(std::memory_order_relaxed) != mine; };
+        limits.iterationDone = [&](const SearchResult& result) {
+            std::lock_guard<std::mutex> guard(mutex);
+            if (generation != mine) return false;
+            latest.key = key;
+            latest.depth = result.depth;
+            latest.nodes = result.nodes;
+            latest.elapsedMs = steadyMs() - start;
+            latest.lines = result.lines;
+            fresh = true;
+            return true;
+        };
+        searchPosition(context, game, limits);
+        lock.lock();
+    }
+}
+
+void Analyzer::analyze(const Game& game, int lines) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        job = game;
+        jobLines = std::max(lines, 1);
+        hasJob = true;
+        ++generation;
+        // Nothing is known about the new position yet
+        latest = AnalysisInfo();
+        latest.key = zobristKey(game);
+        fresh = true;
+    }
+    wake.notify_one();
+}
+
+void Analyzer::stop() {
+    std::lock_guard<std::mutex> lock(mutex);
+    hasJob = false;
+    ++generation;
+    latest = AnalysisInfo();
+    fresh = true;
+}
+
+bool Analyzer::poll(AnalysisInfo& info) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!fresh) return false;
+    info = latest;
+    fresh = false;
+    return true;
+}
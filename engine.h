@@ -0,0 +1,146 @@
+#pragma once
+
+#include "search.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Searching in the background for the GUI: an opponent that thinks on a clock
+// and keeps working on the expected reply while the human is to move, and an
+// analyser that streams the best lines of the position on the board.
+
+struct TimeControl {
+    int64_t remainingMs = 0; // on the clock of the side to move
+    int64_t incrementMs = 0;
+    int movesToGo = 0;       // until the next time control, 0 if none
+};
+
+// Per-move budget. The soft limit decides whether another iteration is worth
+// starting; the hard limit aborts one that is running. The soft limit shrinks
+// while the best move stays the same and grows when it keeps changing or the
+// score falls.
+class TimeManager {
+public:
+    // Milliseconds kept back for GUI and scheduling latency
+    static const int64_t OVERHEAD_MS = 30;
+
+    void start(const TimeControl& clock);
+    // Called after each completed iteration with the time spent so far.
+    // Returns true when the search should stop.
+    bool iterationDone(const SearchResult& result, int64_t elapsedMs);
+    int64_t softLimitMs() const { return soft; }
+    int64_t hardLimitMs() const { return hard; }
+
+private:
+    int64_t soft = 0;
+    int64_t hard = 0;
+    uint16_t lastMove = 0;
+    int stableIterations = 0;
+    int lastScore = 0;
+    bool haveScore = false;
+};
+
+class Engine {
+public:
+    // With a sharedHash name the table lives in that shared-memory segment,
+    // see TranspositionTable::openShared; if it cannot be opened the engine
+    // logs a warning and keeps a table of its own.
+    explicit Engine(std::size_t hashMb = 64, const std::string& sharedHash = "");
+    Engine(const Engine&) = delete;
+    Engine& operator=(const Engine&) = delete;
+    ~Engine();
+
+    // Starts a timed search for the side to move. If the engine was pondering
+    // this very position (a ponder hit) the running search is kept: it carries
+    // on under the budget, and moves at once if the time already spent
+    // pondering covers it.
+    void think(const Game& game, const TimeControl& clock);
+    // Starts an untimed search of the position after the reply the table
+    // expects from the side to move. Returns false if there is no guess.
+    bool ponder(const Game& game);
+    // The finished search, once; false while thinking or pondering
+    bool resultReady(SearchResult& result);
+    // Abandons whatever is running
+    void stop();
+
+    // Packed reply being pondered on, 0 if none
+    uint16_t ponderMove() const { return expectedReply; }
+    // Whether the last think() found its position already being pondered
+    bool ponderHit() const { return lastThinkWasPonderHit; }
+
+private:
+    enum class Mode { IDLE, THINKING, PONDERING, PONDER_DONE };
+
+    void run();
+    void startJob(const Game& game, Mode mode);
+    void stopLocked(std::unique_lock<std::mutex>& lock);
+    int64_t elapsedMs() const;
+
+    TranspositionTable tt;
+    std::thread worker;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable idle;
+    bool quit = false;
+    bool hasJob = false;
+    bool running = false;
+    Game job;
+    uint64_t ponderKey = 0;
+    uint16_t expectedReply = 0;
+    Mode mode = Mode::IDLE;
+    TimeManager timeManager;
+    bool timed = false;
+    std::chrono::steady_clock::time_point started;
+    SearchResult finished;
+    bool ready = false;
+    bool lastThinkWasPonderHit = false;
+    std::atomic<bool> abortSearch{false};
+    std::atomic<int64_t> hardDeadlineMs{0}; // steady clock milliseconds, 0 for none
+};
+
+// What the analyser has found so far for one position
+struct AnalysisInfo {
+    uint64_t key = 0; // zobristKey() of the position, 0 while idle
+    int depth = 0;
+    uint64_t nodes = 0;
+    int64_t elapsedMs = 0;
+    std::vector<PvLine> lines;
+};
+
+// Searches the position it was last given, deeper and deeper, until given
+// another one; the lines are published after every completed depth. Switching
+// position never waits for the running search, which notices at its next
+// abort poll, so the caller can do it from the render loop.
+class Analyzer {
+public:
+    explicit Analyzer(std::size_t hashMb = 64, const std::string& sharedHash = "");
+    Analyzer(const Analyzer&) = delete;
+    Analyzer& operator=(const Analyzer&) = delete;
+    ~Analyzer();
+
+    void analyze(const Game& game, int lines);
+    void stop();
+    // Copies the latest info if it changed since the last call
+    bool poll(AnalysisInfo& info);
+
+private:
+    void run();
+
+    TranspositionTable tt;
+    std::thread worker;
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool quit = false;
+    bool hasJob = false;
+    Game job;
+    int jobLines = 1;
+    AnalysisInfo latest;
+    bool fresh = false;
+    // Bumped for every new job; the running search aborts once it differs
+    std::atomic<uint64_t> generation{0};
+};
@@ -0,0 +1,197 @@
+#include "engine.h"
+#include <cassert>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+
+using Clock = std::chrono::steady_clock;
+
+static int64_t millisecondsSince(Clock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - start).count();
+}
+
+// Plays a packed move; kept out of assert so release builds play it too
+static void play(Game& game, uint16_t move) {
+    std::string promotion;
+    AIMove m = unpackMove(move, promotion);
+    [[maybe_unused]] bool ok = applyMove(game, m, promotion);
+    assert(ok);
+}
+
+// Fails the test, in release builds too, once start is more than timeoutMs ago
+static void checkTimeout(Clock::time_point start, int64_t timeoutMs, const char* what) {
+    if (millisecondsSince(start) < timeoutMs) return;
+    std::cerr << "Timed out waiting for " << what << "\n";
+    std::abort();
+}
+
+// Waits for the engine to finish, failing the test after timeoutMs
+static SearchResult waitForResult(Engine& engine, int64_t timeoutMs) {
+    auto start = Clock::now();
+    SearchResult result;
+    while (!engine.resultReady(result)) {
+        checkTimeout(start, timeoutMs, "the engine");
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return result;
+}
+
+void testBudgets() {
+    TimeManager tm;
+    tm.start({60000, 0, 0});
+    assert(tm.softLimitMs() == (60000 - TimeManager::OVERHEAD_MS) / 30);
+    assert(tm.hardLimitMs() == tm.softLimitMs() * 4);
+
+    // The increment is mostly spendable
+    tm.start({60000, 2000, 0});
+    assert(tm.softLimitMs() > (60000 - TimeManager::OVERHEAD_MS) / 30 + 1000);
+
+    // Nearly out of time: the hard limit keeps well inside the clock
+    tm.start({300, 5000, 0});
+    assert(tm.hardLimitMs() <= 300 / 3);
+    assert(tm.softLimitMs() <= tm.hardLimitMs());
+
+    // Last move before the time control may use most of the clock
+    tm.start({10000, 0, 1});
+    assert(tm.hardLimitMs() > 5000);
+}
+
+void testStabilityAndScoreDrops() {
+    TimeManager tm;
+    tm.start({30000, 0, 0}); // soft 999 ms
+    int64_t soft = tm.softLimitMs();
+    SearchResult r;
+    r.bestMove = 100;
+    r.score = 20;
+    // iterationDone counts the iterations, so it is kept out of assert
+    [[maybe_unused]] bool done = tm.iterationDone(r, soft / 2);
+    assert(!done);
+    // A settled best move ends the search early
+    for (int i = 0; i < 3; ++i) {
+        done = tm.iterationDone(r, soft * 7 / 10);
+        assert(!done);
+    }
+    done = tm.iterationDone(r, soft * 7 / 10);
+    assert(done);
+
+    // A falling score buys more time
+    tm.start({30000, 0, 0});
+    r.score = 20;
+    done = tm.iterationDone(r, 10);
+    assert(!done);
+    r.score = -100;
+    done = tm.iterationDone(r, soft * 3 / 2);
+    assert(!done);
+    // but never past the hard limit
+    done = tm.iterationDone(r, tm.hardLimitMs());
+    assert(done);
+}
+
+void testThinkRespectsClock() {
+    Engine engine(4);
+    Game game;
+    default_board(game);
+    [[maybe_unused]] auto start = Clock::now();
+    engine.think(game, {3000, 0, 0});
+    SearchResult result = waitForResult(engine, 2000);
+    assert(result.bestMove != 0);
+    play(game, result.bestMove);
+    assert(millisecondsSince(start) < 1000 + 200);
+}
+
+void testPonderHitMovesAtOnce() {
+    Engine engine(4);
+    Game game;
+    std::string error;
+    [[maybe_unused]] bool ok = loadFen(game, "r1bqkbnr/pppp1ppp/2n5/4p3/4P3/5N2/PPPP1PPP/RNBQKB1R w KQkq - 2 3", error);
+    assert(ok);
+    engine.think(game, {3000, 0, 0});
+    SearchResult result = waitForResult(engine, 2000);
+    play(game, result.bestMove);
+
+    ok = engine.ponder(game);
+    assert(ok);
+    uint16_t expected = engine.ponderMove();
+    assert(expected != 0);
+    // Give pondering longer than the next move's budget
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    play(game, expected);
+    [[maybe_unused]] auto start = Clock::now();
+    engine.think(game, {3000, 0, 0});
+    result = waitForResult(engine, 2000);
+    assert(engine.ponderHit());
+    assert(result.bestMove != 0);
+    assert(millisecondsSince(start) < 50);
+}
+
+void testPonderMiss() {
+    Engine engine(4);
+    Game game;
+    default_board(game);
+    engine.think(game, {3000, 0, 0});
+    SearchResult result = waitForResult(engine, 2000);
+    play(game, result.bestMove);
+    [[maybe_unused]] bool pondering = engine.ponder(game);
+    assert(pondering);
+
+    // Play something other than the expected reply
+    for (const AIMove& m : generateLegalMoves(game, game.isWhiteTurn)) {
+        if (packMove(game, m) != engine.ponderMove()) {
+            [[maybe_unused]] bool ok = applyMove(game, m);
+            assert(ok);
+            break;
+        }
+    }
+    engine.think(game, {3000, 0, 0});
+    result = waitForResult(engine, 2000);
+    assert(!engine.ponderHit());
+    play(game, result.bestMove);
+}
+
+// Waits until the analyser reports at least minDepth for the position
+static AnalysisInfo waitForDepth(Analyzer& analyzer, const Game& game, int minDepth) {
+    auto start = Clock::now();
+    AnalysisInfo info;
+    uint64_t key = zobristKey(game);
+    while (info.key != key || info.depth < minDepth) {
+        checkTimeout(start, 5000, "the analyser");
+        if (!analyzer.poll(info)) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return info;
+}
+
+void testAnalyzerStreamsAndRestarts() {
+    Analyzer analyzer(4);
+    Game game;
+    default_board(game);
+    analyzer.analyze(game, 3);
+    AnalysisInfo info = waitForDepth(analyzer, game, 2);
+    assert(info.lines.size() == 3);
+    assert(info.lines[0].moves.size() >= 2);
+
+    // A new position takes over at once and the old lines are dropped
+    play(game, info.lines[0].moves[0]);
+    [[maybe_unused]] auto start = Clock::now();
+    analyzer.analyze(game, 2);
+    assert(millisecondsSince(start) < 20);
+    [[maybe_unused]] bool polled = analyzer.poll(info);
+    assert(polled && info.key == zobristKey(game) && info.lines.empty());
+    info = waitForDepth(analyzer, game, 3);
+    assert(info.lines.size() == 2);
+
+    analyzer.stop();
+    polled = analyzer.poll(info);
+    assert(polled && info.key == 0);
+}
+
+int main() {
+    testBudgets();
+    testStabilityAndScoreDrops();
+    testThinkRespectsClock();
+    testPonderHitMovesAtOnce();
+    testPonderMiss();
+    testAnalyzerStreamsAndRestarts();
+    std::cout << "All engine tests passed\n";
+    return 0;
+}
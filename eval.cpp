@@ -0,0 +1,128 @@
+#include "eval.h"
+#include "eval_params.h"
+#include "stats.h"
+#include <algorithm>
+
+namespace {
+// What the material pass finds besides the score
+struct MaterialScan {
+    int score = 0; // for white
+    Square kings[2] = {{-1, -1}, {-1, -1}};
+    bool queens[2] = {false, false};
+};
+}
+
+static MaterialScan scanMaterial(const Game& game) {
+    MaterialScan scan;
+    for (int r = 0; r < BOARD_SIZE; ++r) {
+        for (int c = 0; c < BOARD_SIZE; ++c) {
+            Piece* p = game.board[r][c];
+            if (!p) continue;
+            int kind = pieceIndex(p) % 6;
+            int side = p->isWhite ? 0 : 1;
+            int square = (p->isWhite ? r : BOARD_SIZE - 1 - r) * BOARD_SIZE + c;
+            int value = PIECE_VALUES[kind] + PIECE_SQUARE_TABLES[kind][square];
+            scan.score += p->isWhite ? value : -value;
+            if (kind == 5) scan.kings[side] = {r, c};
+            if (kind == 4) scan.queens[side] = true;
+        }
+    }
+    return scan;
+}
+
+static void scorePawns(const Game& game, PawnEntry& entry) {
+    // Rearmost pawn per file: the highest row for white, the lowest for black
+    int8_t (&rearmost)[2][8] = entry.shelterRow;
+    int counts[2][8] = {};
+    std::fill(&rearmost[0][0], &rearmost[0][0] + 16, static_cast<int8_t>(-1));
+    for (int r = 0; r < BOARD_SIZE; ++r) {
+        for (int c = 0; c < BOARD_SIZE; ++c) {
+            Piece* p = game.board[r][c];
+            if (!p || p->type.find("pawn") == std::string::npos) continue;
+            int side = p->isWhite ? 0 : 1;
+            ++counts[side][c];
+            if (rearmost[side][c] < 0 || (side == 0 ? r > rearmost[0][c] : r < rearmost[1][c])) {
+                rearmost[side][c] = static_cast<int8_t>(r);
+            }
+        }
+    }
+
+    int score = 0;
+    for (int r = 0; r < BOARD_SIZE; ++r) {
+        for (int c = 0; c < BOARD_SIZE; ++c) {
+            Piece* p = game.board[r][c];
+            if (!p || p->type.find("pawn") == std::string::npos) continue;
+            int side = p->isWhite ? 0 : 1;
+            int sign = p->isWhite ? 1 : -1;
+            bool isolated = true;
+            bool passed = true;
+            for (int f = std::max(c - 1, 0); f <= std::min(c + 1, BOARD_SIZE - 1); ++f) {
+                if (f != c && counts[side][f]) isolated = false;
+                // Passed when no enemy pawn is ahead on this file or the next
+                // ones; the rearmost enemy pawn is the one to look at
+                int enemy = rearmost[1 - side][f];
+                if (enemy >= 0 && (p->isWhite ? enemy < r : enemy > r)) passed = false;
+            }
+            if (isolated) score -= sign * ISOLATED_PAWN;
+            if (passed) score += sign * PASSED_PAWN[std::min(std::max(p->isWhite ? 6 - r : r - 1, 0), 5)];
+        }
+    }
+    for (int side = 0; side < 2; ++side) {
+        for (int c = 0; c < BOARD_SIZE; ++c) {
+            if (counts[side][c] > 1) score -= (side == 0 ? 1 : -1) * DOUBLED_PAWN * (counts[side][c] - 1);
+        }
+    }
+    entry.score = static_cast<int16_t>(score);
+}
+
+// Penalty for the king of side on king, from the own pawns on its file and
+// the two beside it
+static int shelterPenalty(const PawnEntry& pawns, int side, Square king) {
+    int penalty = 0;
+    for (int f = std::max(king.col - 1, 0); f <= std::min(king.col + 1, BOARD_SIZE - 1); ++f) {
+        int row = pawns.shelterRow[side][f];
+        int ahead = row < 0 ? 0 : side == 0 ? king.row - row : row - king.row;
+        penalty += ahead == 1 ? 0 : ahead == 2 ? SHELTER_PAWN_TWO_AHEAD : SHELTER_PAWN_MISSING;
+    }
+    return penalty;
+}
+
+static int whiteScore(const Game& game, const PawnEntry& pawns) {
+    MaterialScan scan = scanMaterial(game);
+    int score = scan.score + pawns.score;
+    if (scan.queens[1] && scan.kings[0].row >= 0) score -= shelterPenalty(pawns, 0, scan.kings[0]);
+    if (scan.queens[0] && scan.kings[1].row >= 0) score += shelterPenalty(pawns, 1, scan.kings[1]);
+    return score;
+}
+
+int evaluate(const Game& game) {
+    CHESS_TIME(STAT_EVALUATE);
+    PawnEntry pawns;
+    scorePawns(game, pawns);
+    int score = whiteScore(game, pawns);
+    return game.isWhiteTurn ? score : -score;
+}
+
+int evaluate(const Game& game, const PositionKeys& keys, EvalCaches& caches) {
+    CHESS_TIME(STAT_EVALUATE);
+    if (const EvalEntry* cached = caches.evals.probe(keys.key)) return cached->score;
+    PawnEntry computed;
+    const PawnEntry* pawns = caches.pawns.probe(keys.pawnKey);
+    if (!pawns) {
+        computed.key = keys.pawnKey;
+        scorePawns(game, computed);
+        caches.pawns.store(computed);
+        pawns = &computed;
+    }
+    int white = whiteScore(game, *pawns);
+    EvalEntry entry;
+    entry.key = keys.key;
+    entry.score = static_cast<int16_t>(game.isWhiteTurn ? white : -white);
+    caches.evals.store(entry);
+    return entry.score;
+}
+
+int evaluateMaterial(const Game& game) {
+    int score = scanMaterial(game).score;
+    return game.isWhiteTurn ? score : -score;
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include "game.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Static evaluation. The material and piece-square terms come from
+// eval_params.h, which chess_tune fits; the pawn-structure and king-shelter
+// terms below are set by hand. Pawn structure depends on the pawns alone and
+// is cached by pawn key, the whole evaluation by the position's key.
+
+// Centipawns, charged to the side that has the weakness
+const int DOUBLED_PAWN = 15;  // per pawn beyond the first on a file
+const int ISOLATED_PAWN = 12; // no own pawn on either neighbouring file
+// Passed pawn by the number of steps it has made from its starting row
+const int PASSED_PAWN[6] = {0, 10, 17, 30, 50, 80};
+// King shelter, per file in front of the king and beside it, while the other
+// side still has its queen: own pawn two rows ahead, or none closer
+const int SHELTER_PAWN_TWO_AHEAD = 8;
+const int SHELTER_PAWN_MISSING = 20;
+
+// Pawn-structure terms of one pawn configuration
+struct PawnEntry {
+    uint64_t key = 0;
+    int16_t score = 0;       // doubled, isolated and passed pawns, for white
+    int8_t shelterRow[2][8]; // white, black: per file the row of the rearmost own pawn, -1 if none
+};
+
+struct EvalEntry {
+    uint64_t key = 0;
+    int16_t score = 0; // for the side to move
+};
+
+// Direct-mapped, always-replacing cache for one thread. The size is rounded
+// down to a power of two; 0 entries turns the cache off. probes and hits are
+// kept for the bench report.
+template <typename Entry>
+class EvalTable {
+public:
+    explicit EvalTable(std::size_t entries) { resize(entries); }
+
+    void resize(std::size_t entries) {
+        std::size_t size = 1;
+        while (size * 2 <= entries) size *= 2;
+        slots.assign(entries ? size : 0, Entry());
+        mask = entries ? size - 1 : 0;
+    }
+
+    // The entry stored for key, or null
+    const Entry* probe(uint64_t key) {
+        ++probes;
+        if (slots.empty() || slots[key & mask].key != key) return nullptr;
+        ++hits;
+        return &slots[key & mask];
+    }
+
+    void store(const Entry& entry) {
+        if (!slots.empty()) slots[entry.key & mask] = entry;
+    }
+
+    std::size_t size() const { return slots.size(); }
+
+    uint64_t probes = 0;
+    uint64_t hits = 0;
+
+private:
+    std::vector<Entry> slots;
+    uint64_t mask = 0;
+};
+
+// One search thread's caches, 512 KB of pawn entries and 256 KB of
+// evaluations by default
+struct EvalCaches {
+    EvalTable<PawnEntry> pawns{1 << 14};
+    EvalTable<EvalEntry> evals{1 << 14};
+};
+
+// Centipawns from the side to move's point of view
+int evaluate(const Game& game);
+// Same, through the caches; keys must be those of the position
+int evaluate(const Game& game, const PositionKeys& keys, EvalCaches& caches);
+// The material and piece-square part alone, the linear function chess_tune fits
+int evaluateMaterial(const Game& game);
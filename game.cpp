@@ -0,0 +1,936 @@
+#include "game.h"
+#include "eval_params.h"
+#include "log.h"
+#include "stats.h"
+#include <sstream>
+#include <cstdlib>
+#include <cstring>
+
+Game::Game(const Game& other) {
+    copyFrom(other);
+}
+
+Game& Game::operator=(const Game& other) {
+    if (this != &other) {
+        clearBoard(*this);
+        copyFrom(other);
+    }
+    return *this;
+}
+
+Game::~Game() {
+    clearBoard(*this);
+}
+
+void Game::copyFrom(const Game& other) {
+    for (int r = 0; r < BOARD_SIZE; ++r) {
+        for (int c = 0; c < BOARD_SIZE; ++c) {
+            board[r][c] = other.board[r][c] ? new Piece(*other.board[r][c]) : nullptr;
+        }
+    }
+    isWhiteTurn = other.isWhiteTurn;
+    castlingRights = other.castlingRights;
+    enPassant = other.enPassant;
+    halfmoveClock = other.halfmoveClock;
+    fullmoveNumber = other.fullmoveNumber;
+    selectedPos = other.selectedPos;
+    selectedPiece = other.selectedPiece && isInsideBoard(selectedPos.row, selectedPos.col)
+                        ? board[selectedPos.row][selectedPos.col]
+                        : nullptr;
+    validMoves = other.validMoves;
+    status = other.status;
+    gameOverMessage = other.gameOverMessage;
+}
+
+Piece* createPiece(const std::string& name) {
+    Piece* piece = new Piece;
+    piece->type = name;
+    piece->isWhite = name.find("white") != std::string::npos;
+    return piece;
+}
+
+void clearBoard(Game& game) {
+    for (int r = 0; r < BOARD_SIZE; ++r) {
+        for (int c = 0; c < BOARD_SIZE; ++c) {
+            delete game.board[r][c];
+            game.board[r][c] = nullptr;
+        }
+    }
+}
+
+void clearSelection(Game& game) {
+    game.selectedPiece = nullptr;
+    game.selectedPos = {-1, -1};
+    game.validMoves.clear();
+}
+
+void default_board(Game& game) {
+    clearBoard(game);
+    game.isWhiteTurn = true;
+    game.castlingRights = CASTLE_ALL;
+    game.enPassant = {-1, -1};
+    game.halfmoveClock = 0;
+    game.fullmoveNumber = 1;
+    game.status = GameStatus::IN_PROGRESS;
+    game.gameOverMessage.clear();
+    clearSelection(game);
+
+    for (int i = 0; i < 8; ++i) {
+        game.board[1][i] = createPiece("black-pawn");
+        game.board[6][i] = createPiece("white-pawn");
+    }
+    game.board[0][0] = createPiece("black-rook");
+    game.board[0][1] = createPiece("black-knight");
+    game.board[0][2] = createPiece("black-bishop");
+    game.board[0][3] = createPiece("black-queen");
+    game.board[0][4] = createPiece("black-king");
+    game.board[0][5] = createPiece("black-bishop");
+    game.board[0][6] = createPiece("black-knight");
+    game.board[0][7] = createPiece("black-rook");
+    game.board[7][0] = createPiece("white-rook");
+    game.board[7][1] = createPiece("white-knight");
+    game.board[7][2] = createPiece("white-bishop");
+    game.board[7][3] = createPiece("white-queen");
+    game.board[7][4] = createPiece("white-king");
+    game.board[7][5] = createPiece("white-bishop");
+    game.board[7][6] = createPiece("white-knight");
+    game.board[7][7] = createPiece("white-rook");
+}
+
+std::string boardToSimpleString(const Game& game) {
+    std::ostringstream oss;
+    for (int r = 0; r < BOARD_SIZE; ++r) {
+        for (int c = 0; c < BOARD_SIZE; ++c) {
+            if (game.board[r][c]) {
+                oss << game.board[r][c]->type << ' ';
+            } else {
+                oss << "-- ";
+            }
+        }
+        if (r != BOARD_SIZE - 1) oss << '/';
+    }
+    return oss.str();
+}
+
+std::string squareName(int row, int col) {
+    std::string name;
+    name += static_cast<char>('a' + col);
+    name += static_cast<char>('8' - row);
+    return name;
+}
+
+std::string moveToString(const Game& game, const AIMove& move, const std::string& promotion) {
+    std::string text = squareName(move.sr, move.sc) + squareName(move.er, move.ec);
+    Piece* p = game.board[move.sr][move.sc];
+    if (p && p->type.find("pawn") != std::string::npos && (move.er == 0 || move.er == BOARD_SIZE - 1)) {
+        text += promotion == "knight" ? 'n' : promotion[0];
+    }
+    return text;
+}
+
+bool parseMove(const std::string& text, AIMove& move, std::string& promotion) {
+    if (text.size() != 4 && text.size() != 5) return false;
+    move.sc = text[0] - 'a';
+    move.sr = '8' - text[1];
+    move.ec = text[2] - 'a';
+    move.er = '8' - text[3];
+    move.score = 0;
+    if (!isInsideBoard(move.sr, move.sc) || !isInsideBoard(move.er, move.ec)) return false;
+    promotion = "queen";
+    if (text.size() == 5) {
+        switch (text[4]) {
+            case 'q': promotion = "queen"; break;
+            case 'r': promotion = "rook"; break;
+            case 'b': promotion = "bishop"; break;
+            case 'n': promotion = "knight"; break;
+            default: return false;
+        }
+    }
+    return true;
+}
+
+std::string resultString(const Game& game) {
+    if (game.status == GameStatus::CHECKMATE) return game.isWhiteTurn ? "0-1" : "1-0";
+    if (game.status == GameStatus::STALEMATE) return "1/2-1/2";
+    return "*";
+}
+
+static const char FEN_LETTERS[] = "PNBRQKpnbrqk";
+static const char* const PIECE_NAMES[] = {"white-pawn", "white-knight", "white-bishop", "white-rook",
+                                          "white-queen", "white-king", "black-pawn", "black-knight",
+                                          "black-bishop", "black-rook", "black-queen", "black-king"};
+
+bool loadFen(Game& game, const std::string& fen, std::string& error) {
+    std::istringstream in(fen);
+    std::string placement, side, castling, enPassant;
+    if (!(in >> placement >> side >> castling >> enPassant)) {
+        error = "FEN needs at least four fields";
+        return false;
+    }
+    Game loaded;
+    int row = 0;
+    int col = 0;
+    int kings[2] = {0, 0};
+    for (char ch : placement) {
+        if (ch == '/') {
+            if (col != BOARD_SIZE) break;
+            ++row;
+            col = 0;
+        } else if (ch >= '1' && ch <= '8') {
+            col += ch - '0';
+        } else {
+            const char* letter = std::strchr(FEN_LETTERS, ch);
+            if (!letter || ch == '\0' || row >= BOARD_SIZE || col >= BOARD_SIZE) {
+                error = "bad piece placement";
+                return false;
+            }
+            int index = static_cast<int>(letter - FEN_LETTERS);
+            if (index % 6 == 0 && (row == 0 || row == BOARD_SIZE - 1)) {
+                error = "pawn on the first or last rank";
+                return false;
+            }
+            if (index % 6 == 5) ++kings[index / 6];
+            loaded.board[row][col++] = createPiece(PIECE_NAMES[index]);
+        }
+        if (col > BOARD_SIZE) break;
+    }
+    if (row != BOARD_SIZE - 1 || col != BOARD_SIZE) {
+        error = "bad piece placement";
+        return false;
+    }
+    if (kings[0] != 1 || kings[1] != 1) {
+        error = "each side needs exactly one king";
+        return false;
+    }
+    if (side != "w" && side != "b") {
+        error = "bad side to move";
+        return false;
+    }
+    loaded.isWhiteTurn = side == "w";
+    loaded.castlingRights = 0;
+    if (castling != "-") {
+        for (char ch : castling) {
+            switch (ch) {
+                case 'K': loaded.castlingRights |= CASTLE_WHITE_KINGSIDE; break;
+                case 'Q': loaded.castlingRights |= CASTLE_WHITE_QUEENSIDE; break;
+                case 'k': loaded.castlingRights |= CASTLE_BLACK_KINGSIDE; break;
+                case 'q': loaded.castlingRights |= CASTLE_BLACK_QUEENSIDE; break;
+                default:
+                    error = "bad castling rights";
+                    return false;
+            }
+        }
+    }
+    if (enPassant != "-") {
+        int epRow = enPassant.size() == 2 ? '8' - enPassant[1] : -1;
+        int epCol = enPassant.size() == 2 ? enPassant[0] - 'a' : -1;
+        if (epRow != (loaded.isWhiteTurn ? 2 : 5) || epCol < 0 || epCol >= BOARD_SIZE) {
+            error = "bad en passant square";
+            return false;
+        }
+        loaded.enPassant = {epRow, epCol};
+    }
+    // The move counters are optional (EPD leaves them off)
+    if (in >> loaded.halfmoveClock) {
+        if (!(in >> loaded.fullmoveNumber) || loaded.halfmoveClock < 0 || loaded.fullmoveNumber < 1) {
+            error = "bad move counters";
+            return false;
+        }
+    }
+    int kRow, kCol;
+    findKing(loaded, !loaded.isWhiteTurn, kRow, kCol);
+    if (isSquareAttacked(loaded, kRow, kCol, loaded.isWhiteTurn)) {
+        error = "the side not to move is in check";
+        return false;
+    }
+    checkGameEnd(loaded, loaded.isWhiteTurn);
+    game = loaded;
+    return true;
+}
+
+std::string toFen(const Game& game) {
+    std::string fen;
+    for (int r = 0; r < BOARD_SIZE; ++r) {
+        int empty = 0;
+        for (int c = 0; c < BOARD_SIZE; ++c) {
+            Piece* p = game.board[r][c];
+            if (!p) {
+                ++empty;
+                continue;
+            }
+            if (empty > 0) fen += static_cast<char>('0' + empty);
+            empty = 0;
+            fen += FEN_LETTERS[pieceIndex(p)];
+        }
+        if (empty > 0) fen += static_cast<char>('0' + empty);
+        if (r != BOARD_SIZE - 1) fen += '/';
+    }
+    fen += game.isWhiteTurn ? " w " : " b ";
+    std::string castling;
+    if (game.castlingRights & CASTLE_WHITE_KINGSIDE) castling += 'K';
+    if (game.castlingRights & CASTLE_WHITE_QUEENSIDE) castling += 'Q';
+    if (game.castlingRights & CASTLE_BLACK_KINGSIDE) castling += 'k';
+    if (game.castlingRights & CASTLE_BLACK_QUEENSIDE) castling += 'q';
+    fen += castling.empty() ? "-" : castling;
+    fen += ' ';
+    fen += isInsideBoard(game.enPassant.row, game.enPassant.col) ? squareName(game.enPassant.row, game.enPassant.col)
+                                                                 : "-";
+    fen += ' ' + std::to_string(game.halfmoveClock) + ' ' + std::to_string(game.fullmoveNumber);
+    return fen;
+}
+
+int pieceIndex(const Piece* piece) {
+    static const char* const kinds[] = {"pawn", "knight", "bishop", "rook", "queen", "king"};
+    for (int i = 0; i < 6; ++i) {
+        if (piece->type.find(kinds[i]) != std::string::npos) return piece->isWhite ? i : i + 6;
+    }
+    return -1;
+}
+
+namespace {
+struct ZobristTables {
+    uint64_t pieces[12][64];
+    uint64_t blackToMove;
+    uint64_t castling[16];
+    uint64_t enPassantFile[8];
+    uint64_t noPawns; // start of every pawn key, so no position's is zero
+
+    ZobristTables() {
+        // splitmix64 with a fixed seed, so keys are stable across runs and
+        // can be stored on disk
+        uint64_t state = 0x9E3779B97F4A7C15ull;
+        auto next = [&state]() {
+            uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+            return z ^ (z >> 31);
+        };
+        for (auto& piece : pieces)
+            for (auto& sq : piece) sq = next();
+        blackToMove = next();
+        for (auto& c : castling) c = next();
+        for (auto& f : enPassantFile) f = next();
+        // Drawn last, so the keys above stay as they were
+        noPawns = next();
+    }
+};
+
+const ZobristTables& zobrist() {
+    static const ZobristTables tables;
+    return tables;
+}
+}
+
+// Only counts the square when a pawn of the side to move can take there
+static uint64_t enPassantKey(const Game& game) {
+    if (!isInsideBoard(game.enPassant.row, game.enPassant.col)) return 0;
+    int pawnRow = game.enPassant.row + (game.isWhiteTurn ? 1 : -1);
+    for (int dc : {-1, 1}) {
+        int c = game.enPassant.col + dc;
+        Piece* p = isInsideBoard(pawnRow, c) ? game.board[pawnRow][c] : nullptr;
+        if (p && p->isWhite == game.isWhiteTurn && p->type.find("pawn") != std::string::npos) {
+            return zobrist().enPassantFile[game.enPassant.col];
+        }
+    }
+    return 0;
+}
+
+uint64_t zobristKey(const Game& game) {
+    const ZobristTables& z = zobrist();
+    uint64_t key = 0;
+    for (int r = 0; r < BOARD_SIZE; ++r) {
+        for (int c = 0; c < BOARD_SIZE; ++c) {
+            if (Piece* p = game.board[r][c]) key ^= z.pieces[pieceIndex(p)][r * 8 + c];
+        }
+    }
+    if (!game.isWhiteTurn) key ^= z.blackToMove;
+    key ^= z.castling[game.castlingRights & CASTLE_ALL];
+    return key ^ enPassantKey(game);
+}
+
+PositionKeys positionKeys(const Game& game) {
+    const ZobristTables& z = zobrist();
+    PositionKeys keys;
+    keys.key = zobristKey(game);
+    keys.pawnKey = z.noPawns;
+    for (int r = 0; r < BOARD_SIZE; ++r) {
+        for (int c = 0; c < BOARD_SIZE; ++c) {
+            Piece* p = game.board[r][c];
+            if (p && p->type.find("pawn") != std::string::npos) keys.pawnKey ^= z.pieces[pieceIndex(p)][r * 8 + c];
+        }
+    }
+    return keys;
+}
+
+uint16_t packMove(const Game& game, const AIMove& move, const std::string& promotion) {
+    uint16_t packed = static_cast<uint16_t>((move.sr * 8 + move.sc) | ((move.er * 8 + move.ec) << 6));
+    Piece* p = game.board[move.sr][move.sc];
+    if (p && p->type.find("pawn") != std::string::npos && (move.er == 0 || move.er == BOARD_SIZE - 1)) {
+        int code = promotion == "knight" ? 1 : promotion == "bishop" ? 2 : promotion == "rook" ? 3 : 4;
+        packed |= static_cast<uint16_t>(code << 12);
+    }
+    return packed;
+}
+
+AIMove unpackMove(uint16_t packed, std::string& promotion) {
+    static const char* const names[] = {"queen", "knight", "bishop", "rook", "queen"};
+    int from = packed & 63;
+    int to = (packed >> 6) & 63;
+    int code = (packed >> 12) & 7;
+    promotion = names[code <= 4 ? code : 0];
+    return {from / 8, from % 8, to / 8, to % 8, 0};
+}
+
+std::string packedMoveToString(uint16_t packed) {
+    static const char letters[] = " nbrq";
+    std::string promotion;
+    AIMove m = unpackMove(packed, promotion);
+    std::string text = squareName(m.sr, m.sc) + squareName(m.er, m.ec);
+    int code = (packed >> 12) & 7;
+    if (code >= 1 && code <= 4) text += letters[code];
+    return text;
+}
+
+bool isInsideBoard(int row, int col) {
+    return row >= 0 && row < BOARD_SIZE && col >= 0 && col < BOARD_SIZE;
+}
+
+bool isPathClear(const Game& game, int startRow, int startCol, int endRow, int endCol) {
+    int dRow = (endRow > startRow) - (endRow < startRow);
+    int dCol = (endCol > startCol) - (endCol < startCol);
+    int r = startRow + dRow;
+    int c = startCol + dCol;
+    while (r != endRow || c != endCol) {
+        if (game.board[r][c] != nullptr) return false;
+        r += dRow;
+        c += dCol;
+    }
+    return true;
+}
+
+// Everything from here to the public wrappers is written once per colour.
+// Which side moves is a template parameter, so pawn directions, promotion
+// rows and castling squares are constants and the loops test pieces against
+// a constant colour instead of branching on a runtime one.
+
+template <Color Us>
+static void findKing(const Game& game, int& row, int& col) {
+    for (int r = 0; r < BOARD_SIZE; ++r) {
+        for (int c = 0; c < BOARD_SIZE; ++c) {
+            Piece* p = game.board[r][c];
+            if (p && p->isWhite == ColorTraits<Us>::IS_WHITE && p->type.find("king") != std::string::npos) {
+                row = r;
+                col = c;
+                return;
+            }
+        }
+    }
+    row = col = -1;
+}
+
+template <Color By>
+static bool isAttackedBy(const Game& game, int row, int col) {
+    CHESS_TIME(STAT_ATTACK_CHECK);
+    constexpr bool white = ColorTraits<By>::IS_WHITE;
+    auto& board = game.board;
+    auto isEnemy = [&](int r, int c, const char* kind) {
+        return board[r][c] && board[r][c]->isWhite == white && board[r][c]->type.find(kind) != std::string::npos;
+    };
+
+    // Pawns: the attacker sits one step behind the square, as seen from its side
+    int pr = row - ColorTraits<By>::FORWARD;
+    if (isInsideBoard(pr, col - 1) && isEnemy(pr, col - 1, "pawn")) return true;
+    if (isInsideBoard(pr, col + 1) && isEnemy(pr, col + 1, "pawn")) return true;
+
+    // Knights
+    static const int knightMoves[8][2] = {{2,1},{1,2},{-1,2},{-2,1},{-2,-1},{-1,-2},{1,-2},{2,-1}};
+    for (auto& m : knightMoves) {
+        int r = row + m[0];
+        int c = col + m[1];
+        if (isInsideBoard(r, c) && isEnemy(r, c, "knight")) return true;
+    }
+
+    // Kings
+    for (int dr = -1; dr <= 1; ++dr) {
+        for (int dc = -1; dc <= 1; ++dc) {
+            if (dr == 0 && dc == 0) continue;
+            int r = row + dr;
+            int c = col + dc;
+            if (isInsideBoard(r, c) && isEnemy(r, c, "king")) return true;
+        }
+    }
+
+    // Rooks/Queens (straight lines)
+    static const int dirs[4][2] = {{1,0},{-1,0},{0,1},{0,-1}};
+    for (auto& d : dirs) {
+        int r = row + d[0];
+        int c = col + d[1];
+        while (isInsideBoard(r, c)) {
+            if (board[r][c]) {
+                if (isEnemy(r, c, "rook") || isEnemy(r, c, "queen")) return true;
+                break;
+            }
+            r += d[0];
+            c += d[1];
+        }
+    }
+
+    // Bishops/Queens (diagonals)
+    static const int bdirs[4][2] = {{1,1},{1,-1},{-1,1},{-1,-1}};
+    for (auto& d : bdirs) {
+        int r = row + d[0];
+        int c = col + d[1];
+        while (isInsideBoard(r, c)) {
+            if (board[r][c]) {
+                if (isEnemy(r, c, "bishop") || isEnemy(r, c, "queen")) return true;
+                break;
+            }
+            r += d[0];
+            c += d[1];
+        }
+    }
+    return false;
+}
+
+template <Color Us>
+static bool leavesKingInCheck(Game& game, int startRow, int startCol, int endRow, int endCol) {
+    auto& board = game.board;
+    Piece* moving = board[startRow][startCol];
+    int capturedRow = endRow;
+    Piece* captured = board[endRow][endCol];
+    // En passant takes the pawn beside the destination, not on it
+    if (!captured && startCol != endCol && moving->type.find("pawn") != std::string::npos) {
+        capturedRow = startRow;
+        captured = board[startRow][endCol];
+    }
+    board[capturedRow][endCol] = nullptr;
+    board[endRow][endCol] = moving;
+    board[startRow][startCol] = nullptr;
+    int kRow, kCol;
+    findKing<Us>(game, kRow, kCol);
+    bool inCheck = isAttackedBy<opposite(Us)>(game, kRow, kCol);
+    board[startRow][startCol] = moving;
+    board[endRow][endCol] = nullptr;
+    board[capturedRow][endCol] = captured;
+    return inCheck;
+}
+
+template <Color Us>
+static bool canCastleTo(const Game& game, int row, int col, int endCol) {
+    using Our = ColorTraits<Us>;
+    if (row != Our::HOME_ROW || col != 4) return false;
+    bool kingside = endCol == 6;
+    if (!kingside && endCol != 2) return false;
+    if (!(game.castlingRights & (kingside ? Our::KINGSIDE : Our::QUEENSIDE))) return false;
+    int rookCol = kingside ? 7 : 0;
+    Piece* rook = game.board[row][rookCol];
+    if (!rook || rook->isWhite != Our::IS_WHITE || rook->type.find("rook") == std::string::npos) return false;
+    if (!isPathClear(game, row, col, row, rookCol)) return false;
+    // The king may not castle out of, through or into check
+    int step = kingside ? 1 : -1;
+    for (int c = col; c != endCol + step; c += step) {
+        if (isAttackedBy<opposite(Us)>(game, row, c)) return false;
+    }
+    return true;
+}
+
+// p belongs to Us
+template <Color Us>
+static bool isValidMoveFor(Game& game, Piece* p, int sr, int sc, int er, int ec) {
+    using Our = ColorTraits<Us>;
+    auto& board = game.board;
+    if (!isInsideBoard(er, ec)) return false;
+    Piece* target = board[er][ec];
+    if (target && target->isWhite == Our::IS_WHITE) return false;
+    if (target && target->type.find("king") != std::string::npos) return false;
+
+    int dr = er - sr;
+    int dc = ec - sc;
+    const std::string& type = p->type;
+    if (type.find("pawn") != std::string::npos) {
+        if (dc == 0) {
+            bool push = dr == Our::FORWARD && !target;
+            bool doublePush = dr == 2 * Our::FORWARD && sr == Our::PAWN_ROW && !target &&
+                              !board[sr + Our::FORWARD][sc];
+            if (!push && !doublePush) return false;
+        } else if (!(abs(dc) == 1 && dr == Our::FORWARD && (target || isEnPassantTarget(game, er, ec)))) {
+            return false;
+        }
+    } else if (type.find("rook") != std::string::npos) {
+        if (sr != er && sc != ec) return false;
+        if (!isPathClear(game, sr, sc, er, ec)) return false;
+    } else if (type.find("bishop") != std::string::npos) {
+        if (abs(dr) != abs(dc)) return false;
+        if (!isPathClear(game, sr, sc, er, ec)) return false;
+    } else if (type.find("queen") != std::string::npos) {
+        if (sr != er && sc != ec && abs(dr) != abs(dc)) return false;
+        if (!isPathClear(game, sr, sc, er, ec)) return false;
+    } else if (type.find("knight") != std::string::npos) {
+        if (!((abs(dr) == 2 && abs(dc) == 1) || (abs(dr) == 1 && abs(dc) == 2))) return false;
+    } else if (type.find("king") != std::string::npos) {
+        if (dr == 0 && abs(dc) == 2) {
+            if (!canCastleTo<Us>(game, sr, sc, ec)) return false;
+        } else {
+            if (abs(dr) > 1 || abs(dc) > 1) return false;
+            if (isAttackedBy<opposite(Us)>(game, er, ec)) return false;
+        }
+    } else {
+        return false;
+    }
+
+    return !leavesKingInCheck<Us>(game, sr, sc, er, ec);
+}
+
+// Squares a piece could reach by its movement pattern alone, ignoring checks.
+// isValidMove still has the final say; this only spares it the other squares.
+template <Color Us>
+static int candidateTargets(const Game& game, const Piece* p, int sr, int sc, Square* out) {
+    static const int knightSteps[8][2] = {{2,1},{1,2},{-1,2},{-2,1},{-2,-1},{-1,-2},{1,-2},{2,-1}};
+    static const int kingSteps[8][2] = {{1,0},{-1,0},{0,1},{0,-1},{1,1},{1,-1},{-1,1},{-1,-1}};
+    constexpr int forward = ColorTraits<Us>::FORWARD;
+    int count = 0;
+    auto add = [&](int r, int c) {
+        if (isInsideBoard(r, c)) out[count++] = {r, c};
+    };
+    const std::string& type = p->type;
+    if (type.find("pawn") != std::string::npos) {
+        add(sr + forward, sc);
+        add(sr + 2 * forward, sc);
+        add(sr + forward, sc - 1);
+        add(sr + forward, sc + 1);
+    } else if (type.find("knight") != std::string::npos) {
+        for (auto& s : knightSteps) add(sr + s[0], sc + s[1]);
+    } else if (type.find("king") != std::string::npos) {
+        for (auto& s : kingSteps) add(sr + s[0], sc + s[1]);
+        add(sr, sc - 2);
+        add(sr, sc + 2);
+    } else {
+        // Sliders walk each ray up to and including the first piece
+        bool straight = type.find("bishop") == std::string::npos;
+        bool diagonal = type.find("rook") == std::string::npos;
+        for (int i = straight ? 0 : 4; i < (diagonal ? 8 : 4); ++i) {
+            int r = sr + kingSteps[i][0];
+            int c = sc + kingSteps[i][1];
+            while (isInsideBoard(r, c)) {
+                out[count++] = {r, c};
+                if (game.board[r][c]) break;
+                r += kingSteps[i][0];
+                c += kingSteps[i][1];
+            }
+        }
+    }
+    return count;
+}
+
+template <Color Us>
+static void generateMoves(Game& game, std::vector<AIMove>& moves) {
+    CHESS_TIME(STAT_MOVE_GEN);
+    moves.clear();
+    Square targets[32];
+    for (int sr = 0; sr < BOARD_SIZE; ++sr) {
+        for (int sc = 0; sc < BOARD_SIZE; ++sc) {
+            Piece* p = game.board[sr][sc];
+            if (!p || p->isWhite != ColorTraits<Us>::IS_WHITE) continue;
+            int count = candidateTargets<Us>(game, p, sr, sc, targets);
+            for (int i = 0; i < count; ++i) {
+                int er = targets[i].row;
+                int ec = targets[i].col;
+                if (isValidMoveFor<Us>(game, p, sr, sc, er, ec)) {
+                    int score = game.board[er][ec] ? pieceValue(game.board[er][ec]->type) : 0;
+                    moves.push_back({sr, sc, er, ec, score});
+                }
+            }
+        }
+    }
+}
+
+template <Color Us>
+static bool hasLegalMove(Game& game) {
+    Square targets[32];
+    for (int sr = 0; sr < BOARD_SIZE; ++sr) {
+        for (int sc = 0; sc < BOARD_SIZE; ++sc) {
+            Piece* p = game.board[sr][sc];
+            if (!p || p->isWhite != ColorTraits<Us>::IS_WHITE) continue;
+            int count = candidateTargets<Us>(game, p, sr, sc, targets);
+            for (int i = 0; i < count; ++i) {
+                if (isValidMoveFor<Us>(game, p, sr, sc, targets[i].row, targets[i].col)) return true;
+            }
+        }
+    }
+    return false;
+}
+
+template <Color Us>
+static void checkGameEndFor(Game& game) {
+    int kRow, kCol;
+    findKing<Us>(game, kRow, kCol);
+    if (kRow == -1) return;
+    if (hasLegalMove<Us>(game)) return;
+    if (isAttackedBy<opposite(Us)>(game, kRow, kCol)) {
+        game.gameOverMessage = Us == WHITE ? "Black wins by checkmate" : "White wins by checkmate";
+        game.status = GameStatus::CHECKMATE;
+    } else {
+        game.gameOverMessage = "Stalemate - Draw";
+        game.status = GameStatus::STALEMATE;
+    }
+}
+
+// Drops the rights a move by Us gives up: any king move, a move from one of
+// our rook corners, or a capture on one of theirs
+template <Color Us>
+static void updateCastlingRights(Game& game, const Piece* moved, int startRow, int startCol, int row, int col) {
+    using Our = ColorTraits<Us>;
+    using Their = ColorTraits<opposite(Us)>;
+    if (moved->type.find("king") != std::string::npos) game.castlingRights &= ~(Our::KINGSIDE | Our::QUEENSIDE);
+    if (startRow == Our::HOME_ROW && startCol == 7) game.castlingRights &= ~Our::KINGSIDE;
+    if (startRow == Our::HOME_ROW && startCol == 0) game.castlingRights &= ~Our::QUEENSIDE;
+    if (row == Their::HOME_ROW && col == 7) game.castlingRights &= ~Their::KINGSIDE;
+    if (row == Their::HOME_ROW && col == 0) game.castlingRights &= ~Their::QUEENSIDE;
+}
+
+template <Color Us>
+static void makeMoveFor(Game& game, const AIMove& move, MoveUndo& undo, const std::string& promotion) {
+    using Our = ColorTraits<Us>;
+    auto& board = game.board;
+    Piece* moved = board[move.sr][move.sc];
+    bool isPawn = moved->type.find("pawn") != std::string::npos;
+    undo.castlingRights = game.castlingRights;
+    undo.enPassant = game.enPassant;
+    undo.halfmoveClock = game.halfmoveClock;
+    undo.captured = board[move.er][move.ec];
+    undo.capturedAt = {move.er, move.ec};
+    undo.promoted = false;
+    if (isPawn && move.sc != move.ec && !undo.captured) {
+        undo.capturedAt = {move.sr, move.ec};
+        undo.captured = board[move.sr][move.ec];
+        board[move.sr][move.ec] = nullptr;
+    }
+    if (!isPawn && abs(move.ec - move.sc) == 2 && moved->type.find("king") != std::string::npos) {
+        int rookFrom = move.ec > move.sc ? 7 : 0;
+        int rookTo = move.ec > move.sc ? 5 : 3;
+        board[Our::HOME_ROW][rookTo] = board[Our::HOME_ROW][rookFrom];
+        board[Our::HOME_ROW][rookFrom] = nullptr;
+    }
+    board[move.er][move.ec] = moved;
+    board[move.sr][move.sc] = nullptr;
+    updateCastlingRights<Us>(game, moved, move.sr, move.sc, move.er, move.ec);
+    game.enPassant = isPawn && move.er - move.sr == 2 * Our::FORWARD ? Square{move.sr + Our::FORWARD, move.ec}
+                                                                     : Square{-1, -1};
+    game.halfmoveClock = isPawn || undo.captured ? 0 : game.halfmoveClock + 1;
+    if (isPawn && move.er == Our::PROMOTION_ROW) {
+        promotePawn(moved, promotion);
+        undo.promoted = true;
+    }
+    if (Us == BLACK) ++game.fullmoveNumber;
+    game.isWhiteTurn = !Our::IS_WHITE;
+}
+
+template <Color Us>
+static void unmakeMoveFor(Game& game, const AIMove& move, const MoveUndo& undo) {
+    using Our = ColorTraits<Us>;
+    auto& board = game.board;
+    Piece* moved = board[move.er][move.ec];
+    game.isWhiteTurn = Our::IS_WHITE;
+    if (Us == BLACK) --game.fullmoveNumber;
+    if (undo.promoted) moved->type = Our::PAWN;
+    board[move.sr][move.sc] = moved;
+    board[move.er][move.ec] = nullptr;
+    board[undo.capturedAt.row][undo.capturedAt.col] = undo.captured;
+    if (abs(move.ec - move.sc) == 2 && moved->type.find("king") != std::string::npos) {
+        int rookFrom = move.ec > move.sc ? 7 : 0;
+        int rookTo = move.ec > move.sc ? 5 : 3;
+        board[Our::HOME_ROW][rookFrom] = board[Our::HOME_ROW][rookTo];
+        board[Our::HOME_ROW][rookTo] = nullptr;
+    }
+    game.castlingRights = undo.castlingRights;
+    game.enPassant = undo.enPassant;
+    game.halfmoveClock = undo.halfmoveClock;
+}
+
+// Plays the selected piece's move for good: the capture is deleted, the
+// selection cleared and the game end checked
+template <Color Us>
+static bool finalizeMoveFor(Game& game, int startRow, int startCol, int row, int col, const std::string& promotion) {
+    auto& board = game.board;
+    if (board[row][col] && board[row][col]->type.find("king") != std::string::npos) {
+        LOG_DEBUG("Cannot capture the king.");
+        clearSelection(game);
+        return false;
+    }
+    MoveUndo undo;
+    makeMoveFor<Us>(game, {startRow, startCol, row, col, 0}, undo, promotion);
+    delete undo.captured;
+    LOG_INFO("Moved piece: " << board[row][col]->type << " to (" << col << ", " << row << ")");
+    clearSelection(game);
+
+    int kRow, kCol;
+    findKing<opposite(Us)>(game, kRow, kCol);
+    if (kRow != -1 && isAttackedBy<Us>(game, kRow, kCol)) {
+        LOG_INFO((Us == BLACK ? "White" : "Black") << " king is in check");
+    }
+    checkGameEndFor<opposite(Us)>(game);
+    return true;
+}
+
+// The colour is looked up once here, at the public entry points
+
+void findKing(const Game& game, bool white, int& row, int& col) {
+    white ? findKing<WHITE>(game, row, col) : findKing<BLACK>(game, row, col);
+}
+
+bool isSquareAttacked(const Game& game, int row, int col, bool byWhite) {
+    return byWhite ? isAttackedBy<WHITE>(game, row, col) : isAttackedBy<BLACK>(game, row, col);
+}
+
+bool wouldLeaveInCheck(Game& game, int startRow, int startCol, int endRow, int endCol) {
+    return game.board[startRow][startCol]->isWhite ? leavesKingInCheck<WHITE>(game, startRow, startCol, endRow, endCol)
+                                                   : leavesKingInCheck<BLACK>(game, startRow, startCol, endRow, endCol);
+}
+
+bool canCastle(const Game& game, int row, int col, int endCol) {
+    Piece* king = game.board[row][col];
+    if (!king || king->type.find("king") == std::string::npos) return false;
+    return king->isWhite ? canCastleTo<WHITE>(game, row, col, endCol) : canCastleTo<BLACK>(game, row, col, endCol);
+}
+
+bool isEnPassantTarget(const Game& game, int row, int col) {
+    return game.enPassant.row == row && game.enPassant.col == col && game.board[row][col] == nullptr;
+}
+
+// Whole pawns, rounded from the tuned centipawn values
+int pieceValue(const std::string& type) {
+    static const char* const kinds[] = {"pawn", "knight", "bishop", "rook", "queen"};
+    for (int i = 0; i < 5; ++i) {
+        if (type.find(kinds[i]) != std::string::npos) return (PIECE_VALUES[i] + 50) / 100;
+    }
+    return 0;
+}
+
+bool isValidMove(Game& game, Piece* p, int sr, int sc, int er, int ec) {
+    if (!p) return false;
+    return p->isWhite ? isValidMoveFor<WHITE>(game, p, sr, sc, er, ec) : isValidMoveFor<BLACK>(game, p, sr, sc, er, ec);
+}
+
+void updateValidMoves(Game& game) {
+    game.validMoves.clear();
+    if (!game.selectedPiece) return;
+    int sr = game.selectedPos.row;
+    int sc = game.selectedPos.col;
+    for (int r = 0; r < BOARD_SIZE; ++r) {
+        for (int c = 0; c < BOARD_SIZE; ++c) {
+            if (isValidMove(game, game.selectedPiece, sr, sc, r, c)) {
+                game.validMoves.push_back({r, c});
+            }
+        }
+    }
+}
+
+std::vector<AIMove> generateLegalMoves(Game& game, bool white) {
+    std::vector<AIMove> moves;
+    generateLegalMoves(game, white, moves);
+    return moves;
+}
+
+void generateLegalMoves(Game& game, bool white, std::vector<AIMove>& moves) {
+    white ? generateMoves<WHITE>(game, moves) : generateMoves<BLACK>(game, moves);
+}
+
+std::vector<AIMove> generateLegalMovesForBlack(Game& game) {
+    return generateLegalMoves(game, false);
+}
+
+bool hasAnyLegalMoves(Game& game, bool white) {
+    return white ? hasLegalMove<WHITE>(game) : hasLegalMove<BLACK>(game);
+}
+
+void checkGameEnd(Game& game, bool whiteTurn) {
+    whiteTurn ? checkGameEndFor<WHITE>(game) : checkGameEndFor<BLACK>(game);
+}
+
+void promotePawn(Piece* pawn, const std::string& choice) {
+    std::string color = pawn->isWhite ? "white" : "black";
+    pawn->type = color + "-" + choice;
+}
+
+bool finalizeMove(Game& game, int startRow, int startCol, int row, int col, const std::string& promotion) {
+    return game.selectedPiece->isWhite ? finalizeMoveFor<WHITE>(game, startRow, startCol, row, col, promotion)
+                                       : finalizeMoveFor<BLACK>(game, startRow, startCol, row, col, promotion);
+}
+
+void makeMove(Game& game, const AIMove& move, MoveUndo& undo, const std::string& promotion) {
+    game.isWhiteTurn ? makeMoveFor<WHITE>(game, move, undo, promotion) : makeMoveFor<BLACK>(game, move, undo, promotion);
+}
+
+void makeMove(Game& game, const AIMove& move, MoveUndo& undo, PositionKeys& keys, const std::string& promotion) {
+    const ZobristTables& z = zobrist();
+    // Take out what the move may change wholesale, put it back afterwards
+    keys.key ^= enPassantKey(game) ^ z.castling[game.castlingRights & CASTLE_ALL];
+    Piece* moved = game.board[move.sr][move.sc];
+    int before = pieceIndex(moved);
+    makeMove(game, move, undo, promotion);
+    int after = pieceIndex(moved);
+    int from = move.sr * 8 + move.sc;
+    int to = move.er * 8 + move.ec;
+    keys.key ^= z.pieces[before][from] ^ z.pieces[after][to] ^ z.blackToMove;
+    if (before % 6 == 0) keys.pawnKey ^= z.pieces[before][from];
+    if (after % 6 == 0) keys.pawnKey ^= z.pieces[after][to];
+    if (undo.captured) {
+        int captured = pieceIndex(undo.captured);
+        int square = undo.capturedAt.row * 8 + undo.capturedAt.col;
+        keys.key ^= z.pieces[captured][square];
+        if (captured % 6 == 0) keys.pawnKey ^= z.pieces[captured][square];
+    }
+    if (before % 6 == 5 && abs(move.ec - move.sc) == 2) {
+        // The castling rook, same colour as the king
+        int rookFrom = move.sr * 8 + (move.ec > move.sc ? 7 : 0);
+        int rookTo = move.sr * 8 + (move.ec > move.sc ? 5 : 3);
+        keys.key ^= z.pieces[before - 2][rookFrom] ^ z.pieces[before - 2][rookTo];
+    }
+    keys.key ^= enPassantKey(game) ^ z.castling[game.castlingRights & CASTLE_ALL];
+}
+
+void unmakeMove(Game& game, const AIMove& move, const MoveUndo& undo) {
+    // The side that moved is the one not to move now
+    game.isWhiteTurn ? unmakeMoveFor<BLACK>(game, move, undo) : unmakeMoveFor<WHITE>(game, move, undo);
+}
+
+void moveSelectedPiece(Game& game, int row, int col, const std::string& promotion) {
+    Piece* selected = game.selectedPiece;
+    if (!selected || !isInsideBoard(row, col)) {
+        LOG_DEBUG("Invalid move attempt.");
+        return;
+    }
+    int startRow = game.selectedPos.row;
+    int startCol = game.selectedPos.col;
+    if (!isValidMove(game, selected, startRow, startCol, row, col)) {
+        LOG_DEBUG("Invalid move for piece: " << selected->type);
+        clearSelection(game);
+        return;
+    }
+    finalizeMove(game, startRow, startCol, row, col, promotion);
+}
+
+void movePiece(Game& game, int row, int col, const std::string& promotion) {
+    if (!isInsideBoard(row, col)) return;
+
+    if (!game.selectedPiece) {
+        if (game.board[row][col] != nullptr && game.board[row][col]->isWhite == game.isWhiteTurn) {
+            game.selectedPiece = game.board[row][col];
+            game.selectedPos = {row, col};
+            updateValidMoves(game);
+        }
+    } else {
+        moveSelectedPiece(game, row, col, promotion);
+    }
+}
+
+bool applyMove(Game& game, const AIMove& move, const std::string& promotion) {
+    if (game.isOver()) return false;
+    if (!isInsideBoard(move.sr, move.sc) || !isInsideBoard(move.er, move.ec)) return false;
+    Piece* p = game.board[move.sr][move.sc];
+    if (!p || p->isWhite != game.isWhiteTurn) return false;
+    if (!isValidMove(game, p, move.sr, move.sc, move.er, move.ec)) return false;
+    game.selectedPiece = p;
+    game.selectedPos = {move.sr, move.sc};
+    return finalizeMove(game, move.sr, move.sc, move.er, move.ec, promotion);
+}
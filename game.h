@@ -0,0 +1,164 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Rules core shared by the SFML front end and the headless tools. Nothing in
+// here touches globals or SFML, so independent games can be played on as many
+// threads as needed as long as each Game is only used by one thread at a time.
+
+const int BOARD_SIZE = 8;
+
+struct Piece {
+    std::string type;
+    bool isWhite;
+};
+
+struct Square {
+    int row;
+    int col;
+};
+
+struct AIMove { int sr, sc, er, ec; int score; };
+
+enum class GameStatus { IN_PROGRESS, CHECKMATE, STALEMATE };
+
+// Bits of Game::castlingRights
+const int CASTLE_WHITE_KINGSIDE = 1;
+const int CASTLE_WHITE_QUEENSIDE = 2;
+const int CASTLE_BLACK_KINGSIDE = 4;
+const int CASTLE_BLACK_QUEENSIDE = 8;
+const int CASTLE_ALL = 15;
+
+// Side as a compile-time value, for the rules code that is instantiated once
+// per colour. Row 0 is black's back rank.
+enum Color { WHITE, BLACK };
+
+constexpr Color opposite(Color color) { return color == WHITE ? BLACK : WHITE; }
+
+template <Color Us>
+struct ColorTraits {
+    static constexpr bool IS_WHITE = Us == WHITE;
+    static constexpr int FORWARD = IS_WHITE ? -1 : 1;   // row step of a pawn push
+    static constexpr int HOME_ROW = IS_WHITE ? 7 : 0;   // king and rooks
+    static constexpr int PAWN_ROW = IS_WHITE ? 6 : 1;
+    static constexpr int PROMOTION_ROW = IS_WHITE ? 0 : 7;
+    static constexpr int KINGSIDE = IS_WHITE ? CASTLE_WHITE_KINGSIDE : CASTLE_BLACK_KINGSIDE;
+    static constexpr int QUEENSIDE = IS_WHITE ? CASTLE_WHITE_QUEENSIDE : CASTLE_BLACK_QUEENSIDE;
+    static constexpr const char* PAWN = IS_WHITE ? "white-pawn" : "black-pawn";
+};
+
+// One game: the position, the piece the player has picked up and whether the
+// game has finished. The board owns its pieces; copying a Game copies them.
+struct Game {
+    Piece* board[BOARD_SIZE][BOARD_SIZE] = {};
+    bool isWhiteTurn = true;
+    int castlingRights = 0;
+    Square enPassant = {-1, -1}; // square a pawn skipped over on the last move
+    int halfmoveClock = 0;       // plies since the last capture or pawn move
+    int fullmoveNumber = 1;
+    Piece* selectedPiece = nullptr;
+    Square selectedPos = {-1, -1};
+    std::vector<Square> validMoves;
+    GameStatus status = GameStatus::IN_PROGRESS;
+    std::string gameOverMessage;
+
+    Game() = default;
+    Game(const Game& other);
+    Game& operator=(const Game& other);
+    ~Game();
+
+    bool isOver() const { return status != GameStatus::IN_PROGRESS; }
+
+private:
+    void copyFrom(const Game& other);
+};
+
+Piece* createPiece(const std::string& name);
+void clearBoard(Game& game);
+void default_board(Game& game);
+void clearSelection(Game& game);
+std::string boardToSimpleString(const Game& game);
+
+// Coordinate notation: "e2", "e2e4", "e7e8q". Row 0 is rank 8, column 0 is file a.
+std::string squareName(int row, int col);
+std::string moveToString(const Game& game, const AIMove& move, const std::string& promotion = "queen");
+// Parses "e2e4"/"e7e8n". promotion is set to the piece name, "queen" if omitted.
+bool parseMove(const std::string& text, AIMove& move, std::string& promotion);
+// 0-5 for white pawn..king, 6-11 for black, in that order
+int pieceIndex(const Piece* piece);
+// Zobrist hash of the position: pieces, side to move, castling rights and an
+// en passant square that a pawn could actually capture on
+uint64_t zobristKey(const Game& game);
+
+// 16-bit move: from square (bits 0-5), to square (6-11) and promotion piece
+// (12-14: 0 none, 1 knight, 2 bishop, 3 rook, 4 queen). Squares are row * 8 + col.
+uint16_t packMove(const Game& game, const AIMove& move, const std::string& promotion = "queen");
+AIMove unpackMove(uint16_t packed, std::string& promotion);
+std::string packedMoveToString(uint16_t packed);
+
+// Forsyth-Edwards Notation. The move counters may be left off. loadFen
+// replaces the whole position; on failure the game is untouched.
+bool loadFen(Game& game, const std::string& fen, std::string& error);
+std::string toFen(const Game& game);
+
+// PGN result token: "1-0", "0-1", "1/2-1/2" or "*" while the game is running
+std::string resultString(const Game& game);
+
+bool isInsideBoard(int row, int col);
+bool isPathClear(const Game& game, int startRow, int startCol, int endRow, int endCol);
+void findKing(const Game& game, bool white, int& row, int& col);
+bool isSquareAttacked(const Game& game, int row, int col, bool byWhite);
+bool wouldLeaveInCheck(Game& game, int startRow, int startCol, int endRow, int endCol);
+// Whether the king on (row, col) may castle to endCol (6 kingside, 2 queenside)
+bool canCastle(const Game& game, int row, int col, int endCol);
+bool isEnPassantTarget(const Game& game, int row, int col);
+int pieceValue(const std::string& type);
+bool isValidMove(Game& game, Piece* p, int sr, int sc, int er, int ec);
+void updateValidMoves(Game& game);
+std::vector<AIMove> generateLegalMoves(Game& game, bool white);
+// Same, reusing the caller's vector
+void generateLegalMoves(Game& game, bool white, std::vector<AIMove>& moves);
+std::vector<AIMove> generateLegalMovesForBlack(Game& game);
+bool hasAnyLegalMoves(Game& game, bool white);
+void checkGameEnd(Game& game, bool whiteTurn);
+
+// Turns a pawn into the named piece ("queen", "rook", "bishop" or "knight")
+void promotePawn(Piece* pawn, const std::string& choice);
+bool finalizeMove(Game& game, int startRow, int startCol, int row, int col,
+                  const std::string& promotion = "queen");
+
+// Reversible move for searching: nothing is validated or deleted and the game
+// end is not checked, so unmakeMove can restore the position exactly.
+struct MoveUndo {
+    Piece* captured = nullptr;
+    Square capturedAt = {-1, -1};
+    int castlingRights = 0;
+    Square enPassant = {-1, -1};
+    int halfmoveClock = 0;
+    bool promoted = false;
+};
+void makeMove(Game& game, const AIMove& move, MoveUndo& undo, const std::string& promotion = "queen");
+void unmakeMove(Game& game, const AIMove& move, const MoveUndo& undo);
+
+// Hashes of a position the search keeps up to date move by move instead of
+// rescanning the board: the full Zobrist key and one of the pawns alone, for
+// caching pawn-structure terms
+struct PositionKeys {
+    uint64_t key = 0;     // equal to zobristKey()
+    uint64_t pawnKey = 0; // pawns only, no side to move; never 0
+};
+PositionKeys positionKeys(const Game& game);
+// makeMove that also brings keys from the position before to the one after.
+// The caller keeps the old keys for unmakeMove.
+void makeMove(Game& game, const AIMove& move, MoveUndo& undo, PositionKeys& keys,
+              const std::string& promotion = "queen");
+
+// Move the selected piece to (row, col). Invalid attempts clear the selection.
+void moveSelectedPiece(Game& game, int row, int col, const std::string& promotion = "queen");
+
+// Selects the piece on (row, col), or moves the current selection there
+void movePiece(Game& game, int row, int col, const std::string& promotion = "queen");
+// Plays a move for the side to move. Returns false if it was rejected.
+bool applyMove(Game& game, const AIMove& move, const std::string& promotion = "queen");
@@ -0,0 +1,250 @@
+// Load generator for chess_server. Opens many connections, plays random legal
+// moves as white on each of them and reports throughput and the latency of
+// MOVE requests (our move plus the engine's reply).
+//
+// Usage: chess_loadgen [--port N] [--unix PATH] [--connections N] [--seconds S]
+//                      [--max-plies N]
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+enum class ClientState { WAIT_NEW, WAIT_MOVES, WAIT_MOVE };
+
+struct Client {
+    int fd = -1;
+    uint32_t index = 0;
+    std::string in;
+    std::string out;
+    bool waitingToWrite = false; // registered for EPOLLOUT
+    ClientState state = ClientState::WAIT_NEW;
+    int plies = 0;
+    Clock::time_point sentAt;
+};
+
+int connectTo(int port, const std::string& unixPath) {
+    int fd;
+    if (!unixPath.empty()) {
+        fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        std::strncpy(addr.sun_path, unixPath.c_str(), sizeof(addr.sun_path) - 1);
+        if (fd < 0 || connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+            if (fd >= 0) close(fd);
+            return -1;
+        }
+    } else {
+        fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(static_cast<uint16_t>(port));
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (fd < 0 || connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+            if (fd >= 0) close(fd);
+            return -1;
+        }
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    }
+    int flags = fcntl(fd, F_GETFL, 0);
+    fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+    return fd;
+}
+
+// Sends what the socket takes of the client's pending output. While some is
+// left the client is also registered for EPOLLOUT, and the main loop flushes
+// again once there is room.
+void flush(int epollFd, Client& client) {
+    while (!client.out.empty()) {
+        ssize_t n = send(client.fd, client.out.data(), client.out.size(), MSG_NOSIGNAL);
+        if (n > 0) {
+            client.out.erase(0, static_cast<std::size_t>(n));
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else {
+            // Full socket buffer, or an error the next recv reports
+            break;
+        }
+    }
+    bool waiting = !client.out.empty();
+    if (waiting == client.waitingToWrite) return;
+    epoll_event ev{};
+    ev.events = EPOLLIN | (waiting ? uint32_t(EPOLLOUT) : 0u);
+    ev.data.u32 = client.index;
+    epoll_ctl(epollFd, EPOLL_CTL_MOD, client.fd, &ev);
+    client.waitingToWrite = waiting;
+}
+
+void sendLine(int epollFd, Client& client, const std::string& line) {
+    client.out += line;
+    client.out += '\n';
+    flush(epollFd, client);
+}
+
+double percentile(std::vector<double>& samples, double p) {
+    if (samples.empty()) return 0.0;
+    std::size_t index = static_cast<std::size_t>(p * (samples.size() - 1));
+    std::nth_element(samples.begin(), samples.begin() + index, samples.end());
+    return samples[index];
+}
+
+int main(int argc, char* argv[]) {
+    int port = 7878;
+    std::string unixPath;
+    int connectionCount = 100;
+    double seconds = 10.0;
+    int maxPlies = 200;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--port" && i + 1 < argc) {
+            port = std::atoi(argv[++i]);
+        } else if (arg == "--unix" && i + 1 < argc) {
+            unixPath = argv[++i];
+        } else if (arg == "--connections" && i + 1 < argc) {
+            connectionCount = std::atoi(argv[++i]);
+        } else if (arg == "--seconds" && i + 1 < argc) {
+            seconds = std::atof(argv[++i]);
+        } else if (arg == "--max-plies" && i + 1 < argc) {
+            maxPlies = std::atoi(argv[++i]);
+        } else {
+            std::cerr << "Usage: chess_loadgen [--port N] [--unix PATH] [--connections N] "
+                         "[--seconds S] [--max-plies N]\n";
+            return 1;
+        }
+    }
+    std::signal(SIGPIPE, SIG_IGN);
+
+    int epollFd = epoll_create1(EPOLL_CLOEXEC);
+    std::vector<Client> clients(connectionCount);
+    for (int i = 0; i < connectionCount; ++i) {
+        clients[i].fd = connectTo(port, unixPath);
+        clients[i].index = static_cast<uint32_t>(i);
+        if (clients[i].fd < 0) {
+            perror("connect");
+            return 1;
+        }
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.u32 = static_cast<uint32_t>(i);
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, clients[i].fd, &ev);
+    }
+
+    std::mt19937 rng(12345);
+    std::vector<double> latencies;
+    long games = 0;
+    long errors = 0;
+    int open = connectionCount;
+
+    Clock::time_point start = Clock::now();
+    Clock::time_point deadline = start + std::chrono::duration_cast<Clock::duration>(
+                                             std::chrono::duration<double>(seconds));
+    for (auto& client : clients) sendLine(epollFd, client, "NEW");
+
+    // Handles one reply line and sends the client's next request
+    auto handleLine = [&](Client& client, const std::string& line) {
+        std::istringstream iss(line);
+        std::string word;
+        iss >> word;
+        if (client.state == ClientState::WAIT_NEW) {
+            client.plies = 0;
+            client.state = ClientState::WAIT_MOVES;
+            sendLine(epollFd, client, "MOVES");
+        } else if (client.state == ClientState::WAIT_MOVES) {
+            std::vector<std::string> moves;
+            std::string move;
+            while (iss >> move) moves.push_back(move);
+            if (moves.empty()) {
+                ++games;
+                client.state = ClientState::WAIT_NEW;
+                sendLine(epollFd, client, "NEW");
+                return;
+            }
+            std::uniform_int_distribution<std::size_t> pick(0, moves.size() - 1);
+            client.state = ClientState::WAIT_MOVE;
+            client.sentAt = Clock::now();
+            sendLine(epollFd, client, "MOVE " + moves[pick(rng)]);
+        } else {
+            auto elapsed = std::chrono::duration<double, std::micro>(Clock::now() - client.sentAt);
+            if (word != "OK") {
+                ++errors;
+                client.state = ClientState::WAIT_MOVES;
+                sendLine(epollFd, client, "MOVES");
+                return;
+            }
+            latencies.push_back(elapsed.count());
+            std::string reply, result;
+            iss >> reply >> result;
+            client.plies += 2;
+            if (result != "*" || client.plies >= maxPlies) {
+                ++games;
+                client.state = ClientState::WAIT_NEW;
+                sendLine(epollFd, client, "NEW");
+            } else {
+                client.state = ClientState::WAIT_MOVES;
+                sendLine(epollFd, client, "MOVES");
+            }
+        }
+    };
+
+    std::vector<epoll_event> events(1024);
+    char buffer[8192];
+    while (open > 0 && Clock::now() < deadline) {
+        int n = epoll_wait(epollFd, events.data(), static_cast<int>(events.size()), 100);
+        for (int i = 0; i < n; ++i) {
+            Client& client = clients[events[i].data.u32];
+            if (events[i].events & EPOLLOUT) flush(epollFd, client);
+            for (;;) {
+                ssize_t got = recv(client.fd, buffer, sizeof(buffer), 0);
+                if (got > 0) {
+                    client.in.append(buffer, static_cast<std::size_t>(got));
+                    continue;
+                }
+                if (got < 0 && errno == EINTR) continue;
+                if (got == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+                    epoll_ctl(epollFd, EPOLL_CTL_DEL, client.fd, nullptr);
+                    close(client.fd);
+                    client.fd = -1;
+                    --open;
+                }
+                break;
+            }
+            if (client.fd < 0) continue;
+            std::size_t pos;
+            while ((pos = client.in.find('\n')) != std::string::npos) {
+                std::string line = client.in.substr(0, pos);
+                client.in.erase(0, pos + 1);
+                handleLine(client, line);
+            }
+        }
+    }
+    double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+    for (auto& client : clients) {
+        if (client.fd >= 0) close(client.fd);
+    }
+    std::printf("connections %d, %.1f s\n", connectionCount, elapsed);
+    std::printf("moves       %zu (%.0f moves/sec)\n", latencies.size(), latencies.size() / elapsed);
+    std::printf("games       %ld, errors %ld, dropped connections %d\n",
+                games, errors, connectionCount - open);
+    std::printf("latency     p50 %.1f us, p99 %.1f us\n",
+                percentile(latencies, 0.50), percentile(latencies, 0.99));
+    return 0;
+}
@@ -0,0 +1,39 @@
+#include "log.h"
+#include <iostream>
+#include <mutex>
+
+std::atomic<int> g_logLevel{static_cast<int>(LogLevel::WARN)};
+
+static std::mutex logMutex;
+static std::ostream* logStream = nullptr;
+
+void setLogLevel(LogLevel level) {
+    g_logLevel.store(static_cast<int>(level), std::memory_order_relaxed);
+}
+
+LogLevel logLevel() {
+    return static_cast<LogLevel>(g_logLevel.load(std::memory_order_relaxed));
+}
+
+bool parseLogLevel(const std::string& text, LogLevel& level) {
+    static const char* const NAMES[] = {"off", "error", "warn", "info", "debug"};
+    for (int i = 0; i < 5; ++i) {
+        if (text == NAMES[i]) {
+            level = static_cast<LogLevel>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+void setLogStream(std::ostream* stream) {
+    std::lock_guard<std::mutex> lock(logMutex);
+    logStream = stream;
+}
+
+void logWrite(LogLevel level, const std::string& message) {
+    static const char* const PREFIXES[] = {"", "error: ", "warning: ", "", "debug: "};
+    std::lock_guard<std::mutex> lock(logMutex);
+    std::ostream& out = logStream ? *logStream : std::cerr;
+    out << PREFIXES[static_cast<int>(level)] << message << '\n';
+}
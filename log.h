@@ -0,0 +1,41 @@
+#pragma once
+
+#include <atomic>
+#include <ostream>
+#include <sstream>
+#include <string>
+
+// Leveled logging for the core, the GUI and the tools. Messages go to stderr,
+// or to the stream set with setLogStream(). A disabled message costs one
+// relaxed load: the LOG_* macros check the level before formatting anything.
+
+enum class LogLevel { OFF, ERROR, WARN, INFO, DEBUG };
+
+extern std::atomic<int> g_logLevel;
+
+inline bool logEnabled(LogLevel level) {
+    return static_cast<int>(level) <= g_logLevel.load(std::memory_order_relaxed);
+}
+
+void setLogLevel(LogLevel level);
+LogLevel logLevel();
+// Parses "off", "error", "warn", "info" or "debug"
+bool parseLogLevel(const std::string& text, LogLevel& level);
+// nullptr goes back to stderr
+void setLogStream(std::ostream* stream);
+// Writes one line with a level prefix; safe to call from any thread
+void logWrite(LogLevel level, const std::string& message);
+
+#define CHESS_LOG(level, message)                                   \
+    do {                                                            \
+        if (logEnabled(level)) {                                    \
+            std::ostringstream chessLogText;                        \
+            chessLogText << message;                                \
+            logWrite(level, chessLogText.str());                    \
+        }                                                           \
+    } while (0)
+
+#define LOG_ERROR(message) CHESS_LOG(LogLevel::ERROR, message)
+#define LOG_WARN(message) CHESS_LOG(LogLevel::WARN, message)
+#define LOG_INFO(message) CHESS_LOG(LogLevel::INFO, message)
+#define LOG_DEBUG(message) CHESS_LOG(LogLevel::DEBUG, message)
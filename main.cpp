@@ -1,390 +1,81 @@
 #include <SFML/Graphics.hpp>
-#include <map>
+#include "game.h"
+#include "ai.h"
+#include "archive.h"
+#include "assets.h"
+#include "engine.h"
+#include "log.h"
+#include "spectator.h"
+#include "stats.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <memory>
 #include <string>
-#include <iostream>
-#include <cctype>
-#include <vector>
-#include <random>
-#include <utility>
 #include <cstdlib>
 #include <cstdio>
-#include <optional>
-#include <sstream>
+#include <ctime>
 
 const int TILE_SIZE = 100;
-const int BOARD_SIZE = 8;
 
-struct Piece {
-    sf::Sprite sprite;
-    std::string type;
-    bool isWhite;
-};
+// All twelve pieces in one texture, uploaded from the embedded atlas
+sf::Texture pieceAtlas;
+// Taken during static initialisation, as close to process start as we get
+const std::chrono::steady_clock::time_point processStart = std::chrono::steady_clock::now();
 
-Piece* selectedPiece = nullptr;
-sf::Vector2i selectedPos;
-Piece* board[8][8] = {nullptr};
-bool isWhiteTurn = true;
-std::map<std::string, sf::Texture> textures;
+sf::IntRect pieceRect(int index) {
+    return sf::IntRect((index % ATLAS_COLUMNS) * ATLAS_TILE, (index / ATLAS_COLUMNS) * ATLAS_TILE, ATLAS_TILE,
+                       ATLAS_TILE);
+}
 
 enum class GameState { MENU, SETTINGS, PLAYING, GAME_OVER };
 GameState gameState = GameState::MENU;
 bool aiEnabled = false;
-std::string gameOverMessage;
-
-std::vector<sf::Vector2i> validMoves;
-
-void clearSelection() {
-    selectedPiece = nullptr;
-    selectedPos = sf::Vector2i(-1, -1);
-    validMoves.clear();
-}
-
-struct AIMove { int sr, sc, er, ec; int score; };
-
-std::string boardToSimpleString() {
-    std::ostringstream oss;
-    for (int r = 0; r < BOARD_SIZE; ++r) {
-        for (int c = 0; c < BOARD_SIZE; ++c) {
-            if (board[r][c]) {
-                oss << board[r][c]->type << ' ';
-            } else {
-                oss << "-- ";
-            }
-        }
-        if (r != BOARD_SIZE - 1) oss << '/';
-    }
-    return oss.str();
-}
-
-std::optional<AIMove> requestAIMoveFromChatGPT() {
-    const char* apiKey = std::getenv("OPENAI_API_KEY");
-    if (!apiKey) return std::nullopt;
-
-    std::string boardState = boardToSimpleString();
-    std::string cmd = "python3 chatgpt_move.py \"" + boardState + "\"";
-    FILE* pipe = popen(cmd.c_str(), "r");
-    if (!pipe) return std::nullopt;
-    char buffer[128];
-    std::string result;
-    while (fgets(buffer, sizeof(buffer), pipe)) {
-        result += buffer;
-    }
-    pclose(pipe);
-    std::istringstream iss(result);
-    AIMove m;
-    if (iss >> m.sr >> m.sc >> m.er >> m.ec) {
-        m.score = 0;
-        return m;
-    }
-    return std::nullopt;
-}
-
-bool isInsideBoard(int row, int col) {
-    return row >= 0 && row < BOARD_SIZE && col >= 0 && col < BOARD_SIZE;
-}
-
-bool isPathClear(int startRow, int startCol, int endRow, int endCol) {
-    int dRow = (endRow > startRow) - (endRow < startRow);
-    int dCol = (endCol > startCol) - (endCol < startCol);
-    int r = startRow + dRow;
-    int c = startCol + dCol;
-    while (r != endRow || c != endCol) {
-        if (board[r][c] != nullptr) return false;
-        r += dRow;
-        c += dCol;
-    }
-    return true;
-}
-
-void findKing(bool white, int& row, int& col) {
-    for (int r = 0; r < BOARD_SIZE; ++r) {
-        for (int c = 0; c < BOARD_SIZE; ++c) {
-            Piece* p = board[r][c];
-            if (p && p->isWhite == white && p->type.find("king") != std::string::npos) {
-                row = r;
-                col = c;
-                return;
-            }
-        }
-    }
-    row = col = -1;
-}
-
-bool isSquareAttacked(int row, int col, bool byWhite) {
-    // Pawns
-    int dir = byWhite ? -1 : 1;
-    int pr = row + dir;
-    if (isInsideBoard(pr, col - 1) && board[pr][col - 1] &&
-        board[pr][col - 1]->isWhite == byWhite && board[pr][col - 1]->type.find("pawn") != std::string::npos)
-        return true;
-    if (isInsideBoard(pr, col + 1) && board[pr][col + 1] &&
-        board[pr][col + 1]->isWhite == byWhite && board[pr][col + 1]->type.find("pawn") != std::string::npos)
-        return true;
-
-    // Knights
-    int knightMoves[8][2] = {{2,1},{1,2},{-1,2},{-2,1},{-2,-1},{-1,-2},{1,-2},{2,-1}};
-    for (auto& m : knightMoves) {
-        int r = row + m[0];
-        int c = col + m[1];
-        if (isInsideBoard(r,c) && board[r][c] && board[r][c]->isWhite == byWhite &&
-            board[r][c]->type.find("knight") != std::string::npos)
-            return true;
-    }
-
-    // Kings
-    for (int dr = -1; dr <= 1; ++dr) {
-        for (int dc = -1; dc <= 1; ++dc) {
-            if (dr == 0 && dc == 0) continue;
-            int r = row + dr;
-            int c = col + dc;
-            if (isInsideBoard(r,c) && board[r][c] && board[r][c]->isWhite == byWhite &&
-                board[r][c]->type.find("king") != std::string::npos)
-                return true;
-        }
-    }
-
-    // Rooks/Queens (straight lines)
-    int dirs[4][2] = {{1,0},{-1,0},{0,1},{0,-1}};
-    for (auto& d : dirs) {
-        int r = row + d[0];
-        int c = col + d[1];
-        while (isInsideBoard(r,c)) {
-            if (board[r][c]) {
-                if (board[r][c]->isWhite == byWhite &&
-                    (board[r][c]->type.find("rook") != std::string::npos ||
-                     board[r][c]->type.find("queen") != std::string::npos))
-                    return true;
-                break;
-            }
-            r += d[0];
-            c += d[1];
-        }
-    }
-
-    // Bishops/Queens (diagonals)
-    int bdirs[4][2] = {{1,1},{1,-1},{-1,1},{-1,-1}};
-    for (auto& d : bdirs) {
-        int r = row + d[0];
-        int c = col + d[1];
-        while (isInsideBoard(r,c)) {
-            if (board[r][c]) {
-                if (board[r][c]->isWhite == byWhite &&
-                    (board[r][c]->type.find("bishop") != std::string::npos ||
-                     board[r][c]->type.find("queen") != std::string::npos))
-                    return true;
-                break;
-            }
-            r += d[0];
-            c += d[1];
-        }
-    }
-    return false;
-}
-
-bool wouldLeaveInCheck(int startRow, int startCol, int endRow, int endCol) {
-    Piece* moving = board[startRow][startCol];
-    Piece* captured = board[endRow][endCol];
-    board[endRow][endCol] = moving;
-    board[startRow][startCol] = nullptr;
-    int kRow, kCol;
-    findKing(moving->isWhite, kRow, kCol);
-    bool inCheck = isSquareAttacked(kRow, kCol, !moving->isWhite);
-    board[startRow][startCol] = moving;
-    board[endRow][endCol] = captured;
-    return inCheck;
-}
-
-int pieceValue(const std::string& type) {
-    if (type.find("pawn") != std::string::npos) return 1;
-    if (type.find("knight") != std::string::npos) return 3;
-    if (type.find("bishop") != std::string::npos) return 3;
-    if (type.find("rook") != std::string::npos) return 5;
-    if (type.find("queen") != std::string::npos) return 9;
-    return 0;
-}
-
-bool isValidMove(Piece* p, int sr, int sc, int er, int ec) {
-    if (!p) return false;
-    if (!isInsideBoard(er, ec)) return false;
-    if (board[er][ec] && board[er][ec]->isWhite == p->isWhite) return false;
-    if (board[er][ec] && board[er][ec]->type.find("king") != std::string::npos)
-        return false;
-
-    int dr = er - sr;
-    int dc = ec - sc;
-
-    if (p->type == "white-pawn") {
-        if (dc == 0) {
-            if (dr == -1 && board[er][ec] == nullptr) {
-            } else if (dr == -2 && sr == 6 && board[er][ec] == nullptr && board[sr - 1][sc] == nullptr) {
-            } else {
-                return false;
-            }
-        } else if (abs(dc) == 1 && dr == -1 && board[er][ec] && !board[er][ec]->isWhite) {
-        } else {
-            return false;
-        }
-    } else if (p->type == "black-pawn") {
-        if (dc == 0) {
-            if (dr == 1 && board[er][ec] == nullptr) {
-            } else if (dr == 2 && sr == 1 && board[er][ec] == nullptr && board[sr + 1][sc] == nullptr) {
-            } else {
-                return false;
-            }
-        } else if (abs(dc) == 1 && dr == 1 && board[er][ec] && board[er][ec]->isWhite) {
-        } else {
-            return false;
-        }
-    } else if (p->type.find("rook") != std::string::npos) {
-        if (sr != er && sc != ec) return false;
-        if (!isPathClear(sr, sc, er, ec)) return false;
-    } else if (p->type.find("bishop") != std::string::npos) {
-        if (abs(dr) != abs(dc)) return false;
-        if (!isPathClear(sr, sc, er, ec)) return false;
-    } else if (p->type.find("queen") != std::string::npos) {
-        if (sr != er && sc != ec && abs(dr) != abs(dc)) return false;
-        if (!isPathClear(sr, sc, er, ec)) return false;
-    } else if (p->type.find("knight") != std::string::npos) {
-        if (!((abs(dr) == 2 && abs(dc) == 1) || (abs(dr) == 1 && abs(dc) == 2)))
-            return false;
-    } else if (p->type.find("king") != std::string::npos) {
-        if (abs(dr) > 1 || abs(dc) > 1) return false;
-        if (isSquareAttacked(er, ec, !p->isWhite)) return false;
-    } else {
-        return false;
-    }
-
-    if (wouldLeaveInCheck(sr, sc, er, ec)) return false;
-    return true;
-}
-
-void updateValidMoves() {
-    validMoves.clear();
-    if (!selectedPiece) return;
-    int sr = selectedPos.x;
-    int sc = selectedPos.y;
-    for (int r = 0; r < BOARD_SIZE; ++r) {
-        for (int c = 0; c < BOARD_SIZE; ++c) {
-            if (isValidMove(selectedPiece, sr, sc, r, c)) {
-                validMoves.push_back({r, c});
-            }
-        }
-    }
-}
-
-std::vector<AIMove> generateLegalMovesForBlack() {
-    std::vector<AIMove> moves;
-    for (int sr = 0; sr < BOARD_SIZE; ++sr) {
-        for (int sc = 0; sc < BOARD_SIZE; ++sc) {
-            Piece* p = board[sr][sc];
-            if (!p || p->isWhite) continue;
-            for (int er = 0; er < BOARD_SIZE; ++er) {
-                for (int ec = 0; ec < BOARD_SIZE; ++ec) {
-                    if (isValidMove(p, sr, sc, er, ec)) {
-                        int score = board[er][ec] ? pieceValue(board[er][ec]->type) : 0;
-                        moves.push_back({sr, sc, er, ec, score});
-                    }
-                }
-            }
-        }
-    }
-    return moves;
-}
-
-bool hasAnyLegalMoves(bool white) {
-    for (int sr = 0; sr < BOARD_SIZE; ++sr) {
-        for (int sc = 0; sc < BOARD_SIZE; ++sc) {
-            Piece* p = board[sr][sc];
-            if (!p || p->isWhite != white) continue;
-            for (int er = 0; er < BOARD_SIZE; ++er) {
-                for (int ec = 0; ec < BOARD_SIZE; ++ec) {
-                    if (isValidMove(p, sr, sc, er, ec)) return true;
-                }
-            }
-        }
-    }
-    return false;
-}
-
-void checkGameEnd(bool whiteTurn) {
-    int kRow, kCol;
-    findKing(whiteTurn, kRow, kCol);
-    if (kRow == -1) return;
-    if (hasAnyLegalMoves(whiteTurn)) return;
-    bool inCheck = isSquareAttacked(kRow, kCol, !whiteTurn);
-    if (inCheck) {
-        gameOverMessage = whiteTurn ? "Black wins by checkmate" : "White wins by checkmate";
-    } else {
-        gameOverMessage = "Stalemate - Draw";
-    }
-    gameState = GameState::GAME_OVER;
-}
-
-void promotePawn(Piece* pawn) {
-    std::string color = pawn->isWhite ? "white" : "black";
+Game game;
+// Plays black against the human; the ChatGPT player is kept behind --chatgpt
+std::unique_ptr<Engine> engine;
+bool useChatGpt = false;
+bool ponderEnabled = true;
+bool engineThinking = false;
+
+// Asks the player which piece a pawn should become
+std::string choosePromotion(bool white) {
+    std::string color = white ? "white" : "black";
     std::string choice = "queen";
-#ifdef UNIT_TEST
-    // In tests, automatically promote to a queen
-#else
     sf::RenderWindow promo(sf::VideoMode(TILE_SIZE * 4, TILE_SIZE), "Promote Pawn");
     sf::Sprite options[4];
     std::string names[4] = {"queen", "rook", "bishop", "knight"};
     for (int i = 0; i < 4; ++i) {
-        options[i].setTexture(textures[color + "-" + names[i]]);
+        Piece option{color + "-" + names[i], white};
+        options[i].setTexture(pieceAtlas);
+        options[i].setTextureRect(pieceRect(pieceIndex(&option)));
         options[i].setScale(TILE_SIZE / 128.0f, TILE_SIZE / 128.0f);
         float offset = (TILE_SIZE - 128.0f * options[i].getScale().x) / 2.0f;
         options[i].setPosition(i * TILE_SIZE + offset, offset);
     }
-    while (promo.isOpen()) {
-        sf::Event event;
-        while (promo.pollEvent(event)) {
-            if (event.type == sf::Event::Closed) {
-                promo.close();
-            }
-            if (event.type == sf::Event::MouseButtonPressed &&
-                event.mouseButton.button == sf::Mouse::Left) {
-                int col = event.mouseButton.x / TILE_SIZE;
-                if (col >= 0 && col < 4) {
-                    choice = names[col];
-                    promo.close();
-                }
-            }
-        }
+    // The dialog is static, so draw it once and then block until the user picks
+    auto drawOptions = [&]() {
         promo.clear(sf::Color(200, 200, 200));
         for (int i = 0; i < 4; ++i) promo.draw(options[i]);
         promo.display();
+    };
+    drawOptions();
+    sf::Event event;
+    while (promo.isOpen() && promo.waitEvent(event)) {
+        if (event.type == sf::Event::Closed) {
+            promo.close();
+        } else if (event.type == sf::Event::MouseButtonPressed &&
+                   event.mouseButton.button == sf::Mouse::Left) {
+            int col = event.mouseButton.x / TILE_SIZE;
+            if (col >= 0 && col < 4) {
+                choice = names[col];
+                promo.close();
+            }
+        } else if (event.type == sf::Event::Resized || event.type == sf::Event::GainedFocus) {
+            drawOptions();
+        }
     }
-#endif
-    pawn->sprite.setTexture(textures[color + "-" + choice]);
-    pawn->type = color + "-" + choice;
-}
-
-bool finalizeMove(int startRow, int startCol, int row, int col) {
-    if (board[row][col] && board[row][col]->type.find("king") != std::string::npos) {
-        std::cout << "Cannot capture the king.\n";
-        clearSelection();
-        return false;
-    }
-
-    bool moverIsWhite = selectedPiece->isWhite;
-    if (board[row][col] != nullptr) delete board[row][col];
-    board[row][col] = selectedPiece;
-    board[startRow][startCol] = nullptr;
-    Piece* movedPiece = selectedPiece;
-    std::cout << "Moved piece: " << board[row][col]->type << " to (" << col << ", " << row << ")\n";
-    clearSelection();
-    if (movedPiece->type.find("pawn") != std::string::npos && (row == 0 || row == 7)) {
-        promotePawn(movedPiece);
-    }
-    isWhiteTurn = !isWhiteTurn;
-
-    int kRow, kCol;
-    findKing(!moverIsWhite, kRow, kCol);
-    if (kRow != -1 && isSquareAttacked(kRow, kCol, moverIsWhite)) {
-        std::cout << (!moverIsWhite ? "White" : "Black") << " king is in check\n";
-    }
-    checkGameEnd(!moverIsWhite);
-    return true;
+    return choice;
 }
 
 void drawBoard(sf::RenderWindow& window) {
@@ -399,35 +90,24 @@ void drawBoard(sf::RenderWindow& window) {
     }
 }
 
-Piece* createPiece(std::string name) {
-    Piece* piece = new Piece;
-    piece->sprite.setTexture(textures[name]);
-    piece->sprite.setScale(TILE_SIZE / 128.0f, TILE_SIZE / 128.0f);
-    piece->type = name;
-    piece->isWhite = name.find("white") != std::string::npos;
-    return piece;
-}
-
-void loadTextures() {
-    std::string pieces[] = {
-        "white-pawn", "white-knight", "white-bishop", "white-rook", "white-queen", "white-king",
-        "black-pawn", "black-knight", "black-bishop", "black-rook", "black-queen", "black-king"
-    };
-    for (const auto& piece : pieces) {
-        sf::Texture tex;
-        tex.loadFromFile("assets/pieces/" + piece + ".png");
-        textures[piece] = tex;
-    }
+// One upload of pixels decoded at build time; nothing is read from disk
+bool loadTextures() {
+    if (!pieceAtlas.create(ATLAS_WIDTH, ATLAS_HEIGHT)) return false;
+    pieceAtlas.update(ATLAS_PIXELS);
+    return true;
 }
 
 void drawPieces(sf::RenderWindow& window) {
-    for (int row = 0; row < 8; ++row) {
-        for (int col = 0; col < 8; ++col) {
-            Piece* piece = board[row][col];
+    sf::Sprite sprite(pieceAtlas);
+    sprite.setScale(TILE_SIZE / 128.0f, TILE_SIZE / 128.0f);
+    float offset = (TILE_SIZE - 128.0f * sprite.getScale().x) / 2.0f;
+    for (int row = 0; row < BOARD_SIZE; ++row) {
+        for (int col = 0; col < BOARD_SIZE; ++col) {
+            Piece* piece = game.board[row][col];
             if (piece) {
-                float offset = (TILE_SIZE - 128.0f * piece->sprite.getScale().x) / 2.0f;
-                piece->sprite.setPosition(col * TILE_SIZE + offset, row * TILE_SIZE + offset);
-                window.draw(piece->sprite);
+                sprite.setTextureRect(pieceRect(pieceIndex(piece)));
+                sprite.setPosition(col * TILE_SIZE + offset, row * TILE_SIZE + offset);
+                window.draw(sprite);
             }
         }
     }
@@ -436,372 +116,132 @@ void drawPieces(sf::RenderWindow& window) {
 void drawMoveHints(sf::RenderWindow& window) {
     sf::CircleShape dot(TILE_SIZE / 8.0f);
     dot.setFillColor(sf::Color(0, 0, 0, 150));
-    for (auto& mv : validMoves) {
-        dot.setPosition(mv.y * TILE_SIZE + TILE_SIZE / 2 - dot.getRadius(),
-                        mv.x * TILE_SIZE + TILE_SIZE / 2 - dot.getRadius());
+    for (auto& mv : game.validMoves) {
+        dot.setPosition(mv.col * TILE_SIZE + TILE_SIZE / 2 - dot.getRadius(),
+                        mv.row * TILE_SIZE + TILE_SIZE / 2 - dot.getRadius());
         window.draw(dot);
     }
 }
 
-void clearBoard() {
-    for (int r = 0; r < 8; ++r) {
-        for (int c = 0; c < 8; ++c) {
-            delete board[r][c];
-            board[r][c] = nullptr;
-        }
-    }
-}
-
-void default_board() {
-    clearBoard();
-    isWhiteTurn = true;
-    clearSelection();
-
-    for (int i = 0; i < 8; ++i) {
-        board[1][i] = createPiece("black-pawn");
-        board[6][i] = createPiece("white-pawn");
-    }
-    board[0][0] = createPiece("black-rook");
-    board[0][1] = createPiece("black-knight");
-    board[0][2] = createPiece("black-bishop");
-    board[0][3] = createPiece("black-queen");
-    board[0][4] = createPiece("black-king");
-    board[0][5] = createPiece("black-bishop");
-    board[0][6] = createPiece("black-knight");
-    board[0][7] = createPiece("black-rook");
-    board[7][0] = createPiece("white-rook");
-    board[7][1] = createPiece("white-knight");
-    board[7][2] = createPiece("white-bishop");
-    board[7][3] = createPiece("white-queen");
-    board[7][4] = createPiece("white-king");
-    board[7][5] = createPiece("white-bishop");
-    board[7][6] = createPiece("white-knight");
-    board[7][7] = createPiece("white-rook");
-}
-
-void moveWhitePawn(int row, int col) {
-    if (!selectedPiece || selectedPiece->type != "white-pawn" || !isInsideBoard(row, col)) {
-        std::cout << "Invalid move attempt.\n";
-        return;
-    }
-
-    int startRow = selectedPos.x;
-    int startCol = selectedPos.y;
-
-    int dy = row - startRow;
-    int dx = col - startCol;
-
-    bool moved = false;
-
-    // Forward move
-    if (dx == 0) {
-        if (dy == -1 && board[row][col] == nullptr) {
-            moved = true;
-        }
-        else if (dy == -2 && startRow == 6 && board[row][col] == nullptr && board[startRow - 1][col] == nullptr) {
-            moved = true;
-        }
-    }
-    // Capture move
-    else if (abs(dx) == 1 && dy == -1 && board[row][col] != nullptr && !board[row][col]->isWhite) {
-        moved = true;
-    }
-
-    if (moved) {
-        if (!wouldLeaveInCheck(startRow, startCol, row, col)) {
-            finalizeMove(startRow, startCol, row, col);
-        } else {
-            std::cout << "Move would leave king in check\n";
-            clearSelection();
-        }
-    } else {
-        std::cout << "Invalid move for piece: " << selectedPiece->type << "\n";
-        clearSelection();
-    }
-}
-
-void moveBlackPawn(int row, int col) {
-    if (!selectedPiece || selectedPiece->type != "black-pawn" || !isInsideBoard(row, col)) {
-        std::cout << "Invalid move attempt.\n";
-        return;
-    }
-
-    int startRow = selectedPos.x;
-    int startCol = selectedPos.y;
-
-    int dy = row - startRow;
-    int dx = col - startCol;
-
-    bool moved = false;
-
-    // Forward move
-    if (dx == 0) {
-        if (dy == 1 && board[row][col] == nullptr) {
-            moved = true;
-        } else if (dy == 2 && startRow == 1 && board[row][col] == nullptr && board[startRow + 1][col] == nullptr) {
-            moved = true;
-        }
-    }
-    // Capture move
-    else if (abs(dx) == 1 && dy == 1 && board[row][col] != nullptr && board[row][col]->isWhite) {
-        moved = true;
-    }
-
-    if (moved) {
-        if (!wouldLeaveInCheck(startRow, startCol, row, col)) {
-            finalizeMove(startRow, startCol, row, col);
-        } else {
-            std::cout << "Move would leave king in check\n";
-            clearSelection();
-        }
-    } else {
-        std::cout << "Invalid move for piece: " << selectedPiece->type << "\n";
-        clearSelection();
-    }
-}
-
-void moveRook(int row, int col) {
-    if (!selectedPiece || selectedPiece->type.find("rook") == std::string::npos || !isInsideBoard(row, col)) {
-        std::cout << "Invalid move attempt.\n";
-        return;
-    }
-
-    int startRow = selectedPos.x;
-    int startCol = selectedPos.y;
-
-    if (startRow != row && startCol != col) {
-        std::cout << "Invalid move for piece: " << selectedPiece->type << "\n";
-    } else if (!isPathClear(startRow, startCol, row, col) || (board[row][col] && board[row][col]->isWhite == selectedPiece->isWhite)) {
-        std::cout << "Invalid move for piece: " << selectedPiece->type << "\n";
-    } else {
-        if (!wouldLeaveInCheck(startRow, startCol, row, col)) {
-            finalizeMove(startRow, startCol, row, col);
-        } else {
-            std::cout << "Move would leave king in check\n";
-            clearSelection();
-        }
-        return;
-    }
-
-    clearSelection();
-}
-
-void moveBishop(int row, int col) {
-    if (!selectedPiece || selectedPiece->type.find("bishop") == std::string::npos || !isInsideBoard(row, col)) {
-        std::cout << "Invalid move attempt.\n";
-        return;
-    }
-
-    int startRow = selectedPos.x;
-    int startCol = selectedPos.y;
-    if (abs(row - startRow) != abs(col - startCol)) {
-        std::cout << "Invalid move for piece: " << selectedPiece->type << "\n";
-    } else if (!isPathClear(startRow, startCol, row, col) || (board[row][col] && board[row][col]->isWhite == selectedPiece->isWhite)) {
-        std::cout << "Invalid move for piece: " << selectedPiece->type << "\n";
-    } else {
-        if (!wouldLeaveInCheck(startRow, startCol, row, col)) {
-            finalizeMove(startRow, startCol, row, col);
-        } else {
-            std::cout << "Move would leave king in check\n";
-            clearSelection();
-        }
-        return;
-    }
-
-    clearSelection();
-}
-
-void moveKnight(int row, int col) {
-    if (!selectedPiece || selectedPiece->type.find("knight") == std::string::npos || !isInsideBoard(row, col)) {
-        std::cout << "Invalid move attempt.\n";
-        return;
-    }
-
-    int startRow = selectedPos.x;
-    int startCol = selectedPos.y;
-    int dr = abs(row - startRow);
-    int dc = abs(col - startCol);
+// Fischer clocks for both sides. The side that just moved is charged for the
+// time since the previous move and gets its increment, whoever made the move.
+struct GameClock {
+    int64_t initialMs = 5 * 60 * 1000;
+    int64_t incrementMs = 2000;
+    int64_t remainingMs[2] = {0, 0}; // black, white
+    bool whiteToMove = true;
+    bool running = false;
+    sf::Clock sinceMove;
 
-    if (!((dr == 2 && dc == 1) || (dr == 1 && dc == 2)) || (board[row][col] && board[row][col]->isWhite == selectedPiece->isWhite)) {
-        std::cout << "Invalid move for piece: " << selectedPiece->type << "\n";
-    } else {
-        if (!wouldLeaveInCheck(startRow, startCol, row, col)) {
-            finalizeMove(startRow, startCol, row, col);
-        } else {
-            std::cout << "Move would leave king in check\n";
-            clearSelection();
-        }
-        return;
+    void reset() {
+        remainingMs[0] = remainingMs[1] = initialMs;
+        whiteToMove = true;
+        running = true;
+        sinceMove.restart();
     }
 
-    clearSelection();
-}
-
-void moveQueen(int row, int col) {
-    if (!selectedPiece || selectedPiece->type.find("queen") == std::string::npos || !isInsideBoard(row, col)) {
-        std::cout << "Invalid move attempt.\n";
-        return;
+    void stop() {
+        remainingMs[whiteToMove] = remaining(whiteToMove);
+        running = false;
     }
 
-    int startRow = selectedPos.x;
-    int startCol = selectedPos.y;
-
-    bool straight = (startRow == row || startCol == col);
-    bool diagonal = abs(row - startRow) == abs(col - startCol);
-
-    if (!straight && !diagonal) {
-        std::cout << "Invalid move for piece: " << selectedPiece->type << "\n";
-    } else if (!isPathClear(startRow, startCol, row, col) || (board[row][col] && board[row][col]->isWhite == selectedPiece->isWhite)) {
-        std::cout << "Invalid move for piece: " << selectedPiece->type << "\n";
-    } else {
-        if (!wouldLeaveInCheck(startRow, startCol, row, col)) {
-            finalizeMove(startRow, startCol, row, col);
-        } else {
-            std::cout << "Move would leave king in check\n";
-            clearSelection();
-        }
-        return;
+    // Spots a move by the change of side to move
+    void update(const Game& current) {
+        if (!running || current.isWhiteTurn == whiteToMove) return;
+        remainingMs[whiteToMove] += incrementMs - sinceMove.restart().asMilliseconds();
+        whiteToMove = current.isWhiteTurn;
     }
 
-    clearSelection();
-}
-
-void moveKing(int row, int col) {
-    if (!selectedPiece || selectedPiece->type.find("king") == std::string::npos || !isInsideBoard(row, col)) {
-        std::cout << "Invalid move attempt.\n";
-        return;
+    int64_t remaining(bool white) const {
+        int64_t left = remainingMs[white];
+        if (running && white == whiteToMove) left -= sinceMove.getElapsedTime().asMilliseconds();
+        return left;
     }
 
-    int startRow = selectedPos.x;
-    int startCol = selectedPos.y;
-
-    int dr = abs(row - startRow);
-    int dc = abs(col - startCol);
-
-    if ((dr > 1 || dc > 1) || (board[row][col] && board[row][col]->isWhite == selectedPiece->isWhite)) {
-        std::cout << "Invalid move for piece: " << selectedPiece->type << "\n";
-    } else {
-        if (!wouldLeaveInCheck(startRow, startCol, row, col)) {
-            finalizeMove(startRow, startCol, row, col);
-        } else {
-            std::cout << "Move would leave king in check\n";
-            clearSelection();
-        }
-        return;
-    }
+    TimeControl control(bool white) const { return {remaining(white), incrementMs, 0}; }
+};
+GameClock gameClock;
 
-    clearSelection();
+std::string formatClock(int64_t ms) {
+    long seconds = static_cast<long>(std::max<int64_t>(ms, 0) / 1000);
+    char text[16];
+    std::snprintf(text, sizeof(text), "%ld:%02ld", seconds / 60, seconds % 60);
+    return text;
 }
 
-void movePiece(int row, int col, sf::RenderWindow& window) {
-    if (!isInsideBoard(row, col)) return;
-
-    if (!selectedPiece) {
-        if (board[row][col] != nullptr && board[row][col]->isWhite == isWhiteTurn) {
-            selectedPiece = board[row][col];
-            selectedPos = sf::Vector2i(row, col);
-            updateValidMoves();
-        }
-    } else {
-        if (selectedPiece->type == "white-pawn") {
-            moveWhitePawn(row, col);
-        } else if (selectedPiece->type == "black-pawn") {
-            moveBlackPawn(row, col);
-        } else if (selectedPiece->type.find("rook") != std::string::npos) {
-            moveRook(row, col);
-        } else if (selectedPiece->type.find("knight") != std::string::npos) {
-            moveKnight(row, col);
-        } else if (selectedPiece->type.find("bishop") != std::string::npos) {
-            moveBishop(row, col);
-        } else if (selectedPiece->type.find("queen") != std::string::npos) {
-            moveQueen(row, col);
-        } else if (selectedPiece->type.find("king") != std::string::npos) {
-            moveKing(row, col);
-        } else {
-            std::cout << "Unknown piece type.\n";
-            clearSelection();
+void syncGameOver() {
+    if (!game.isOver()) return;
+    gameState = GameState::GAME_OVER;
+    gameClock.update(game);
+    gameClock.stop();
+    if (engine) engine->stop();
+}
+
+void startNewGame(bool vsAi) {
+    if (engine) engine->stop();
+    engineThinking = false;
+    aiEnabled = vsAi;
+    default_board(game);
+    gameClock.reset();
+    gameState = GameState::PLAYING;
+}
+
+void handleBoardClick(int row, int col) {
+    std::string promotion = "queen";
+    Piece* p = game.selectedPiece;
+    if (p && p->type.find("pawn") != std::string::npos && (row == 0 || row == BOARD_SIZE - 1)) {
+        for (const auto& mv : game.validMoves) {
+            if (mv.row == row && mv.col == col) {
+                promotion = choosePromotion(p->isWhite);
+                break;
+            }
         }
     }
+    movePiece(game, row, col, promotion);
+    syncGameOver();
 }
 
-void aiMove(sf::RenderWindow& window) {
-    if (isWhiteTurn) return;
-
-    if (auto move = requestAIMoveFromChatGPT()) {
-        if (isInsideBoard(move->sr, move->sc) && isInsideBoard(move->er, move->ec)) {
-            Piece* p = board[move->sr][move->sc];
-            if (isValidMove(p, move->sr, move->sc, move->er, move->ec)) {
-                bool turnBefore = isWhiteTurn;
-                selectedPiece = p;
-                selectedPos = sf::Vector2i(move->sr, move->sc);
-                if (p->type == "black-pawn") moveBlackPawn(move->er, move->ec);
-                else if (p->type.find("rook") != std::string::npos) moveRook(move->er, move->ec);
-                else if (p->type.find("knight") != std::string::npos) moveKnight(move->er, move->ec);
-                else if (p->type.find("bishop") != std::string::npos) moveBishop(move->er, move->ec);
-                else if (p->type.find("queen") != std::string::npos) moveQueen(move->er, move->ec);
-                else if (p->type.find("king") != std::string::npos) moveKing(move->er, move->ec);
-                if (isWhiteTurn != turnBefore) return;
-            }
-        }
+// Opened from the embedded copy on first use; glyphs are rendered as needed
+sf::Font* uiFont() {
+    static sf::Font font;
+    static bool loaded = font.loadFromMemory(FONT_DATA, FONT_DATA_SIZE);
+    if (!loaded) {
+        static bool reported = false;
+        if (!reported) LOG_ERROR("Failed to load font");
+        reported = true;
+        return nullptr;
     }
-
-    auto moves = generateLegalMovesForBlack();
-    if (moves.empty()) return;
-
-    int bestScore = 0;
-    for (const auto& m : moves) {
-        if (m.score > bestScore) bestScore = m.score;
-    }
-    std::vector<AIMove> candidates;
-    for (const auto& m : moves) {
-        if (m.score == bestScore) candidates.push_back(m);
-    }
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_int_distribution<> dist(0, candidates.size() - 1);
-    AIMove choice = candidates[dist(gen)];
-    Piece* p = board[choice.sr][choice.sc];
-    selectedPiece = p;
-    selectedPos = sf::Vector2i(choice.sr, choice.sc);
-    if (p->type == "black-pawn") moveBlackPawn(choice.er, choice.ec);
-    else if (p->type.find("rook") != std::string::npos) moveRook(choice.er, choice.ec);
-    else if (p->type.find("knight") != std::string::npos) moveKnight(choice.er, choice.ec);
-    else if (p->type.find("bishop") != std::string::npos) moveBishop(choice.er, choice.ec);
-    else if (p->type.find("queen") != std::string::npos) moveQueen(choice.er, choice.ec);
-    else if (p->type.find("king") != std::string::npos) moveKing(choice.er, choice.ec);
+    return &font;
 }
 
 void drawMenu(sf::RenderWindow& window) {
-    static sf::Font font;
-    if (!font.loadFromFile("assets/fonts/arial.ttf")) {
-        std::cerr << "Failed to load font\n";
-        return;
-    }
+    sf::Font* font = uiFont();
+    if (!font) return;
     sf::RectangleShape pvp(sf::Vector2f(200, 50));
     pvp.setPosition(300, 200);
     pvp.setFillColor(sf::Color(100, 149, 237)); // cornflower blue
-    sf::Text pvpText("Play", font, 24);
+    sf::Text pvpText("Play", *font, 24);
     pvpText.setFillColor(sf::Color::White);
     pvpText.setPosition(370, 210);
 
     sf::RectangleShape ai(sf::Vector2f(200, 50));
     ai.setPosition(300, 270);
     ai.setFillColor(sf::Color(60, 179, 113)); // medium sea green
-    sf::Text aiText("Play vs AI", font, 24);
+    sf::Text aiText("Play vs AI", *font, 24);
     aiText.setFillColor(sf::Color::White);
     aiText.setPosition(335, 280);
 
     sf::RectangleShape settings(sf::Vector2f(200, 50));
     settings.setPosition(300, 340);
     settings.setFillColor(sf::Color(238, 232, 170)); // pale goldenrod
-    sf::Text settingsText("Settings", font, 24);
+    sf::Text settingsText("Settings", *font, 24);
     settingsText.setFillColor(sf::Color::Black);
     settingsText.setPosition(350, 350);
 
     sf::RectangleShape exit(sf::Vector2f(200, 50));
     exit.setPosition(300, 410);
     exit.setFillColor(sf::Color(205, 92, 92)); // indian red
-    sf::Text exitText("Exit", font, 24);
+    sf::Text exitText("Exit", *font, 24);
     exitText.setFillColor(sf::Color::White);
     exitText.setPosition(370, 420);
 
@@ -821,13 +261,9 @@ void handleMenuClick(sf::Vector2i mousePos, sf::RenderWindow& window) {
     sf::FloatRect settingsRect(300, 340, 200, 50);
     sf::FloatRect exitRect(300, 410, 200, 50);
     if (pvpRect.contains(static_cast<float>(mousePos.x), static_cast<float>(mousePos.y))) {
-        aiEnabled = false;
-        default_board();
-        gameState = GameState::PLAYING;
+        startNewGame(false);
     } else if (aiRect.contains(static_cast<float>(mousePos.x), static_cast<float>(mousePos.y))) {
-        aiEnabled = true;
-        default_board();
-        gameState = GameState::PLAYING;
+        startNewGame(true);
     } else if (settingsRect.contains(static_cast<float>(mousePos.x), static_cast<float>(mousePos.y))) {
         gameState = GameState::SETTINGS;
     } else if (exitRect.contains(static_cast<float>(mousePos.x), static_cast<float>(mousePos.y))) {
@@ -836,26 +272,20 @@ void handleMenuClick(sf::Vector2i mousePos, sf::RenderWindow& window) {
 }
 
 void drawSettings(sf::RenderWindow& window) {
-    static sf::Font font;
-    if (!font.loadFromFile("assets/fonts/arial.ttf")) {
-        std::cerr << "Failed to load font\n";
-        return;
-    }
-    sf::Text text("Settings - Click to return", font, 24);
+    sf::Font* font = uiFont();
+    if (!font) return;
+    sf::Text text("Settings - Click to return", *font, 24);
     text.setPosition(180, 300);
     window.draw(text);
 }
 
 void drawGameOver(sf::RenderWindow& window) {
-    static sf::Font font;
-    if (!font.loadFromFile("assets/fonts/arial.ttf")) {
-        std::cerr << "Failed to load font\n";
-        return;
-    }
+    sf::Font* font = uiFont();
+    if (!font) return;
     sf::RectangleShape overlay(sf::Vector2f(TILE_SIZE * BOARD_SIZE, TILE_SIZE * BOARD_SIZE));
     overlay.setFillColor(sf::Color(0, 0, 0, 150));
     window.draw(overlay);
-    sf::Text text(gameOverMessage + "\nClick to return to menu", font, 32);
+    sf::Text text(game.gameOverMessage + "\nClick to return to menu", *font, 32);
     text.setFillColor(sf::Color::White);
     sf::FloatRect bounds = text.getLocalBounds();
     text.setPosition((TILE_SIZE * BOARD_SIZE - bounds.width) / 2,
@@ -863,57 +293,668 @@ void drawGameOver(sf::RenderWindow& window) {
     window.draw(text);
 }
 
-#ifndef UNIT_TEST
-int main() {
-    sf::RenderWindow window(sf::VideoMode(800, 800), "C++ Chess");
-    loadTextures();
-    std::cout << "Program started" << std::endl;
+// Opening explorer backed by a game archive and its position index
+struct Explorer {
+    Archive archive;
+    PositionIndex index;
+    bool loaded = false;
+    bool visible = false;
+    uint64_t key = 0;                // position moves were looked up for, 0 before the first
+    std::vector<ExplorerMove> moves; // empty when the position is not in the database
+};
+Explorer explorer;
+
+// Analysis mode: the analyser searches whatever is on the board and the best
+// lines are drawn as arrows plus a text panel, refreshed after every depth
+struct AnalysisView {
+    std::unique_ptr<Analyzer> analyzer; // created on first use
+    std::size_t hashMb = 64;
+    std::string sharedHash;
+    bool visible = false;
+    int lines = 3;
+    uint64_t requestedKey = 0; // position handed to the analyser, 0 if none
+    AnalysisInfo info;
+};
+AnalysisView analysis;
+
+void drawExplorer(sf::RenderWindow& window) {
+    sf::Font* font = uiFont();
+    if (!font) return;
+    // Only look the position up again once it has changed; a miss is kept too
+    uint64_t key = zobristKey(game);
+    if (key != explorer.key) {
+        explorer.key = key;
+        explorer.moves = explorePosition(explorer.archive, explorer.index, key);
+    }
+
+    const int maxLines = 8;
+    int lines = std::min<int>(maxLines, static_cast<int>(explorer.moves.size()));
+    float height = 30.0f + 22.0f * std::max(lines, 1);
+    sf::RectangleShape panel(sf::Vector2f(TILE_SIZE * BOARD_SIZE, height));
+    panel.setPosition(0, TILE_SIZE * BOARD_SIZE - height);
+    panel.setFillColor(sf::Color(0, 0, 0, 190));
+    window.draw(panel);
+
+    long total = 0;
+    for (const auto& m : explorer.moves) total += m.games;
+    std::string body = "Explorer: " + std::to_string(total) + " games";
+    if (explorer.moves.empty()) body += "\nPosition not in the database";
+    char line[128];
+    for (int i = 0; i < lines; ++i) {
+        const ExplorerMove& m = explorer.moves[i];
+        std::snprintf(line, sizeof(line), "\n%-6s %7ld   white %3.0f%%  draw %3.0f%%  black %3.0f%%",
+                      packedMoveToString(m.move).c_str(), m.games, 100.0 * m.whiteWins / m.games,
+                      100.0 * m.draws / m.games, 100.0 * m.blackWins / m.games);
+        body += line;
+    }
+    sf::Text text(body, *font, 16);
+    text.setFillColor(sf::Color::White);
+    text.setPosition(10, TILE_SIZE * BOARD_SIZE - height + 6);
+    window.draw(text);
+}
 
-    while (window.isOpen()) {
-        sf::Event event;
-        while (window.pollEvent(event)) {
-            if (event.type == sf::Event::Closed)
-                window.close();
+// Decides when the main window has to be redrawn. Anything that changes what
+// is on screen calls invalidate(); while nothing is dirty the main loop sleeps
+// in waitEvent instead of redrawing an unchanged frame.
+struct RenderScheduler {
+    bool dirty = true;
+    bool showStats = false;
+
+    // Overlay figures, refreshed every STATS_INTERVAL
+    sf::Clock frameClock;
+    sf::Time lastFrameTime;
+    sf::Clock statsClock;
+    std::clock_t statsCpuStart = std::clock();
+    int framesSinceStats = 0;
+    float framesPerSecond = 0.0f;
+    float cpuPercent = 0.0f;
+    float firstFrameMs = 0.0f; // from process start to the first frame on screen
+    // Hot-path counters over the last interval, when built with CHESS_STATS
+    StatTotals statsAtTick;
+    float statPerSecond[STAT_ID_COUNT] = {};
+    float statAverageUs[STAT_ID_COUNT] = {};
+
+    static sf::Time statsInterval() { return sf::milliseconds(500); }
+
+    void invalidate() { dirty = true; }
+
+    // Waits for the next window event. With the overlay hidden nothing changes
+    // on its own, so this blocks indefinitely. SFML 2 has no waitEvent timeout,
+    // so with the overlay shown it polls with short sleeps until the next
+    // overlay refresh is due. Returns false if it timed out without an event.
+    bool waitEvent(sf::RenderWindow& window, sf::Event& event) {
+        if (!showStats) return window.waitEvent(event);
+        while (statsClock.getElapsedTime() < statsInterval()) {
+            if (window.pollEvent(event)) return true;
+            sf::sleep(sf::milliseconds(10));
+        }
+        return false;
+    }
 
-            if (event.type == sf::Event::MouseButtonPressed && event.mouseButton.button == sf::Mouse::Left) {
-                sf::Vector2i mousePos = sf::Mouse::getPosition(window);
-                if (gameState == GameState::MENU) {
-                    handleMenuClick(mousePos, window);
-                } else if (gameState == GameState::PLAYING) {
-                    int col = mousePos.x / TILE_SIZE;
-                    int row = mousePos.y / TILE_SIZE;
-                    movePiece(row, col, window);
-                } else if (gameState == GameState::SETTINGS) {
-                    gameState = GameState::MENU;
-                } else if (gameState == GameState::GAME_OVER) {
-                    gameState = GameState::MENU;
-                }
-            }
+    void tick() {
+        if (!showStats) return;
+        float elapsed = statsClock.getElapsedTime().asSeconds();
+        if (elapsed < statsInterval().asSeconds()) return;
+        std::clock_t now = std::clock();
+        float cpuSeconds = static_cast<float>(now - statsCpuStart) / CLOCKS_PER_SEC;
+        cpuPercent = 100.0f * cpuSeconds / elapsed;
+        framesPerSecond = framesSinceStats / elapsed;
+        framesSinceStats = 0;
+        StatTotals totals = statTotals();
+        for (int id = 0; id < STAT_ID_COUNT; ++id) {
+            uint64_t count = totals.count[id] - statsAtTick.count[id];
+            uint64_t ns = totals.nanoseconds[id] - statsAtTick.nanoseconds[id];
+            statPerSecond[id] = count / elapsed;
+            statAverageUs[id] = count ? ns / 1000.0f / count : 0.0f;
         }
+        statsAtTick = totals;
+        statsCpuStart = now;
+        statsClock.restart();
+        dirty = true;
+    }
+
+    void toggleStats() {
+        showStats = !showStats;
+        framesSinceStats = 0;
+        statsCpuStart = std::clock();
+        statsAtTick = statTotals();
+        statsClock.restart();
+        dirty = true;
+    }
+
+    void beginFrame() { frameClock.restart(); }
 
-        if (gameState == GameState::PLAYING && aiEnabled && !isWhiteTurn) {
-            aiMove(window);
+    void endFrame() {
+        lastFrameTime = frameClock.getElapsedTime();
+        ++framesSinceStats;
+        dirty = false;
+    }
+};
+
+// Height of the overlay: the frame line, then two columns of counters
+float statsOverlayHeight() {
+    return STATS_ENABLED ? 24.0f + 18.0f * ((STAT_ID_COUNT + 1) / 2) + 4.0f : 24.0f;
+}
+
+void drawStatsOverlay(sf::RenderWindow& window, const RenderScheduler& scheduler) {
+    sf::Font* font = uiFont();
+    if (!font) return;
+    char line[128];
+    std::snprintf(line, sizeof(line), "frame %.2f ms  redraws %.1f/s  cpu %.1f%%  startup %.0f ms",
+                  scheduler.lastFrameTime.asMicroseconds() / 1000.0f,
+                  scheduler.framesPerSecond, scheduler.cpuPercent, scheduler.firstFrameMs);
+    sf::RectangleShape background(sf::Vector2f(TILE_SIZE * BOARD_SIZE, statsOverlayHeight()));
+    background.setFillColor(sf::Color(0, 0, 0, 170));
+    sf::Text text(line, *font, 16);
+    text.setFillColor(sf::Color::White);
+    text.setPosition(6, 2);
+    window.draw(background);
+    window.draw(text);
+    if (!STATS_ENABLED) return;
+
+    // Calls per second and, for the timed ones, the average time per call
+    for (int id = 0; id < STAT_ID_COUNT; ++id) {
+        float x = 6.0f + (id % 2) * TILE_SIZE * BOARD_SIZE / 2.0f;
+        float y = 24.0f + 18.0f * (id / 2);
+        float rate = scheduler.statPerSecond[id];
+        char figures[64];
+        if (scheduler.statAverageUs[id] > 0) {
+            std::snprintf(figures, sizeof(figures), "%.0f/s  %.2f us", rate, scheduler.statAverageUs[id]);
+        } else {
+            std::snprintf(figures, sizeof(figures), "%.0f/s", rate);
         }
+        sf::Text name(statName(static_cast<StatId>(id)), *font, 14);
+        name.setFillColor(sf::Color(180, 180, 180));
+        name.setPosition(x, y);
+        sf::Text value(figures, *font, 14);
+        value.setFillColor(sf::Color::White);
+        value.setPosition(x + 140, y);
+        window.draw(name);
+        window.draw(value);
+    }
+}
+
+void handleEvent(const sf::Event& event, sf::RenderWindow& window, RenderScheduler& scheduler) {
+    if (event.type == sf::Event::Closed)
+        window.close();
+
+    if (event.type == sf::Event::Resized || event.type == sf::Event::GainedFocus)
+        scheduler.invalidate();
+
+    if (event.type == sf::Event::KeyPressed && event.key.code == sf::Keyboard::F3)
+        scheduler.toggleStats();
+
+    if (event.type == sf::Event::KeyPressed && event.key.code == sf::Keyboard::A) {
+        analysis.visible = !analysis.visible;
+        scheduler.invalidate();
+    }
+
+    if (event.type == sf::Event::KeyPressed && event.key.code == sf::Keyboard::E && explorer.loaded) {
+        explorer.visible = !explorer.visible;
+        scheduler.invalidate();
+    }
 
-        window.clear(gameState == GameState::MENU ? sf::Color(50, 50, 50) : sf::Color::Black);
+    if (event.type == sf::Event::MouseButtonPressed && event.mouseButton.button == sf::Mouse::Left) {
+        sf::Vector2i mousePos = sf::Mouse::getPosition(window);
         if (gameState == GameState::MENU) {
-            drawMenu(window);
+            handleMenuClick(mousePos, window);
         } else if (gameState == GameState::PLAYING) {
-            drawBoard(window);
-            drawMoveHints(window);
-            drawPieces(window);
+            int col = mousePos.x / TILE_SIZE;
+            int row = mousePos.y / TILE_SIZE;
+            handleBoardClick(row, col);
         } else if (gameState == GameState::SETTINGS) {
-            drawSettings(window);
+            gameState = GameState::MENU;
         } else if (gameState == GameState::GAME_OVER) {
-            drawBoard(window);
-            drawMoveHints(window);
-            drawPieces(window);
-            drawGameOver(window);
+            gameState = GameState::MENU;
         }
+        scheduler.invalidate();
+    }
+}
+
+// Hands the analyser a new position when the board changes and picks up
+// what it has found; never waits for the search
+void updateAnalysis(RenderScheduler& scheduler) {
+    bool wanted = analysis.visible && (gameState == GameState::PLAYING || gameState == GameState::GAME_OVER);
+    if (wanted) {
+        if (!analysis.analyzer) analysis.analyzer.reset(new Analyzer(analysis.hashMb, analysis.sharedHash));
+        uint64_t key = zobristKey(game);
+        if (key != analysis.requestedKey) {
+            analysis.analyzer->analyze(game, analysis.lines);
+            analysis.requestedKey = key;
+        }
+    } else if (analysis.requestedKey) {
+        analysis.analyzer->stop();
+        analysis.requestedKey = 0;
+    }
+    if (analysis.analyzer && analysis.analyzer->poll(analysis.info)) scheduler.invalidate();
+}
+
+// Score from white's point of view: "+0.35", or "#3" when white mates
+std::string whiteScoreText(int score, bool whiteToMove) {
+    if (score >= MATE_SCORE - MAX_PLY || score <= -MATE_SCORE + MAX_PLY) {
+        std::string text = scoreToString(score);
+        if (whiteToMove) return text;
+        return text[1] == '-' ? "#" + text.substr(2) : "#-" + text.substr(1);
+    }
+    char text[16];
+    std::snprintf(text, sizeof(text), "%+.2f", (whiteToMove ? score : -score) / 100.0);
+    return text;
+}
+
+void drawArrow(sf::RenderWindow& window, uint16_t move, float width, sf::Color color) {
+    std::string promotion;
+    AIMove m = unpackMove(move, promotion);
+    sf::Vector2f from((m.sc + 0.5f) * TILE_SIZE, (m.sr + 0.5f) * TILE_SIZE);
+    float dx = (m.ec - m.sc) * static_cast<float>(TILE_SIZE);
+    float dy = (m.er - m.sr) * static_cast<float>(TILE_SIZE);
+    float length = std::sqrt(dx * dx + dy * dy);
+    float angle = std::atan2(dy, dx) * 180.0f / 3.14159265f;
+    float head = width * 2.2f;
+
+    sf::RectangleShape shaft(sf::Vector2f(std::max(length - head, 0.0f), width));
+    shaft.setOrigin(0, width / 2);
+    shaft.setPosition(from);
+    shaft.setRotation(angle);
+    shaft.setFillColor(color);
+    window.draw(shaft);
+
+    sf::ConvexShape tip(3);
+    tip.setPoint(0, sf::Vector2f(length - head, -head * 0.8f));
+    tip.setPoint(1, sf::Vector2f(length, 0));
+    tip.setPoint(2, sf::Vector2f(length - head, head * 0.8f));
+    tip.setPosition(from);
+    tip.setRotation(angle);
+    tip.setFillColor(color);
+    window.draw(tip);
+}
+
+void drawAnalysis(sf::RenderWindow& window, float top) {
+    const AnalysisInfo& info = analysis.info;
+    // Lines of the previous position are not shown once the board has moved on
+    if (info.key != zobristKey(game)) return;
+    // Worst line first, so the best arrow ends up on top
+    for (std::size_t i = info.lines.size(); i-- > 0;) {
+        if (info.lines[i].moves.empty()) continue;
+        bool best = i == 0;
+        sf::Color color = best ? sf::Color(30, 150, 60, 200) : sf::Color(50, 100, 200, static_cast<sf::Uint8>(170 - 30 * std::min<std::size_t>(i, 4)));
+        drawArrow(window, info.lines[i].moves[0], best ? 14.0f : 9.0f, color);
+    }
+
+    sf::Font* font = uiFont();
+    if (!font) return;
+    char line[160];
+    double seconds = info.elapsedMs / 1000.0;
+    std::snprintf(line, sizeof(line), "Analysis  depth %d  %llu nodes  %.0f knps", info.depth,
+                  static_cast<unsigned long long>(info.nodes), seconds > 0 ? info.nodes / seconds / 1000 : 0.0);
+    std::string body = info.depth ? line : "Analysis  searching...";
+    const std::size_t maxMoves = 10;
+    for (const PvLine& pv : info.lines) {
+        body += "\n" + whiteScoreText(pv.score, game.isWhiteTurn) + "  ";
+        for (std::size_t i = 0; i < pv.moves.size() && i < maxMoves; ++i) body += " " + packedMoveToString(pv.moves[i]);
+    }
+    float height = 30.0f + 20.0f * info.lines.size();
+    sf::RectangleShape panel(sf::Vector2f(TILE_SIZE * BOARD_SIZE, height));
+    panel.setPosition(0, top);
+    panel.setFillColor(sf::Color(0, 0, 0, 170));
+    window.draw(panel);
+    sf::Text text(body, *font, 16);
+    text.setFillColor(sf::Color::White);
+    text.setPosition(10, top + 4);
+    window.draw(text);
+}
+
+void drawFrame(sf::RenderWindow& window, RenderScheduler& scheduler) {
+    CHESS_TIME(STAT_RENDER);
+    scheduler.beginFrame();
+    window.clear(gameState == GameState::MENU ? sf::Color(50, 50, 50) : sf::Color::Black);
+    if (gameState == GameState::MENU) {
+        drawMenu(window);
+    } else if (gameState == GameState::PLAYING) {
+        drawBoard(window);
+        drawMoveHints(window);
+        drawPieces(window);
+        if (analysis.visible) drawAnalysis(window, scheduler.showStats ? statsOverlayHeight() : 0.0f);
+        if (explorer.visible) drawExplorer(window);
+    } else if (gameState == GameState::SETTINGS) {
+        drawSettings(window);
+    } else if (gameState == GameState::GAME_OVER) {
+        drawBoard(window);
+        drawMoveHints(window);
+        drawPieces(window);
+        if (analysis.visible) drawAnalysis(window, scheduler.showStats ? statsOverlayHeight() : 0.0f);
+        drawGameOver(window);
+    }
+    if (scheduler.showStats) drawStatsOverlay(window, scheduler);
+    window.display();
+    scheduler.endFrame();
+}
+
+bool aiTurnPending() {
+    return gameState == GameState::PLAYING && aiEnabled && !game.isWhiteTurn;
+}
+
+// Starts the engine on its move, or plays the move once it is found. The
+// search runs on the engine's thread, so the window stays responsive.
+void updateEngine(RenderScheduler& scheduler) {
+    if (!aiTurnPending()) return;
+    if (!engineThinking) {
+        engine->think(game, gameClock.control(false));
+        engineThinking = true;
+        return;
+    }
+    SearchResult result;
+    if (!engine->resultReady(result)) return;
+    engineThinking = false;
+    std::string promotion;
+    if (result.bestMove == 0 || !applyMove(game, unpackMove(result.bestMove, promotion), promotion)) {
+        LOG_ERROR("Engine found no move");
+        return;
+    }
+    gameClock.update(game);
+    syncGameOver();
+    scheduler.invalidate();
+    // Think on the human's time about the reply the engine expects
+    if (ponderEnabled && gameState == GameState::PLAYING) engine->ponder(game);
+}
+
+// Ends the game when the side to move runs out of time
+void checkFlag(RenderScheduler& scheduler) {
+    if (gameState != GameState::PLAYING || gameClock.remaining(game.isWhiteTurn) > 0) return;
+    gameClock.stop();
+    if (engine) engine->stop();
+    engineThinking = false;
+    game.gameOverMessage = game.isWhiteTurn ? "Black wins on time" : "White wins on time";
+    gameState = GameState::GAME_OVER;
+    // Nothing else is pending now, so the loop would wait for input before drawing this
+    scheduler.invalidate();
+}
+
+void updateTitle(sf::RenderWindow& window) {
+    static std::string shown;
+    std::string title = "C++ Chess";
+    if (gameState == GameState::PLAYING || gameState == GameState::GAME_OVER) {
+        title += "  White " + formatClock(gameClock.remaining(true)) + "  Black " +
+                 formatClock(gameClock.remaining(false));
+    }
+    if (title != shown) {
+        window.setTitle(title);
+        shown = title;
+    }
+}
+
+// Spectator mode: the boards of a SpectatorMatch tiled in the window. The
+// squares of all boards are one vertex array, built once, and the pieces
+// another with a quad per square of every board, textured from the atlas and
+// transparent while the square is empty. An update rewrites the four vertices
+// of its square, so a frame is two draw calls however many boards are shown.
+struct SpectatorView {
+    int columns = 1;
+    float boardSize = 0;
+    sf::VertexArray squares{sf::Quads};
+    sf::VertexArray pieces{sf::Quads};
+
+    static void setQuad(sf::Vertex* quad, float left, float top, float size, sf::Color color) {
+        quad[0].position = sf::Vector2f(left, top);
+        quad[1].position = sf::Vector2f(left + size, top);
+        quad[2].position = sf::Vector2f(left + size, top + size);
+        quad[3].position = sf::Vector2f(left, top + size);
+        for (int i = 0; i < 4; ++i) quad[i].color = color;
+    }
+
+    void layout(int boards, float windowSize) {
+        columns = static_cast<int>(std::ceil(std::sqrt(static_cast<float>(boards))));
+        boardSize = windowSize / columns;
+        float tile = (boardSize - 2.0f) / BOARD_SIZE; // leaves a gap between boards
+        std::size_t vertices = static_cast<std::size_t>(boards) * BOARD_SIZE * BOARD_SIZE * 4;
+        squares.resize(vertices);
+        pieces.resize(vertices);
+        for (int b = 0; b < boards; ++b) {
+            for (int square = 0; square < BOARD_SIZE * BOARD_SIZE; ++square) {
+                int row = square / BOARD_SIZE;
+                int col = square % BOARD_SIZE;
+                float left = (b % columns) * boardSize + col * tile;
+                float top = (b / columns) * boardSize + row * tile;
+                std::size_t first = (static_cast<std::size_t>(b) * BOARD_SIZE * BOARD_SIZE + square) * 4;
+                bool light = (row + col) % 2 == 0;
+                setQuad(&squares[first], left, top, tile, light ? sf::Color(240, 217, 181) : sf::Color(181, 136, 99));
+                setQuad(&pieces[first], left, top, tile, sf::Color::Transparent);
+            }
+        }
+    }
+
+    void apply(const SquareUpdate& update) {
+        sf::Vertex* quad = &pieces[(static_cast<std::size_t>(update.board) * BOARD_SIZE * BOARD_SIZE + update.square) * 4];
+        if (update.piece < 0) {
+            for (int i = 0; i < 4; ++i) quad[i].color = sf::Color::Transparent;
+            return;
+        }
+        sf::IntRect rect = pieceRect(update.piece);
+        float left = static_cast<float>(rect.left);
+        float top = static_cast<float>(rect.top);
+        quad[0].texCoords = sf::Vector2f(left, top);
+        quad[1].texCoords = sf::Vector2f(left + rect.width, top);
+        quad[2].texCoords = sf::Vector2f(left + rect.width, top + rect.height);
+        quad[3].texCoords = sf::Vector2f(left, top + rect.height);
+        for (int i = 0; i < 4; ++i) quad[i].color = sf::Color::White;
+    }
+
+    void draw(sf::RenderWindow& window) {
+        window.draw(squares);
+        window.draw(pieces, &pieceAtlas);
+    }
+};
+
+// Watches the match instead of playing. Between frames the loop only drains
+// the workers' updates; it redraws when one came in or the overlay is due.
+int runSpectator(sf::RenderWindow& window, RenderScheduler& scheduler, const SpectatorSettings& settings) {
+    SpectatorMatch match(settings);
+    SpectatorView view;
+    view.layout(match.boards(), TILE_SIZE * BOARD_SIZE);
+    std::vector<SquareUpdate> updates;
+    uint64_t finishedShown = UINT64_MAX;
+    while (window.isOpen()) {
+        sf::Event event;
+        while (window.pollEvent(event)) {
+            if (event.type == sf::Event::Closed) {
+                window.close();
+            } else if (event.type == sf::Event::Resized || event.type == sf::Event::GainedFocus) {
+                scheduler.invalidate();
+            } else if (event.type == sf::Event::KeyPressed && event.key.code == sf::Keyboard::F3) {
+                scheduler.toggleStats();
+            }
+        }
+        scheduler.tick();
+        if (!window.isOpen()) break;
+
+        updates.clear();
+        if (match.drain(updates)) {
+            for (const SquareUpdate& update : updates) view.apply(update);
+            scheduler.invalidate();
+        }
+        if (match.gamesFinished() != finishedShown) {
+            finishedShown = match.gamesFinished();
+            window.setTitle("C++ Chess  spectating " + std::to_string(match.boards()) + " games, " +
+                            std::to_string(finishedShown) + " finished");
+        }
+        if (!scheduler.dirty) {
+            sf::sleep(sf::milliseconds(16));
+            continue;
+        }
+        CHESS_TIME(STAT_RENDER);
+        scheduler.beginFrame();
+        window.clear(sf::Color(50, 50, 50));
+        view.draw(window);
+        if (scheduler.showStats) drawStatsOverlay(window, scheduler);
         window.display();
+        scheduler.endFrame();
+    }
+    match.stop();
+    return 0;
+}
+
+// Usage: chess [--vsync] [--fps N] [--stats] [--explorer games.cga games.cgi]
+//              [--clock MIN+INC] [--hash MB] [--shared-hash NAME] [--no-ponder] [--chatgpt]
+//              [--analysis N] [--log LEVEL] [--stats-log FILE] [--time-startup]
+//              [--spectate N] [--spectate-nodes N]
+// --stats (or F3 in game) shows frame time, redraw rate and process CPU use,
+// and the hot-path counters in a CHESS_STATS build; --stats-log also appends
+// the counters to FILE as a JSON line every second.
+// --log sets the console log level: off, error, warn (default), info for
+// every move played, or debug for rejected moves too.
+// --explorer loads a game archive built with chess_archive; E toggles the panel.
+// --clock sets both clocks, minutes plus seconds of increment (default 5+2).
+// --shared-hash puts the engine's and the analyser's table in the named
+// shared-memory segment, shared with other engines on this host.
+// The engine ponders on the human's time unless --no-ponder is given;
+// --chatgpt plays the ChatGPT opponent instead, without a clock.
+// --analysis shows the N best lines of the position from the start; A toggles
+// the analysis overlay (3 lines unless given).
+// --time-startup prints the time from launch to the first frame and quits;
+// the same figure is in the --stats overlay and logged at info level.
+// --spectate watches N engine games played against themselves on background
+// threads, tiled in the window, at up to 60 frames a second unless --fps or
+// --vsync say otherwise; --spectate-nodes is the search budget per move.
+int main(int argc, char* argv[]) {
+    RenderScheduler scheduler;
+    bool vsync = false;
+    unsigned frameLimit = 0;
+    std::size_t hashMb = 64;
+    std::string sharedHash;
+    bool timeStartup = false;
+    std::unique_ptr<StatsDump> statsDump;
+    SpectatorSettings spectator;
+    spectator.boards = 0;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--vsync") {
+            vsync = true;
+        } else if (arg == "--fps" && i + 1 < argc) {
+            frameLimit = static_cast<unsigned>(std::atoi(argv[++i]));
+        } else if (arg == "--stats") {
+            scheduler.showStats = true;
+        } else if (arg == "--explorer" && i + 2 < argc) {
+            std::string error;
+            std::string archivePath = argv[++i];
+            std::string indexPath = argv[++i];
+            if (explorer.archive.open(archivePath, error) && explorer.index.open(indexPath, error)) {
+                explorer.loaded = true;
+                explorer.visible = true;
+            } else {
+                LOG_WARN("Explorer disabled: " << error);
+            }
+        } else if (arg == "--clock" && i + 1 < argc) {
+            double minutes = 0;
+            double increment = 0;
+            if (std::sscanf(argv[++i], "%lf+%lf", &minutes, &increment) >= 1 && minutes > 0) {
+                gameClock.initialMs = static_cast<int64_t>(minutes * 60000);
+                gameClock.incrementMs = static_cast<int64_t>(increment * 1000);
+            } else {
+                LOG_WARN("Ignoring bad --clock " << argv[i]);
+            }
+        } else if (arg == "--hash" && i + 1 < argc) {
+            hashMb = static_cast<std::size_t>(std::max(1, std::atoi(argv[++i])));
+        } else if (arg == "--shared-hash" && i + 1 < argc) {
+            sharedHash = argv[++i];
+        } else if (arg == "--spectate" && i + 1 < argc) {
+            spectator.boards = std::min(std::max(std::atoi(argv[++i]), 1), 256);
+        } else if (arg == "--spectate-nodes" && i + 1 < argc) {
+            spectator.nodes = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--time-startup") {
+            timeStartup = true;
+        } else if (arg == "--no-ponder") {
+            ponderEnabled = false;
+        } else if (arg == "--chatgpt") {
+            useChatGpt = true;
+        } else if (arg == "--analysis" && i + 1 < argc) {
+            analysis.lines = std::min(std::max(std::atoi(argv[++i]), 1), 8);
+            analysis.visible = true;
+        } else if (arg == "--log" && i + 1 < argc) {
+            LogLevel level;
+            if (parseLogLevel(argv[++i], level)) {
+                setLogLevel(level);
+            } else {
+                LOG_WARN("Ignoring bad --log " << argv[i]);
+            }
+        } else if (arg == "--stats-log" && i + 1 < argc) {
+            statsDump.reset(new StatsDump(argv[++i]));
+            if (!statsDump->ok()) {
+                LOG_WARN("Cannot write stats to " << argv[i]);
+                statsDump.reset();
+            }
+        }
+    }
+    bool spectating = spectator.boards > 0;
+    if (!useChatGpt && !spectating) engine.reset(new Engine(hashMb, sharedHash));
+    analysis.hashMb = hashMb;
+    analysis.sharedHash = sharedHash;
+
+    sf::RenderWindow window(sf::VideoMode(800, 800), "C++ Chess");
+    // SFML advises against combining the two, so an explicit cap wins
+    if (frameLimit > 0) {
+        window.setFramerateLimit(frameLimit);
+    } else if (spectating && !vsync) {
+        window.setFramerateLimit(60);
+    } else {
+        window.setVerticalSyncEnabled(vsync);
+    }
+    if (!loadTextures()) {
+        LOG_ERROR("Cannot create the piece texture");
+        return 1;
+    }
+    LOG_INFO("Program started");
+    if (spectating) return runSpectator(window, scheduler, spectator);
+
+    while (window.isOpen()) {
+        sf::Event event;
+        // The clocks tick while a game is on and analysis streams in while
+        // it is shown, so keep waking up for them then. Otherwise sleep until
+        // something happens unless a frame or an AI move is outstanding.
+        bool clocksRunning = gameState == GameState::PLAYING && !useChatGpt;
+        bool analysing = analysis.requestedKey != 0;
+        if (clocksRunning || analysing) {
+            if (!scheduler.dirty) sf::sleep(sf::milliseconds(engineThinking ? 5 : 20));
+        } else if (!scheduler.dirty && !aiTurnPending() && scheduler.waitEvent(window, event)) {
+            handleEvent(event, window, scheduler);
+        }
+        while (window.pollEvent(event)) {
+            handleEvent(event, window, scheduler);
+        }
+        scheduler.tick();
+        if (!window.isOpen()) break;
+
+        if (!useChatGpt) {
+            gameClock.update(game);
+            checkFlag(scheduler);
+            updateTitle(window);
+        }
+
+        updateAnalysis(scheduler);
+        if (scheduler.dirty) {
+            drawFrame(window, scheduler);
+            if (scheduler.firstFrameMs == 0) {
+                scheduler.firstFrameMs =
+                    std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - processStart).count();
+                LOG_INFO("First frame after " << scheduler.firstFrameMs << " ms");
+                if (timeStartup) {
+                    std::printf("startup: %.1f ms to first frame\n", scheduler.firstFrameMs);
+                    window.close();
+                }
+            }
+        }
+
+        if (useChatGpt) {
+            // The human's move is already on screen, so the AI can take its time
+            if (aiTurnPending()) {
+                aiMove(game);
+                syncGameOver();
+                scheduler.invalidate();
+            }
+        } else {
+            updateEngine(scheduler);
+        }
     }
+    if (engine) engine->stop();
+    analysis.analyzer.reset();
 
-    clearBoard();
     return 0;
 }
-#endif
@@ -0,0 +1,45 @@
+#include "mapped_file.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+bool MappedFile::open(const std::string& path, std::string& error) {
+    close();
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        error = path + ": " + std::strerror(errno);
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        error = path + ": " + std::strerror(errno);
+        ::close(fd);
+        return false;
+    }
+    length = static_cast<std::size_t>(st.st_size);
+    if (length > 0) {
+        void* p = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p == MAP_FAILED) {
+            error = path + ": " + std::strerror(errno);
+            length = 0;
+            ::close(fd);
+            return false;
+        }
+        base = static_cast<const char*>(p);
+    }
+    ::close(fd);
+    return true;
+}
+
+void MappedFile::close() {
+    if (base) munmap(const_cast<char*>(base), length);
+    base = nullptr;
+    length = 0;
+}
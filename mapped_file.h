@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+// Read-only memory mapping of a whole file. Pages are loaded on demand, so
+// huge files can be scanned without reading them into memory first.
+class MappedFile {
+public:
+    MappedFile() = default;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile();
+
+    // Returns false and fills error if the file cannot be opened or mapped
+    bool open(const std::string& path, std::string& error);
+    void close();
+
+    const char* data() const { return base; }
+    std::size_t size() const { return length; }
+    std::string_view view() const { return std::string_view(base, length); }
+
+private:
+    const char* base = nullptr;
+    std::size_t length = 0;
+};
@@ -0,0 +1,324 @@
+#include "mate.h"
+#include <algorithm>
+#include <cstdlib>
+
+// A node with pn PN_INFINITE is disproven, one with dn PN_INFINITE proven.
+// Sums of finite numbers stop just short of it.
+const uint32_t PN_INFINITE = 1u << 30;
+
+static const char* const PROMOTIONS[] = {"queen", "rook", "bishop", "knight"};
+
+ProofTable::ProofTable(std::size_t megabytes) {
+    std::size_t count = 1;
+    while (count * 2 * sizeof(Entry) <= megabytes * 1024 * 1024) count *= 2;
+    entries.reset(new Entry[count]);
+    mask = count - 1;
+}
+
+const ProofTable::Entry* ProofTable::probe(uint64_t key) const {
+    const Entry& entry = entries[key & mask];
+    // Stored entries never have both numbers zero, empty slots do
+    return entry.key == key && (entry.pn | entry.dn) ? &entry : nullptr;
+}
+
+void ProofTable::store(const Entry& entry) {
+    entries[entry.key & mask] = entry;
+}
+
+void ProofTable::clear() {
+    std::fill(entries.get(), entries.get() + mask + 1, Entry());
+}
+
+static bool isPawn(const Piece* p) { return p->type.find("pawn") != std::string::npos; }
+static bool isKing(const Piece* p) { return p->type.find("king") != std::string::npos; }
+
+// Whether a piece of this type on (row, col) hits the king square when
+// nothing is in the way
+static bool couldAttack(const std::string& type, bool white, int row, int col, int kRow, int kCol) {
+    int dr = kRow - row;
+    int dc = kCol - col;
+    int adr = std::abs(dr);
+    int adc = std::abs(dc);
+    if (type.find("knight") != std::string::npos) return (adr == 1 && adc == 2) || (adr == 2 && adc == 1);
+    if (type.find("pawn") != std::string::npos) return dr == (white ? -1 : 1) && adc == 1;
+    bool diagonal = adr == adc && adr != 0;
+    bool straight = (dr == 0) != (dc == 0);
+    if (type.find("bishop") != std::string::npos) return diagonal;
+    if (type.find("rook") != std::string::npos) return straight;
+    if (type.find("queen") != std::string::npos) return diagonal || straight;
+    return false;
+}
+
+// Whether a piece leaving (row, col) could uncover a line to the king
+static bool onKingLine(int row, int col, int kRow, int kCol) {
+    return row == kRow || col == kCol || std::abs(row - kRow) == std::abs(col - kCol);
+}
+
+// Only moves that land on an attacking square, leave a line to the king, or
+// castle or capture en passant can give check; those few are played and the
+// king square tested with isSquareAttacked()
+static void checkingMoves(Game& game, std::vector<AIMove>& scratch, std::vector<uint16_t>& moves) {
+    moves.clear();
+    bool white = game.isWhiteTurn;
+    int kRow, kCol;
+    findKing(game, !white, kRow, kCol);
+    if (kRow == -1) return;
+    generateLegalMoves(game, white, scratch);
+    for (const AIMove& m : scratch) {
+        Piece* p = game.board[m.sr][m.sc];
+        bool pawn = isPawn(p);
+        bool promotes = pawn && (m.er == 0 || m.er == BOARD_SIZE - 1);
+        bool special = (isKing(p) && std::abs(m.ec - m.sc) == 2) ||
+                       (pawn && m.sc != m.ec && !game.board[m.er][m.ec]);
+        bool discovered = onKingLine(m.sr, m.sc, kRow, kCol);
+        for (int i = 0; i < (promotes ? 4 : 1); ++i) {
+            std::string promotion = PROMOTIONS[i];
+            const std::string& type = promotes ? promotion : p->type;
+            if (!special && !discovered && !couldAttack(type, white, m.er, m.ec, kRow, kCol)) continue;
+            MoveUndo undo;
+            makeMove(game, m, undo, promotion);
+            bool check = isSquareAttacked(game, kRow, kCol, white);
+            unmakeMove(game, m, undo);
+            if (check) moves.push_back(packMove(game, m, promotion));
+        }
+    }
+}
+
+void generateCheckingMoves(Game& game, std::vector<uint16_t>& moves) {
+    std::vector<AIMove> scratch;
+    checkingMoves(game, scratch, moves);
+}
+
+// Every legal reply, with one entry per promotion piece
+static void allMoves(Game& game, std::vector<AIMove>& scratch, std::vector<uint16_t>& moves) {
+    moves.clear();
+    generateLegalMoves(game, game.isWhiteTurn, scratch);
+    for (const AIMove& m : scratch) {
+        bool promotes = isPawn(game.board[m.sr][m.sc]) && (m.er == 0 || m.er == BOARD_SIZE - 1);
+        for (int i = 0; i < (promotes ? 4 : 1); ++i) moves.push_back(packMove(game, m, PROMOTIONS[i]));
+    }
+}
+
+struct Proof {
+    uint32_t pn;
+    uint32_t dn;
+    int distance; // plies to mate, once proven
+};
+
+struct Child {
+    uint16_t move;
+    uint64_t key;
+    Proof proof;
+};
+
+struct MateSolver {
+    MateSolver(ProofTable& table, Game& game) : table(table), game(game) {}
+
+    ProofTable& table;
+    Game& game;
+    bool checksOnly = true;
+    uint64_t nodeLimit = 0;
+    std::function<bool()> abort;
+    uint64_t nodes = 0;
+    bool stopped = false;
+    std::vector<uint64_t> path; // keys from the root to the current node
+    std::vector<Child> children[MAX_PLY];
+    std::vector<AIMove> scratch;
+    std::vector<uint16_t> moves;
+};
+
+static uint32_t addProof(uint32_t a, uint32_t b) {
+    if (a >= PN_INFINITE || b >= PN_INFINITE) return PN_INFINITE;
+    return static_cast<uint32_t>(std::min<uint64_t>(uint64_t(a) + b, PN_INFINITE - 1));
+}
+
+// What the table knows about a position with this many plies to go. A proof
+// holds at any depth it fits in; a disproof only if it looked at least as deep.
+static Proof lookup(const ProofTable& table, uint64_t key, int remaining) {
+    const ProofTable::Entry* entry = table.probe(key);
+    if (!entry) return {1, 1, 0};
+    if (entry->pn == 0) return entry->distance <= remaining ? Proof{0, PN_INFINITE, entry->distance} : Proof{1, 1, 0};
+    if (entry->dn == 0) return entry->remaining >= remaining ? Proof{PN_INFINITE, 0, 0} : Proof{1, 1, 0};
+    return {entry->pn, entry->dn, 0};
+}
+
+static void playPacked(Game& game, uint16_t packed, AIMove& move, MoveUndo& undo) {
+    std::string promotion;
+    move = unpackMove(packed, promotion);
+    makeMove(game, move, undo, promotion);
+}
+
+static bool sideToMoveInCheck(const Game& game) {
+    int kRow, kCol;
+    findKing(game, game.isWhiteTurn, kRow, kCol);
+    return kRow != -1 && isSquareAttacked(game, kRow, kCol, !game.isWhiteTurn);
+}
+
+static bool outOfNodes(MateSolver& s) {
+    if (s.nodeLimit && s.nodes >= s.nodeLimit) s.stopped = true;
+    if (s.abort && (s.nodes & 1023) == 0 && s.abort()) s.stopped = true;
+    return s.stopped;
+}
+
+// Fills the children of the current node with what the table knows of them.
+// A child repeating a position on the path is a draw, so it counts as
+// disproven; proofs never depend on the path, so they stay sound.
+static void expand(MateSolver& s, int ply, int remaining) {
+    if (ply % 2 == 0 && s.checksOnly) checkingMoves(s.game, s.scratch, s.moves);
+    else allMoves(s.game, s.scratch, s.moves);
+    std::vector<Child>& children = s.children[ply];
+    children.clear();
+    for (uint16_t packed : s.moves) {
+        AIMove m;
+        MoveUndo undo;
+        playPacked(s.game, packed, m, undo);
+        uint64_t key = zobristKey(s.game);
+        unmakeMove(s.game, m, undo);
+        bool repeats = std::find(s.path.begin(), s.path.end(), key) != s.path.end();
+        Proof proof = repeats ? Proof{PN_INFINITE, 0, 0} : lookup(s.table, key, remaining - 1);
+        children.push_back({packed, key, proof});
+    }
+}
+
+// Multiple iterative deepening: searches the current node (the attacker to
+// move on even plies) until its proof number reaches thresholdPn or its
+// disproof number thresholdDn, then stores and returns its numbers
+static Proof mid(MateSolver& s, int ply, int remaining, uint32_t thresholdPn, uint32_t thresholdDn) {
+    ++s.nodes;
+    bool attacker = ply % 2 == 0;
+    ProofTable::Entry entry;
+    entry.key = s.path.back();
+    entry.remaining = static_cast<uint8_t>(remaining);
+    const Proof proven{0, PN_INFINITE, 0};
+    const Proof disproven{PN_INFINITE, 0, 0};
+    Proof node;
+    if (!attacker && remaining == 0) {
+        // Out of moves: only mate counts
+        node = !hasAnyLegalMoves(s.game, s.game.isWhiteTurn) && sideToMoveInCheck(s.game) ? proven : disproven;
+    } else {
+        expand(s, ply, remaining);
+        std::vector<Child>& children = s.children[ply];
+        if (children.empty()) {
+            // Nothing to try is a failure for the attacker; for the defender it
+            // is mate, or stalemate after a quiet attacker move
+            node = !attacker && sideToMoveInCheck(s.game) ? proven : disproven;
+        }
+        while (!children.empty()) {
+            // The attacker needs one child proven, the defender all of them
+            std::size_t best = 0;
+            uint32_t second = PN_INFINITE;
+            node = attacker ? disproven : proven;
+            int distance = attacker ? MAX_PLY : 0;
+            for (std::size_t i = 0; i < children.size(); ++i) {
+                const Proof& c = children[i].proof;
+                uint32_t key = attacker ? c.pn : c.dn;
+                uint32_t bestKey = attacker ? children[best].proof.pn : children[best].proof.dn;
+                if (i == 0 || key < bestKey) {
+                    if (i > 0) second = bestKey;
+                    best = i;
+                } else if (key < second) {
+                    second = key;
+                }
+                if (attacker) {
+                    node.pn = std::min(node.pn, c.pn);
+                    node.dn = addProof(node.dn, c.dn);
+                    if (c.pn == 0) distance = std::min(distance, c.distance);
+                } else {
+                    node.pn = addProof(node.pn, c.pn);
+                    node.dn = std::min(node.dn, c.dn);
+                    distance = std::max(distance, c.distance);
+                }
+            }
+            if (node.pn == 0) node.distance = distance + 1;
+            if (node.pn == 0 || node.dn == 0 || node.pn >= thresholdPn || node.dn >= thresholdDn || s.stopped) break;
+            if (outOfNodes(s)) break;
+
+            // The child may go a quarter past the runner-up before control
+            // comes back (the 1 + epsilon trick); with a margin of one, nodes
+            // whose numbers are close thrash between siblings
+            Child& child = children[best];
+            uint32_t childPn, childDn;
+            if (attacker) {
+                childPn = std::min<uint64_t>(thresholdPn, second + second / 4 + 1);
+                childDn = static_cast<uint32_t>(std::min<uint64_t>(PN_INFINITE, uint64_t(thresholdDn) - node.dn + child.proof.dn));
+            } else {
+                childDn = std::min<uint64_t>(thresholdDn, second + second / 4 + 1);
+                childPn = static_cast<uint32_t>(std::min<uint64_t>(PN_INFINITE, uint64_t(thresholdPn) - node.pn + child.proof.pn));
+            }
+            AIMove m;
+            MoveUndo undo;
+            playPacked(s.game, child.move, m, undo);
+            s.path.push_back(child.key);
+            child.proof = mid(s, ply + 1, remaining - 1, childPn, childDn);
+            s.path.pop_back();
+            unmakeMove(s.game, m, undo);
+        }
+    }
+    entry.pn = node.pn;
+    entry.dn = node.dn;
+    entry.distance = static_cast<uint8_t>(node.pn == 0 ? node.distance : 0);
+    s.table.store(entry);
+    return node;
+}
+
+// Walks the proof from the root: the attacker's quickest proven move, the
+// defender's longest resistance. Nodes whose children were pushed out of the
+// table are simply proven again.
+static std::vector<uint16_t> extractLine(MateSolver& s, int plies) {
+    std::vector<uint16_t> line;
+    std::vector<std::pair<AIMove, MoveUndo>> played;
+    s.nodeLimit = 0;
+    s.abort = nullptr;
+    s.stopped = false;
+    for (int ply = 0; ply < plies; ++ply) {
+        bool attacker = ply % 2 == 0;
+        if (!attacker && !hasAnyLegalMoves(s.game, s.game.isWhiteTurn)) break;
+        Proof proof = mid(s, ply, plies - ply, PN_INFINITE, PN_INFINITE);
+        if (proof.pn != 0) break;
+        const std::vector<Child>& children = s.children[ply];
+        const Child* chosen = nullptr;
+        for (const Child& c : children) {
+            if (c.proof.pn != 0) continue;
+            if (!chosen || (attacker ? c.proof.distance < chosen->proof.distance
+                                     : c.proof.distance > chosen->proof.distance)) {
+                chosen = &c;
+            }
+        }
+        if (!chosen) break;
+        line.push_back(chosen->move);
+        played.emplace_back();
+        playPacked(s.game, chosen->move, played.back().first, played.back().second);
+        s.path.push_back(chosen->key);
+    }
+    for (auto it = played.rbegin(); it != played.rend(); ++it) unmakeMove(s.game, it->first, it->second);
+    return line;
+}
+
+MateResult solveMate(ProofTable& table, Game& game, const MateLimits& limits) {
+    MateSolver s(table, game);
+    s.checksOnly = limits.checksOnly;
+    s.nodeLimit = limits.nodes;
+    s.abort = limits.abort;
+    MateResult result;
+    int maxMoves = std::max(1, std::min(limits.maxMoves, MAX_MATE_MOVES));
+    uint64_t rootKey = zobristKey(game);
+    // One attacker move more each time, so the first proof is the shortest mate
+    for (int moves = 1; moves <= maxMoves; ++moves) {
+        s.path.assign(1, rootKey);
+        Proof root = mid(s, 0, 2 * moves - 1, PN_INFINITE, PN_INFINITE);
+        if (root.pn == 0) {
+            result.mateIn = moves;
+            uint64_t searched = s.nodes;
+            s.path.assign(1, rootKey);
+            result.line = extractLine(s, 2 * moves - 1);
+            s.nodes = searched;
+            break;
+        }
+        if (s.stopped) {
+            result.complete = false;
+            break;
+        }
+    }
+    result.nodes = s.nodes;
+    return result;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "search.h"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+// Forced mate prover for puzzle work: depth-first proof-number search (df-pn).
+// By default the attacker only plays checks while the defender gets every
+// legal reply, so the tree stays narrow where alpha-beta would have to look at
+// everything. Mates are searched for with one attacker move more per
+// iteration, so the first one proven is the shortest.
+
+const int MAX_MATE_MOVES = (MAX_PLY - 1) / 2;
+
+// Proof and disproof numbers of positions, in a table of its own since they
+// have nothing in common with alpha-beta bounds. Direct mapped and always
+// replacing, for one thread.
+class ProofTable {
+public:
+    struct Entry {
+        uint64_t key = 0;
+        uint32_t pn = 0;
+        uint32_t dn = 0;
+        uint8_t remaining = 0; // plies the numbers were worked out with
+        uint8_t distance = 0;  // plies to mate once proven
+    };
+
+    explicit ProofTable(std::size_t megabytes);
+    const Entry* probe(uint64_t key) const;
+    void store(const Entry& entry);
+    void clear();
+    std::size_t size() const { return mask + 1; }
+
+private:
+    std::unique_ptr<Entry[]> entries;
+    uint64_t mask = 0;
+};
+
+struct MateLimits {
+    int maxMoves = 8;       // longest mate looked for, in attacker moves
+    uint64_t nodes = 0;     // give up after about this many nodes, 0 for no limit
+    bool checksOnly = true; // false also tries quiet attacker moves, for problems with a quiet key
+    // Polled every 1024 nodes; returning true gives up
+    std::function<bool()> abort;
+};
+
+struct MateResult {
+    int mateIn = 0;             // attacker moves, 0 if no mate was proven
+    std::vector<uint16_t> line; // packed moves from the root to the mate, best defence
+    uint64_t nodes = 0;
+    bool complete = true;       // false if a limit stopped the search before maxMoves
+};
+
+// Looks for a forced mate by the side to move. The game is restored on return.
+MateResult solveMate(ProofTable& table, Game& game, const MateLimits& limits);
+// Legal moves of the side to move that give check, packed. Promotions are
+// listed once per piece, so underpromotions that mate are not missed.
+void generateCheckingMoves(Game& game, std::vector<uint16_t>& moves);
@@ -0,0 +1,125 @@
+#include "mate.h"
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+
+static Game fromFen(const std::string& fen) {
+    Game game;
+    std::string error;
+    [[maybe_unused]] bool ok = loadFen(game, fen, error);
+    assert(ok);
+    return game;
+}
+
+static bool givesCheck(Game& game, const AIMove& m, const std::string& promotion) {
+    bool white = game.isWhiteTurn;
+    MoveUndo undo;
+    makeMove(game, m, undo, promotion);
+    int kRow, kCol;
+    findKing(game, !white, kRow, kCol);
+    bool check = isSquareAttacked(game, kRow, kCol, white);
+    unmakeMove(game, m, undo);
+    return check;
+}
+
+// The filtered generator must agree with trying every legal move
+void testCheckingMoves() {
+    const char* fens[] = {
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+        "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+        "6br/5Ppk/6pp/8/8/8/8/K7 w - - 0 1",
+        "4k3/8/8/2pP4/8/8/8/1B2K2R w K c6 0 1",
+        "3k4/1P6/8/8/8/8/8/R3K3 w Q - 0 1",
+    };
+    const char* promotions[] = {"queen", "rook", "bishop", "knight"};
+    for (const char* fen : fens) {
+        Game game = fromFen(fen);
+        std::vector<uint16_t> expected;
+        for (const AIMove& m : generateLegalMoves(game, game.isWhiteTurn)) {
+            Piece* p = game.board[m.sr][m.sc];
+            bool promotes = p->type.find("pawn") != std::string::npos && (m.er == 0 || m.er == BOARD_SIZE - 1);
+            for (int i = 0; i < (promotes ? 4 : 1); ++i) {
+                if (givesCheck(game, m, promotions[i])) expected.push_back(packMove(game, m, promotions[i]));
+            }
+        }
+        std::vector<uint16_t> moves;
+        generateCheckingMoves(game, moves);
+        std::sort(expected.begin(), expected.end());
+        std::sort(moves.begin(), moves.end());
+        assert(moves == expected);
+    }
+}
+
+// Plays the line from the position and checks it ends in mate
+[[maybe_unused]] static bool lineMates(const std::string& fen, const std::vector<uint16_t>& line) {
+    Game game = fromFen(fen);
+    for (uint16_t packed : line) {
+        std::string promotion;
+        if (!applyMove(game, unpackMove(packed, promotion), promotion)) return false;
+    }
+    return game.status == GameStatus::CHECKMATE;
+}
+
+static MateResult solve(const std::string& fen, int maxMoves, bool checksOnly = true, uint64_t nodes = 0) {
+    Game game = fromFen(fen);
+    std::string before = toFen(game);
+    ProofTable table(4);
+    MateLimits limits;
+    limits.maxMoves = maxMoves;
+    limits.checksOnly = checksOnly;
+    limits.nodes = nodes;
+    MateResult result = solveMate(table, game, limits);
+    assert(toFen(game) == before);
+    return result;
+}
+
+void testMates() {
+    MateResult r = solve("6k1/5ppp/8/8/8/8/8/R6K w - - 0 1", 4);
+    assert(r.mateIn == 1 && r.line.size() == 1 && packedMoveToString(r.line[0]) == "a1a8");
+
+    // Only the knight promotion mates
+    r = solve("6br/5Ppk/6pp/8/8/8/8/K7 w - - 0 1", 4);
+    assert(r.mateIn == 1 && packedMoveToString(r.line[0]) == "f7f8n");
+
+    const char* smothered = "1r4k1/5Npp/8/8/2Q5/8/8/6K1 w - - 0 1";
+    r = solve(smothered, 6);
+    assert(r.mateIn == 3 && r.line.size() == 5 && lineMates(smothered, r.line));
+
+    const char* kingHunt = "r1b1kb1r/pppp1ppp/5q2/4n3/3KP3/2N3PN/PPP4P/R1BQ1B1R b kq - 0 1";
+    r = solve(kingHunt, 6);
+    assert(r.mateIn == 3 && lineMates(kingHunt, r.line));
+
+    const char* ladder = "8/8/8/8/4k3/8/8/QR4K1 w - - 0 1";
+    r = solve(ladder, 8);
+    assert(r.mateIn == 5 && r.line.size() == 9 && lineMates(ladder, r.line));
+}
+
+void testQuietKey() {
+    // Ra6 threatens mate without giving check
+    const char* morphy = "kbK5/pp6/1P6/8/8/8/8/R7 w - - 0 1";
+    MateResult r = solve(morphy, 3);
+    assert(r.mateIn == 0 && r.complete);
+    r = solve(morphy, 3, false);
+    assert(r.mateIn == 2 && lineMates(morphy, r.line));
+}
+
+void testNoMateAndLimits() {
+    MateResult r = solve("r5k1/6pp/8/8/8/2B5/1Q3PPP/6K1 w - - 0 1", 4);
+    assert(r.mateIn == 0 && r.complete && r.line.empty());
+    // Rb7 stalemates, which is no mate in one; Kc7 and Ra1 is mate in two
+    r = solve("k7/8/2K5/8/8/8/8/1R6 w - - 0 1", 1, false);
+    assert(r.mateIn == 0 && r.complete);
+    r = solve("k7/8/2K5/8/8/8/8/1R6 w - - 0 1", 2, false);
+    assert(r.mateIn == 2);
+    r = solve("8/8/3k4/8/8/8/8/QR4K1 w - - 0 1", 8, true, 500);
+    assert(r.mateIn == 0 && !r.complete && r.nodes < 1000);
+}
+
+int main() {
+    testCheckingMoves();
+    testMates();
+    testQuietKey();
+    testNoMateAndLimits();
+    std::cout << "All mate tests passed\n";
+    return 0;
+}
@@ -0,0 +1,154 @@
+// Forced mate search for puzzle production. Reads FEN positions, one per line,
+// from a file or stdin ("-") and proves the shortest mate for the side to move
+// with the df-pn solver:
+//
+//   <fen> TAB #<n> TAB <moves of the mating line> TAB <nodes>
+//
+// Positions without a mate in --max-moves come out as "none", and ones the
+// node limit cut short as "unknown", both with an empty line. Bad positions
+// come out as "<fen> TAB error TAB <reason>".
+//
+// --bench solves a fixed set of mate problems instead and reports the time and
+// nodes for each; it fails if any result differs from the known one.
+//
+// Usage: chess_mate [--max-moves N] [--nodes N] [--hash MB] [--all-moves] [--bench] [input.fen|-]
+#include "mate.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+struct MateProblem {
+    const char* name;
+    const char* fen;
+    int mateIn;      // 0 for none within maxMoves
+    bool checksOnly; // false for problems whose key move is quiet
+    int maxMoves;
+};
+
+static const MateProblem BENCH_PROBLEMS[] = {
+    {"back rank", "6k1/5ppp/8/8/8/8/8/R6K w - - 0 1", 1, true, 8},
+    {"scholar's mate", "r1bqkbnr/pppp1ppp/2n5/4p2Q/2B1P3/8/PPPP1PPP/RNB1K1NR w KQkq - 0 1", 1, true, 8},
+    {"underpromotion", "6br/5Ppk/6pp/8/8/8/8/K7 w - - 0 1", 1, true, 8},
+    {"queen sacrifice", "r1bq2r1/b4pk1/p1pp1p2/1p2pP2/1P2P1PB/3P4/1PPQ2P1/R3K2R w - - 0 1", 2, true, 8},
+    {"rook sacrifices", "6k1/pp4p1/2p5/2bp4/8/P5Pb/1P3rrP/2BRRN1K b - - 0 1", 2, true, 8},
+    {"Morphy, quiet key", "kbK5/pp6/1P6/8/8/8/8/R7 w - - 0 1", 2, false, 4},
+    {"rook lift", "r5rk/5p1p/5R2/4B3/8/8/7P/7K w - - 0 1", 3, true, 8},
+    {"smothered", "1r4k1/5Npp/8/8/2Q5/8/8/6K1 w - - 0 1", 3, true, 8},
+    {"king hunt", "r1b1kb1r/pppp1ppp/5q2/4n3/3KP3/2N3PN/PPP4P/R1BQ1B1R b kq - 0 1", 3, true, 8},
+    {"Philidor's legacy", "5r1k/6pp/8/6N1/2Q5/8/8/6K1 w - - 0 1", 4, true, 8},
+    {"queen and bishop", "6k1/6pp/8/8/8/2B5/1Q3PPP/6K1 w - - 0 1", 4, true, 8},
+    {"ladder from e4", "8/8/8/8/4k3/8/8/QR4K1 w - - 0 1", 5, true, 8},
+    {"ladder from d5", "8/8/8/3k4/8/8/8/QR4K1 w - - 0 1", 5, true, 8},
+    {"ladder from d6", "8/8/3k4/8/8/8/8/QR4K1 w - - 0 1", 6, true, 8},
+    {"queen and rook hunt", "6k1/6pp/8/8/8/8/1Q3PPP/1R4K1 w - - 0 1", 7, true, 8},
+    {"no checking mate", "r5k1/6pp/8/8/8/2B5/1Q3PPP/6K1 w - - 0 1", 0, true, 8},
+};
+
+static std::string lineToString(const std::vector<uint16_t>& line) {
+    std::string text;
+    for (uint16_t move : line) text += (text.empty() ? "" : " ") + packedMoveToString(move);
+    return text;
+}
+
+static int runBench(std::size_t hashMb) {
+    ProofTable table(hashMb);
+    uint64_t totalNodes = 0;
+    double totalSeconds = 0;
+    int failures = 0;
+    std::printf("%-22s %5s %5s %10s %10s %10s\n", "problem", "want", "found", "nodes", "ms", "knodes/s");
+    for (const MateProblem& problem : BENCH_PROBLEMS) {
+        Game game;
+        std::string error;
+        if (!loadFen(game, problem.fen, error)) {
+            std::printf("%-22s bad FEN: %s\n", problem.name, error.c_str());
+            ++failures;
+            continue;
+        }
+        table.clear();
+        MateLimits limits;
+        limits.maxMoves = problem.maxMoves;
+        limits.checksOnly = problem.checksOnly;
+        auto start = std::chrono::steady_clock::now();
+        MateResult result = solveMate(table, game, limits);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        totalNodes += result.nodes;
+        totalSeconds += seconds;
+        bool ok = result.complete && result.mateIn == problem.mateIn;
+        if (!ok) ++failures;
+        std::printf("%-22s %5d %5d %10llu %10.2f %10.0f%s\n", problem.name, problem.mateIn, result.mateIn,
+                    static_cast<unsigned long long>(result.nodes), seconds * 1000,
+                    seconds > 0 ? result.nodes / seconds / 1000 : 0.0, ok ? "" : "  WRONG");
+    }
+    std::printf("%-22s %5s %5s %10llu %10.2f %10.0f\n", "total", "", "", static_cast<unsigned long long>(totalNodes),
+                totalSeconds * 1000, totalSeconds > 0 ? totalNodes / totalSeconds / 1000 : 0.0);
+    if (failures) std::printf("%d problems wrong\n", failures);
+    return failures ? 1 : 0;
+}
+
+static std::string solveLine(ProofTable& table, const std::string& fen, const MateLimits& limits) {
+    Game game;
+    std::string error;
+    if (!loadFen(game, fen, error)) return fen + "\terror\t" + error;
+    table.clear();
+    MateResult result = solveMate(table, game, limits);
+    std::string verdict = result.mateIn ? "#" + std::to_string(result.mateIn) : result.complete ? "none" : "unknown";
+    return fen + "\t" + verdict + "\t" + lineToString(result.line) + "\t" + std::to_string(result.nodes);
+}
+
+static void usage() {
+    std::cerr << "Usage: chess_mate [--max-moves N] [--nodes N] [--hash MB] [--all-moves] [--bench] [input.fen|-]\n";
+}
+
+int main(int argc, char* argv[]) {
+    MateLimits limits;
+    std::size_t hashMb = 64;
+    bool bench = false;
+    std::string inputPath = "-";
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--max-moves" && i + 1 < argc) {
+            limits.maxMoves = std::atoi(argv[++i]);
+        } else if (arg == "--nodes" && i + 1 < argc) {
+            limits.nodes = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--hash" && i + 1 < argc) {
+            hashMb = static_cast<std::size_t>(std::atoi(argv[++i]));
+        } else if (arg == "--all-moves") {
+            limits.checksOnly = false;
+        } else if (arg == "--bench") {
+            bench = true;
+        } else if (!arg.empty() && arg[0] == '-' && arg != "-") {
+            usage();
+            return 1;
+        } else {
+            inputPath = arg;
+        }
+    }
+    if (hashMb == 0) hashMb = 1;
+    if (bench) return runBench(hashMb);
+
+    std::ifstream file;
+    std::istream* input = &std::cin;
+    if (inputPath != "-") {
+        file.open(inputPath);
+        if (!file) {
+            std::cerr << inputPath << ": cannot open\n";
+            return 1;
+        }
+        input = &file;
+    }
+    ProofTable table(hashMb);
+    std::string text;
+    while (std::getline(*input, text)) {
+        // Trim, and skip empty and comment lines
+        std::size_t first = text.find_first_not_of(" \t\r");
+        if (first == std::string::npos || text[first] == '#') continue;
+        std::size_t last = text.find_last_not_of(" \t\r");
+        std::string out = solveLine(table, text.substr(first, last - first + 1), limits);
+        std::printf("%s\n", out.c_str());
+        std::fflush(stdout);
+    }
+    return 0;
+}
@@ -0,0 +1,162 @@
+// Microbenchmarks of the rules primitives over the fixed corpus of
+// bench_positions.h, with Google Benchmark. Every iteration runs the primitive
+// over all positions of the corpus; items/s counts the calls. Build with
+// -DCMAKE_BUILD_TYPE=Release. The bench target writes the results as JSON
+// (--benchmark_out=FILE --benchmark_out_format=json) for diffing runs.
+//
+// Usage: chess_microbench [--benchmark_filter=REGEX] [other Google Benchmark flags]
+#include "bench_positions.h"
+#include "game.h"
+#include <benchmark/benchmark.h>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+// The positions are parsed once; benchmarks that change a Game put it back
+static std::vector<Game>& corpus() {
+    static std::vector<Game> games = [] {
+        std::vector<Game> loaded;
+        for (const char* fen : BENCH_POSITIONS) {
+            Game game;
+            std::string error;
+            if (!loadFen(game, fen, error)) {
+                std::cerr << fen << ": " << error << "\n";
+                std::exit(1);
+            }
+            loaded.push_back(game);
+        }
+        return loaded;
+    }();
+    return games;
+}
+
+// Legal moves of the side to move in every position, for the benchmarks that
+// take a move
+static const std::vector<std::vector<AIMove>>& corpusMoves() {
+    static std::vector<std::vector<AIMove>> moves = [] {
+        std::vector<std::vector<AIMove>> all;
+        for (Game& game : corpus()) all.push_back(generateLegalMoves(game, game.isWhiteTurn));
+        return all;
+    }();
+    return moves;
+}
+
+// Every piece of the side to move against every square, as updateValidMoves does
+static void BM_IsValidMove(benchmark::State& state) {
+    int64_t calls = 0;
+    for (auto _ : state) {
+        for (Game& game : corpus()) {
+            for (int sr = 0; sr < BOARD_SIZE; ++sr) {
+                for (int sc = 0; sc < BOARD_SIZE; ++sc) {
+                    Piece* p = game.board[sr][sc];
+                    if (!p || p->isWhite != game.isWhiteTurn) continue;
+                    for (int er = 0; er < BOARD_SIZE; ++er) {
+                        for (int ec = 0; ec < BOARD_SIZE; ++ec) {
+                            benchmark::DoNotOptimize(isValidMove(game, p, sr, sc, er, ec));
+                            ++calls;
+                        }
+                    }
+                }
+            }
+        }
+    }
+    state.SetItemsProcessed(calls);
+}
+BENCHMARK(BM_IsValidMove);
+
+// Every square, attacked by either side
+static void BM_IsSquareAttacked(benchmark::State& state) {
+    int64_t calls = 0;
+    for (auto _ : state) {
+        for (const Game& game : corpus()) {
+            for (int r = 0; r < BOARD_SIZE; ++r) {
+                for (int c = 0; c < BOARD_SIZE; ++c) {
+                    benchmark::DoNotOptimize(isSquareAttacked(game, r, c, true));
+                    benchmark::DoNotOptimize(isSquareAttacked(game, r, c, false));
+                    calls += 2;
+                }
+            }
+        }
+    }
+    state.SetItemsProcessed(calls);
+}
+BENCHMARK(BM_IsSquareAttacked);
+
+static void BM_WouldLeaveInCheck(benchmark::State& state) {
+    int64_t calls = 0;
+    for (auto _ : state) {
+        for (std::size_t i = 0; i < corpus().size(); ++i) {
+            Game& game = corpus()[i];
+            for (const AIMove& m : corpusMoves()[i]) {
+                benchmark::DoNotOptimize(wouldLeaveInCheck(game, m.sr, m.sc, m.er, m.ec));
+                ++calls;
+            }
+        }
+    }
+    state.SetItemsProcessed(calls);
+}
+BENCHMARK(BM_WouldLeaveInCheck);
+
+// Selects each piece of the side to move in turn, as a click does
+static void BM_UpdateValidMoves(benchmark::State& state) {
+    int64_t calls = 0;
+    for (auto _ : state) {
+        for (Game& game : corpus()) {
+            for (int r = 0; r < BOARD_SIZE; ++r) {
+                for (int c = 0; c < BOARD_SIZE; ++c) {
+                    Piece* p = game.board[r][c];
+                    if (!p || p->isWhite != game.isWhiteTurn) continue;
+                    game.selectedPiece = p;
+                    game.selectedPos = {r, c};
+                    updateValidMoves(game);
+                    benchmark::DoNotOptimize(game.validMoves.data());
+                    ++calls;
+                }
+            }
+            clearSelection(game);
+        }
+    }
+    state.SetItemsProcessed(calls);
+}
+BENCHMARK(BM_UpdateValidMoves);
+
+static void BM_GenerateLegalMovesForBlack(benchmark::State& state) {
+    int64_t calls = 0;
+    for (auto _ : state) {
+        for (Game& game : corpus()) {
+            std::vector<AIMove> moves = generateLegalMovesForBlack(game);
+            benchmark::DoNotOptimize(moves.data());
+            ++calls;
+        }
+    }
+    state.SetItemsProcessed(calls);
+}
+BENCHMARK(BM_GenerateLegalMovesForBlack);
+
+static void BM_HasAnyLegalMoves(benchmark::State& state) {
+    int64_t calls = 0;
+    for (auto _ : state) {
+        for (Game& game : corpus()) {
+            benchmark::DoNotOptimize(hasAnyLegalMoves(game, game.isWhiteTurn));
+            ++calls;
+        }
+    }
+    state.SetItemsProcessed(calls);
+}
+BENCHMARK(BM_HasAnyLegalMoves);
+
+static void BM_CheckGameEnd(benchmark::State& state) {
+    int64_t calls = 0;
+    for (auto _ : state) {
+        for (Game& game : corpus()) {
+            checkGameEnd(game, game.isWhiteTurn);
+            benchmark::DoNotOptimize(game.status);
+            game.status = GameStatus::IN_PROGRESS;
+            ++calls;
+        }
+    }
+    state.SetItemsProcessed(calls);
+}
+BENCHMARK(BM_CheckGameEnd);
+
+BENCHMARK_MAIN();
@@ -1,19 +1,23 @@
-#define UNIT_TEST
-#include "main.cpp"
+#include "game.h"
 #include <cassert>
 #include <iostream>
 
+Game game;
+
 void resetBoardState() {
     for (int r = 0; r < 8; ++r) {
         for (int c = 0; c < 8; ++c) {
-            if (board[r][c]) {
-                delete board[r][c];
-                board[r][c] = nullptr;
+            if (game.board[r][c]) {
+                delete game.board[r][c];
+                game.board[r][c] = nullptr;
             }
         }
     }
-    clearSelection();
-    isWhiteTurn = true;
+    clearSelection(game);
+    game.isWhiteTurn = true;
+    game.castlingRights = 0;
+    game.enPassant = {-1, -1};
+    game.status = GameStatus::IN_PROGRESS;
 }
 
 Piece* makePiece(const std::string& type, bool white) {
@@ -26,113 +30,113 @@ Piece* makePiece(const std::string& type, bool white) {
 void testWhitePawn() {
     resetBoardState();
     Piece* p = makePiece("white-pawn", true);
-    board[6][4] = p;
-    selectedPiece = p;
-    selectedPos = {6,4};
-    moveWhitePawn(5,4);
-    assert(board[5][4] == p && board[6][4] == nullptr);
+    game.board[6][4] = p;
+    game.selectedPiece = p;
+    game.selectedPos = {6,4};
+    moveSelectedPiece(game, 5,4);
+    assert(game.board[5][4] == p && game.board[6][4] == nullptr);
 }
 
 void testBlackPawn() {
     resetBoardState();
     Piece* p = makePiece("black-pawn", false);
-    board[1][3] = p;
-    selectedPiece = p;
-    selectedPos = {1,3};
-    moveBlackPawn(2,3);
-    assert(board[2][3] == p && board[1][3] == nullptr);
+    game.board[1][3] = p;
+    game.selectedPiece = p;
+    game.selectedPos = {1,3};
+    moveSelectedPiece(game, 2,3);
+    assert(game.board[2][3] == p && game.board[1][3] == nullptr);
 }
 
 void testRook() {
     resetBoardState();
     Piece* p = makePiece("white-rook", true);
-    board[4][4] = p;
-    selectedPiece = p;
-    selectedPos = {4,4};
-    moveRook(4,7);
-    assert(board[4][7] == p && board[4][4] == nullptr);
+    game.board[4][4] = p;
+    game.selectedPiece = p;
+    game.selectedPos = {4,4};
+    moveSelectedPiece(game, 4,7);
+    assert(game.board[4][7] == p && game.board[4][4] == nullptr);
 }
 
 void testKnight() {
     resetBoardState();
     Piece* p = makePiece("white-knight", true);
-    board[4][4] = p;
-    selectedPiece = p;
-    selectedPos = {4,4};
-    moveKnight(5,6);
-    assert(board[5][6] == p && board[4][4] == nullptr);
+    game.board[4][4] = p;
+    game.selectedPiece = p;
+    game.selectedPos = {4,4};
+    moveSelectedPiece(game, 5,6);
+    assert(game.board[5][6] == p && game.board[4][4] == nullptr);
 }
 
 void testBishop() {
     resetBoardState();
     Piece* p = makePiece("white-bishop", true);
-    board[4][4] = p;
-    selectedPiece = p;
-    selectedPos = {4,4};
-    moveBishop(6,6);
-    assert(board[6][6] == p && board[4][4] == nullptr);
+    game.board[4][4] = p;
+    game.selectedPiece = p;
+    game.selectedPos = {4,4};
+    moveSelectedPiece(game, 6,6);
+    assert(game.board[6][6] == p && game.board[4][4] == nullptr);
 }
 
 void testQueen() {
     resetBoardState();
     Piece* p = makePiece("white-queen", true);
-    board[4][4] = p;
-    selectedPiece = p;
-    selectedPos = {4,4};
-    moveQueen(4,6);
-    assert(board[4][6] == p && board[4][4] == nullptr);
+    game.board[4][4] = p;
+    game.selectedPiece = p;
+    game.selectedPos = {4,4};
+    moveSelectedPiece(game, 4,6);
+    assert(game.board[4][6] == p && game.board[4][4] == nullptr);
 }
 
 void testKing() {
     resetBoardState();
     Piece* p = makePiece("white-king", true);
-    board[4][4] = p;
-    selectedPiece = p;
-    selectedPos = {4,4};
-    moveKing(5,5);
-    assert(board[5][5] == p && board[4][4] == nullptr);
+    game.board[4][4] = p;
+    game.selectedPiece = p;
+    game.selectedPos = {4,4};
+    moveSelectedPiece(game, 5,5);
+    assert(game.board[5][5] == p && game.board[4][4] == nullptr);
 }
 
 void testTurnSwitch() {
     resetBoardState();
     Piece* wp = makePiece("white-pawn", true);
-    board[6][0] = wp;
-    selectedPiece = wp;
-    selectedPos = {6,0};
-    moveWhitePawn(5,0);
-    assert(!isWhiteTurn);
+    game.board[6][0] = wp;
+    game.selectedPiece = wp;
+    game.selectedPos = {6,0};
+    moveSelectedPiece(game, 5,0);
+    assert(!game.isWhiteTurn);
 
     Piece* bp = makePiece("black-pawn", false);
-    board[1][0] = bp;
-    selectedPiece = bp;
-    selectedPos = {1,0};
-    moveBlackPawn(2,0);
-    assert(isWhiteTurn);
+    game.board[1][0] = bp;
+    game.selectedPiece = bp;
+    game.selectedPos = {1,0};
+    moveSelectedPiece(game, 2,0);
+    assert(game.isWhiteTurn);
 }
 
 void testCannotCaptureKing() {
     resetBoardState();
     Piece* rook = makePiece("white-rook", true);
     Piece* king = makePiece("black-king", false);
-    board[4][0] = rook;
-    board[4][4] = king;
-    selectedPiece = rook;
-    selectedPos = {4,0};
-    moveRook(4,4);
-    assert(board[4][0] == rook && board[4][4] == king);
+    game.board[4][0] = rook;
+    game.board[4][4] = king;
+    game.selectedPiece = rook;
+    game.selectedPos = {4,0};
+    moveSelectedPiece(game, 4,4);
+    assert(game.board[4][0] == rook && game.board[4][4] == king);
 }
 
 void testDetectCheck() {
     resetBoardState();
     Piece* rook = makePiece("white-rook", true);
     Piece* king = makePiece("black-king", false);
-    board[4][0] = rook;
-    board[4][4] = king;
-    selectedPiece = rook;
-    selectedPos = {4,0};
-    moveRook(4,3);
-    assert(board[4][3] == rook);
-    assert(isSquareAttacked(4,4,true));
+    game.board[4][0] = rook;
+    game.board[4][4] = king;
+    game.selectedPiece = rook;
+    game.selectedPos = {4,0};
+    moveSelectedPiece(game, 4,3);
+    assert(game.board[4][3] == rook);
+    assert(isSquareAttacked(game, 4,4,true));
 }
 
 void testNoLeavingKingInCheck() {
@@ -140,24 +144,93 @@ void testNoLeavingKingInCheck() {
     Piece* wKing = makePiece("white-king", true);
     Piece* wRook = makePiece("white-rook", true);
     Piece* bRook = makePiece("black-rook", false);
-    board[4][4] = wKing;
-    board[4][0] = wRook;
-    board[4][7] = bRook;
-    selectedPiece = wRook;
-    selectedPos = {4,0};
-    moveRook(4,1);
-    assert(board[4][0] == wRook && board[4][1] == nullptr);
+    game.board[4][4] = wKing;
+    game.board[4][0] = wRook;
+    game.board[4][7] = bRook;
+    game.selectedPiece = wRook;
+    game.selectedPos = {4,0};
+    moveSelectedPiece(game, 4,1);
+    assert(game.board[4][0] == wRook && game.board[4][1] == nullptr);
 }
 
 void testPawnPromotion() {
     resetBoardState();
     Piece* p = makePiece("white-pawn", true);
-    board[1][0] = p;
-    selectedPiece = p;
-    selectedPos = {1,0};
-    moveWhitePawn(0,0);
-    assert(board[0][0] == p);
-    assert(board[0][0]->type == "white-queen");
+    game.board[1][0] = p;
+    game.selectedPiece = p;
+    game.selectedPos = {1,0};
+    moveSelectedPiece(game, 0,0);
+    assert(game.board[0][0] == p);
+    assert(game.board[0][0]->type == "white-queen");
+}
+
+void testCastling() {
+    resetBoardState();
+    Piece* king = makePiece("white-king", true);
+    Piece* rook = makePiece("white-rook", true);
+    game.board[7][4] = king;
+    game.board[7][7] = rook;
+    game.castlingRights = CASTLE_WHITE_KINGSIDE;
+    game.selectedPiece = king;
+    game.selectedPos = {7,4};
+    moveSelectedPiece(game, 7,6);
+    assert(game.board[7][6] == king && game.board[7][5] == rook);
+    assert(game.board[7][4] == nullptr && game.board[7][7] == nullptr);
+    assert(game.castlingRights == 0);
+}
+
+void testNoCastlingThroughCheck() {
+    resetBoardState();
+    Piece* king = makePiece("white-king", true);
+    Piece* rook = makePiece("white-rook", true);
+    Piece* bRook = makePiece("black-rook", false);
+    game.board[7][4] = king;
+    game.board[7][7] = rook;
+    game.board[0][5] = bRook;
+    game.castlingRights = CASTLE_WHITE_KINGSIDE;
+    game.selectedPiece = king;
+    game.selectedPos = {7,4};
+    moveSelectedPiece(game, 7,6);
+    assert(game.board[7][4] == king && game.board[7][7] == rook);
+}
+
+void testEnPassant() {
+    resetBoardState();
+    Piece* wp = makePiece("white-pawn", true);
+    Piece* bp = makePiece("black-pawn", false);
+    game.board[3][4] = wp;
+    game.board[1][3] = bp;
+    game.isWhiteTurn = false;
+    game.selectedPiece = bp;
+    game.selectedPos = {1,3};
+    moveSelectedPiece(game, 3,3);
+    assert(game.enPassant.row == 2 && game.enPassant.col == 3);
+    game.selectedPiece = wp;
+    game.selectedPos = {3,4};
+    moveSelectedPiece(game, 2,3);
+    assert(game.board[2][3] == wp && game.board[3][3] == nullptr);
+}
+
+void testIndependentGames() {
+    Game a;
+    default_board(a);
+    Game b = a;
+    applyMove(b, {6,4,4,4,0});
+    assert(b.board[4][4] && b.board[6][4] == nullptr && !b.isWhiteTurn);
+    assert(a.board[6][4] && a.board[4][4] == nullptr && a.isWhiteTurn);
+    assert(a.board[7][4] != b.board[7][4]);
+}
+
+void testCheckmateEndsGame() {
+    Game g;
+    default_board(g);
+    applyMove(g, {6,5,5,5,0}); // f3
+    applyMove(g, {1,4,3,4,0}); // e5
+    applyMove(g, {6,6,4,6,0}); // g4
+    applyMove(g, {0,3,4,7,0}); // Qh4#
+    assert(g.status == GameStatus::CHECKMATE);
+    assert(g.gameOverMessage == "Black wins by checkmate");
+    assert(!applyMove(g, {6,0,5,0,0}));
 }
 
 int main() {
@@ -173,6 +246,11 @@ int main() {
     testDetectCheck();
     testNoLeavingKingInCheck();
     testPawnPromotion();
+    testCastling();
+    testNoCastlingThroughCheck();
+    testEnPassant();
+    testIndependentGames();
+    testCheckmateEndsGame();
     std::cout << "All movement tests passed\n";
     resetBoardState();
     return 0;
@@ -0,0 +1,84 @@
+// Build step for the GUI. Decodes the twelve piece images into one RGBA atlas
+// laid out as assets.h describes and writes it, with the bytes of the font
+// file, as a C++ source file defining ATLAS_PIXELS and FONT_DATA. Fails, and
+// so fails the build, if an image or the font is missing or malformed.
+//
+// Usage: chess_pack_assets PIECES_DIR FONT.ttf OUTPUT.cpp
+#include <SFML/Graphics.hpp>
+#include "assets.h"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+static bool writeArray(std::FILE* out, const char* name, const unsigned char* bytes, std::size_t size) {
+    std::fprintf(out, "extern const unsigned char %s[];\nconst unsigned char %s[] = {\n", name, name);
+    for (std::size_t i = 0; i < size; ++i) {
+        std::fprintf(out, "%u,%s", bytes[i], i % 32 == 31 ? "\n" : "");
+    }
+    return std::fprintf(out, "\n};\n") > 0;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc != 4) {
+        std::cerr << "Usage: chess_pack_assets PIECES_DIR FONT.ttf OUTPUT.cpp\n";
+        return 1;
+    }
+    const std::string piecesDir = argv[1];
+    const char* const colors[ATLAS_ROWS] = {"white", "black"};
+    const char* const kinds[ATLAS_COLUMNS] = {"pawn", "knight", "bishop", "rook", "queen", "king"};
+
+    std::vector<unsigned char> atlas(static_cast<std::size_t>(ATLAS_WIDTH) * ATLAS_HEIGHT * 4);
+    for (int row = 0; row < ATLAS_ROWS; ++row) {
+        for (int col = 0; col < ATLAS_COLUMNS; ++col) {
+            std::string path = piecesDir + "/" + colors[row] + "-" + kinds[col] + ".png";
+            sf::Image image;
+            if (!image.loadFromFile(path)) {
+                std::cerr << path << ": cannot load\n";
+                return 1;
+            }
+            if (image.getSize().x != ATLAS_TILE || image.getSize().y != ATLAS_TILE) {
+                std::cerr << path << ": must be " << ATLAS_TILE << "x" << ATLAS_TILE << "\n";
+                return 1;
+            }
+            const sf::Uint8* pixels = image.getPixelsPtr();
+            for (int y = 0; y < ATLAS_TILE; ++y) {
+                std::size_t to = ((static_cast<std::size_t>(row) * ATLAS_TILE + y) * ATLAS_WIDTH + col * ATLAS_TILE) * 4;
+                std::copy(pixels + y * ATLAS_TILE * 4, pixels + (y + 1) * ATLAS_TILE * 4, atlas.begin() + to);
+            }
+        }
+    }
+
+    std::ifstream fontFile(argv[2], std::ios::binary);
+    std::vector<unsigned char> font((std::istreambuf_iterator<char>(fontFile)), std::istreambuf_iterator<char>());
+    sf::Font check;
+    if (!fontFile || font.empty() || !check.loadFromMemory(font.data(), font.size())) {
+        std::cerr << argv[2] << ": not a usable font\n";
+        return 1;
+    }
+
+    // Written under a temporary name, so a failed run leaves no output that
+    // looks up to date
+    std::string output = argv[3];
+    std::string temporary = output + ".tmp";
+    std::FILE* out = std::fopen(temporary.c_str(), "w");
+    if (!out) {
+        std::perror(temporary.c_str());
+        return 1;
+    }
+    std::fprintf(out, "// Generated by chess_pack_assets from %s and %s. Do not edit.\n"
+                      "#include <cstddef>\n", piecesDir.c_str(), argv[2]);
+    bool ok = writeArray(out, "ATLAS_PIXELS", atlas.data(), atlas.size()) &&
+              writeArray(out, "FONT_DATA", font.data(), font.size()) &&
+              std::fprintf(out, "extern const std::size_t FONT_DATA_SIZE;\nconst std::size_t FONT_DATA_SIZE = %zu;\n",
+                           font.size()) > 0;
+    if (std::fclose(out) != 0 || !ok || std::rename(temporary.c_str(), output.c_str()) != 0) {
+        std::perror(output.c_str());
+        std::remove(temporary.c_str());
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,306 @@
+#include "pgn.h"
+#include <cctype>
+#include <cstdlib>
+#include <vector>
+
+static std::size_t nextLine(std::string_view data, std::size_t pos) {
+    std::size_t end = data.find('\n', pos);
+    return end == std::string_view::npos ? data.size() : end + 1;
+}
+
+static bool isBlankLine(std::string_view data, std::size_t pos) {
+    for (; pos < data.size() && data[pos] != '\n'; ++pos) {
+        if (!std::isspace(static_cast<unsigned char>(data[pos]))) return false;
+    }
+    return true;
+}
+
+std::size_t findGameStart(std::string_view data, std::size_t from) {
+    std::size_t pos = from;
+    // Resume at a line boundary when starting in the middle of the buffer
+    if (pos > 0 && pos < data.size() && data[pos - 1] != '\n') pos = nextLine(data, pos);
+    // Look back at the last non-blank line to know whether we are inside a
+    // tag section
+    bool previousWasTag = false;
+    std::size_t lineEnd = pos;
+    while (lineEnd > 0) {
+        std::size_t lineStart = lineEnd >= 2 ? data.rfind('\n', lineEnd - 2) : std::string_view::npos;
+        lineStart = lineStart == std::string_view::npos ? 0 : lineStart + 1;
+        if (!isBlankLine(data, lineStart)) {
+            previousWasTag = data[lineStart] == '[';
+            break;
+        }
+        lineEnd = lineStart;
+    }
+    while (pos < data.size()) {
+        if (data[pos] == '[') {
+            if (!previousWasTag) return pos;
+            previousWasTag = true;
+        } else if (!isBlankLine(data, pos)) {
+            previousWasTag = false;
+        }
+        pos = nextLine(data, pos);
+    }
+    return data.size();
+}
+
+PgnGame readGame(std::string_view data, std::size_t start) {
+    // Skip this game's tag section so its own tags are not taken as the next game
+    std::size_t pos = start;
+    while (pos < data.size() && (data[pos] == '[' || isBlankLine(data, pos))) {
+        pos = nextLine(data, pos);
+    }
+    std::size_t end = findGameStart(data, pos);
+    return {start, data.substr(start, end - start)};
+}
+
+std::string_view pgnTag(std::string_view game, std::string_view name) {
+    std::size_t pos = 0;
+    while (pos < game.size()) {
+        if (game[pos] == '[') {
+            std::size_t nameEnd = pos + 1 + name.size();
+            if (game.compare(pos + 1, name.size(), name) == 0 && nameEnd < game.size() &&
+                game[nameEnd] == ' ') {
+                std::size_t open = game.find('"', nameEnd);
+                std::size_t close = open == std::string_view::npos ? open : game.find('"', open + 1);
+                if (close == std::string_view::npos) return {};
+                return game.substr(open + 1, close - open - 1);
+            }
+        } else if (!isBlankLine(game, pos)) {
+            break; // movetext reached
+        }
+        pos = nextLine(game, pos);
+    }
+    return {};
+}
+
+static const char* sanPieceName(char letter) {
+    switch (letter) {
+        case 'K': return "king";
+        case 'Q': return "queen";
+        case 'R': return "rook";
+        case 'B': return "bishop";
+        case 'N': return "knight";
+        default: return nullptr;
+    }
+}
+
+bool resolveSanMove(Game& game, std::string_view san, AIMove& move, std::string& promotion,
+                    std::string& error) {
+    while (!san.empty() && (san.back() == '+' || san.back() == '#' || san.back() == '!' || san.back() == '?'))
+        san.remove_suffix(1);
+    if (san.empty()) {
+        error = "empty move";
+        return false;
+    }
+    if (game.isOver()) {
+        error = "move after the game has ended";
+        return false;
+    }
+
+    bool white = game.isWhiteTurn;
+    if (san == "O-O" || san == "0-0" || san == "O-O-O" || san == "0-0-0") {
+        int row = white ? 7 : 0;
+        int endCol = san.size() == 3 ? 6 : 2;
+        move = {row, 4, row, endCol, 0};
+        promotion = "queen";
+        if (!canCastle(game, row, 4, endCol) || !isValidMove(game, game.board[row][4], row, 4, row, endCol)) {
+            error = "illegal castling";
+            return false;
+        }
+        return true;
+    }
+
+    promotion = "queen";
+    std::size_t eq = san.find('=');
+    if (eq != std::string_view::npos) {
+        const char* name = eq + 1 < san.size() ? sanPieceName(san[eq + 1]) : nullptr;
+        if (!name || san[eq + 1] == 'K') {
+            error = "bad promotion";
+            return false;
+        }
+        promotion = name;
+        san = san.substr(0, eq);
+    } else if (san.size() >= 3 && std::isdigit(static_cast<unsigned char>(san[san.size() - 2])) &&
+               sanPieceName(san.back()) && san.back() != 'K') {
+        // Promotion written without '=' ("e8Q")
+        promotion = sanPieceName(san.back());
+        san.remove_suffix(1);
+    }
+    if (san.empty()) {
+        error = "bad move syntax";
+        return false;
+    }
+
+    const char* piece = "pawn";
+    if (sanPieceName(san[0])) {
+        piece = sanPieceName(san[0]);
+        san.remove_prefix(1);
+    }
+    std::string rest;
+    for (char ch : san) {
+        if (ch != 'x' && ch != ':' && ch != '-') rest += ch;
+    }
+    if (rest.size() < 2 || rest.size() > 4) {
+        error = "bad move syntax";
+        return false;
+    }
+    int ec = rest[rest.size() - 2] - 'a';
+    int er = '8' - rest[rest.size() - 1];
+    if (!isInsideBoard(er, ec)) {
+        error = "bad destination square";
+        return false;
+    }
+    int fromCol = -1;
+    int fromRow = -1;
+    for (std::size_t i = 0; i + 2 < rest.size(); ++i) {
+        if (rest[i] >= 'a' && rest[i] <= 'h') fromCol = rest[i] - 'a';
+        else if (rest[i] >= '1' && rest[i] <= '8') fromRow = '8' - rest[i];
+        else {
+            error = "bad disambiguation";
+            return false;
+        }
+    }
+
+    // Only pieces of the right kind can reach the destination, so test just
+    // those instead of generating every legal move
+    int found = 0;
+    for (int sr = 0; sr < BOARD_SIZE; ++sr) {
+        if (fromRow != -1 && sr != fromRow) continue;
+        for (int sc = 0; sc < BOARD_SIZE; ++sc) {
+            if (fromCol != -1 && sc != fromCol) continue;
+            Piece* p = game.board[sr][sc];
+            if (!p || p->isWhite != white || p->type.find(piece) == std::string::npos) continue;
+            if (isValidMove(game, p, sr, sc, er, ec)) {
+                move = {sr, sc, er, ec, 0};
+                ++found;
+            }
+        }
+    }
+    if (found == 0) {
+        error = "illegal move";
+        return false;
+    }
+    if (found > 1) {
+        error = "ambiguous move";
+        return false;
+    }
+    return true;
+}
+
+bool applySanMove(Game& game, std::string_view san, std::string& error) {
+    AIMove move;
+    std::string promotion;
+    if (!resolveSanMove(game, san, move, promotion, error)) return false;
+    if (!applyMove(game, move, promotion)) {
+        error = "illegal move";
+        return false;
+    }
+    return true;
+}
+
+static bool isResultToken(std::string_view token) {
+    return token == "1-0" || token == "0-1" || token == "1/2-1/2" || token == "*";
+}
+
+PgnCheck checkPgnGame(std::string_view text, bool keepMoves) {
+    PgnCheck check;
+    auto fail = [&](std::size_t offset, const std::string& message) {
+        check.ok = false;
+        check.errorOffset = offset;
+        check.error = message;
+        return check;
+    };
+
+    std::string_view tagResult = pgnTag(text, "Result");
+
+    std::size_t pos = 0;
+    while (pos < text.size() && (text[pos] == '[' || isBlankLine(text, pos))) {
+        pos = nextLine(text, pos);
+    }
+
+    Game game;
+    default_board(game);
+    std::string_view movetextResult;
+    std::string error;
+    std::string_view fen = pgnTag(text, "FEN");
+    if (!fen.empty() && !loadFen(game, std::string(fen), error)) return fail(0, "bad FEN tag: " + error);
+    while (pos < text.size()) {
+        char ch = text[pos];
+        if (std::isspace(static_cast<unsigned char>(ch))) {
+            ++pos;
+        } else if (ch == '{') {
+            std::size_t close = text.find('}', pos);
+            if (close == std::string_view::npos) return fail(pos, "unterminated comment");
+            pos = close + 1;
+        } else if (ch == ';' || (ch == '%' && (pos == 0 || text[pos - 1] == '\n'))) {
+            pos = nextLine(text, pos);
+        } else if (ch == '(') {
+            // Variations are skipped; they may nest and contain comments
+            std::size_t start = pos;
+            int depth = 0;
+            do {
+                if (text[pos] == '{') {
+                    std::size_t close = text.find('}', pos);
+                    if (close == std::string_view::npos) break;
+                    pos = close;
+                } else if (text[pos] == '(') {
+                    ++depth;
+                } else if (text[pos] == ')') {
+                    --depth;
+                }
+                ++pos;
+            } while (depth > 0 && pos < text.size());
+            if (depth > 0) return fail(start, "unterminated variation");
+        } else if (ch == '$') {
+            ++pos;
+            while (pos < text.size() && std::isdigit(static_cast<unsigned char>(text[pos]))) ++pos;
+        } else {
+            std::size_t start = pos;
+            while (pos < text.size() && !std::isspace(static_cast<unsigned char>(text[pos])) &&
+                   text[pos] != '{' && text[pos] != '(' && text[pos] != ')' && text[pos] != ';') {
+                ++pos;
+            }
+            std::string_view token = text.substr(start, pos - start);
+            if (isResultToken(token)) {
+                movetextResult = token;
+                break;
+            }
+            // Move numbers ("12." or "12...") may be glued to the move
+            std::size_t skip = 0;
+            while (skip < token.size() && std::isdigit(static_cast<unsigned char>(token[skip]))) ++skip;
+            if (skip > 0 && token.substr(0, 3) != "0-0") {
+                if (skip == token.size() || token[skip] != '.') {
+                    return fail(start, "unexpected token '" + std::string(token) + "'");
+                }
+                while (skip < token.size() && token[skip] == '.') ++skip;
+                token.remove_prefix(skip);
+                start += skip;
+                if (token.empty()) continue;
+            }
+            AIMove move;
+            std::string promotion;
+            if (!resolveSanMove(game, token, move, promotion, error)) {
+                return fail(start, error + " '" + std::string(token) + "'");
+            }
+            if (keepMoves) check.moves.push_back(packMove(game, move, promotion));
+            if (!applyMove(game, move, promotion)) {
+                return fail(start, "illegal move '" + std::string(token) + "'");
+            }
+            ++check.plies;
+        }
+    }
+
+    if (movetextResult.empty()) return fail(pos, "missing result");
+    if (!tagResult.empty() && tagResult != movetextResult) {
+        return fail(pos, "result tag " + std::string(tagResult) + " does not match " +
+                             std::string(movetextResult));
+    }
+    check.result = std::string(movetextResult);
+    // Resignations and agreed draws cannot be checked, but mate and stalemate can
+    if (game.isOver() && check.result != resultString(game)) {
+        std::string ending = game.status == GameStatus::CHECKMATE ? "checkmate" : "stalemate";
+        return fail(pos, "game ends in " + ending + " but the result is " + check.result);
+    }
+    return check;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "game.h"
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// PGN reading on top of the rules core. Games are handed out as views into
+// the caller's buffer (usually a MappedFile), so splitting never copies.
+
+struct PgnGame {
+    std::size_t offset;    // where the game starts in the buffer
+    std::string_view text; // tag section plus movetext
+};
+
+struct PgnCheck {
+    bool ok = true;
+    std::size_t errorOffset = 0; // relative to the start of the game
+    std::string error;
+    int plies = 0;
+    std::string result;          // result the game claims
+    std::vector<uint16_t> moves; // packed moves, when asked for
+};
+
+// First game starting at or after from: a tag line that does not directly
+// follow another tag line. Returns data.size() if there is none.
+std::size_t findGameStart(std::string_view data, std::size_t from);
+// The game starting at start, which runs up to the next game start
+PgnGame readGame(std::string_view data, std::size_t start);
+// Value of a tag such as "Result", or an empty view if the tag is missing
+std::string_view pgnTag(std::string_view game, std::string_view name);
+
+// Resolves a SAN move ("Nbd7", "exd6", "e8=Q+", "O-O-O") against the legal
+// moves of the side to move
+bool resolveSanMove(Game& game, std::string_view san, AIMove& move, std::string& promotion,
+                    std::string& error);
+// Resolves a SAN move and plays it
+bool applySanMove(Game& game, std::string_view san, std::string& error);
+// Replays a whole game, checking every move and the claimed result. A game
+// with a FEN tag starts from that position. With keepMoves the packed moves
+// are returned as well.
+PgnCheck checkPgnGame(std::string_view text, bool keepMoves = false);
@@ -0,0 +1,127 @@
+// Validates PGN archives: every move of every game is replayed through the
+// rules core, from the FEN tag's position where there is one, and the claimed
+// result is checked where the position decides it.
+// Files are memory mapped and cut into chunks that worker threads claim one at
+// a time; a chunk owns the games that start inside it. Bad games are reported
+// with their byte offset and the run carries on.
+//
+// Usage: chess_pgncheck [--threads N] [--chunk-mb N] [--quiet] file.pgn...
+#include "mapped_file.h"
+#include "pgn.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct PgnError {
+    std::size_t offset;
+    std::string message;
+};
+
+struct WorkerStats {
+    long games = 0;
+    long badGames = 0;
+    long plies = 0;
+    std::vector<PgnError> errors;
+};
+
+void checkChunk(std::string_view data, std::size_t begin, std::size_t end, WorkerStats& stats) {
+    std::size_t pos = findGameStart(data, begin);
+    while (pos < end && pos < data.size()) {
+        PgnGame game = readGame(data, pos);
+        PgnCheck check = checkPgnGame(game.text);
+        ++stats.games;
+        stats.plies += check.plies;
+        if (!check.ok) {
+            ++stats.badGames;
+            stats.errors.push_back({game.offset + check.errorOffset, check.error});
+        }
+        pos = game.offset + game.text.size();
+    }
+}
+
+int main(int argc, char* argv[]) {
+    unsigned threadCount = std::thread::hardware_concurrency();
+    std::size_t chunkSize = 8u << 20;
+    bool quiet = false;
+    std::vector<std::string> files;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--threads" && i + 1 < argc) {
+            threadCount = static_cast<unsigned>(std::atoi(argv[++i]));
+        } else if (arg == "--chunk-mb" && i + 1 < argc) {
+            chunkSize = static_cast<std::size_t>(std::atof(argv[++i]) * (1u << 20));
+        } else if (arg == "--quiet") {
+            quiet = true;
+        } else if (!arg.empty() && arg[0] == '-') {
+            std::cerr << "Usage: chess_pgncheck [--threads N] [--chunk-mb N] [--quiet] file.pgn...\n";
+            return 1;
+        } else {
+            files.push_back(arg);
+        }
+    }
+    if (files.empty()) {
+        std::cerr << "Usage: chess_pgncheck [--threads N] [--chunk-mb N] [--quiet] file.pgn...\n";
+        return 1;
+    }
+    if (threadCount == 0) threadCount = 1;
+    if (chunkSize == 0) chunkSize = 1u << 20;
+
+    bool anyBad = false;
+    for (const auto& path : files) {
+        MappedFile file;
+        std::string error;
+        if (!file.open(path, error)) {
+            std::cerr << error << "\n";
+            anyBad = true;
+            continue;
+        }
+        std::string_view data = file.view();
+        std::size_t chunkCount = (data.size() + chunkSize - 1) / chunkSize;
+        std::atomic<std::size_t> nextChunk{0};
+        std::vector<WorkerStats> stats(threadCount);
+
+        auto start = std::chrono::steady_clock::now();
+        std::vector<std::thread> workers;
+        for (unsigned t = 0; t < threadCount; ++t) {
+            workers.emplace_back([&, t] {
+                for (;;) {
+                    std::size_t chunk = nextChunk.fetch_add(1);
+                    if (chunk >= chunkCount) return;
+                    std::size_t begin = chunk * chunkSize;
+                    checkChunk(data, begin, std::min(begin + chunkSize, data.size()), stats[t]);
+                }
+            });
+        }
+        for (auto& w : workers) w.join();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        WorkerStats total;
+        for (auto& s : stats) {
+            total.games += s.games;
+            total.badGames += s.badGames;
+            total.plies += s.plies;
+            total.errors.insert(total.errors.end(), s.errors.begin(), s.errors.end());
+        }
+        std::sort(total.errors.begin(), total.errors.end(),
+                  [](const PgnError& a, const PgnError& b) { return a.offset < b.offset; });
+        if (!quiet) {
+            for (const auto& e : total.errors) {
+                std::fprintf(stderr, "%s:%zu: %s\n", path.c_str(), e.offset, e.message.c_str());
+            }
+        }
+        if (total.badGames > 0) anyBad = true;
+
+        double mb = data.size() / (1024.0 * 1024.0);
+        std::printf("%s: %ld games, %ld bad, %ld plies in %.2f s (%.0f games/sec, %.1f MB/sec, %u threads)\n",
+                    path.c_str(), total.games, total.badGames, total.plies, seconds,
+                    seconds > 0 ? total.games / seconds : 0.0, seconds > 0 ? mb / seconds : 0.0,
+                    threadCount);
+    }
+    return anyBad ? 1 : 0;
+}
@@ -0,0 +1,84 @@
+#include "pgn.h"
+#include <cassert>
+#include <iostream>
+#include <string>
+
+const std::string SCHOLARS_MATE =
+    "[Event \"Test\"]\n"
+    "[Result \"1-0\"]\n"
+    "\n"
+    "1. e4 e5 2. Bc4 {attack f7} Nc6 3. Qh5 Nf6?? (3... g6 4. Qf3) 4. Qxf7# 1-0\n";
+
+const std::string CASTLING_AND_PROMOTION =
+    "[Event \"Test\"]\n"
+    "[Result \"*\"]\n"
+    "\n"
+    "1. e4 d5 2. exd5 c6 3. dxc6 Nf6 4. cxb7 Nbd7 5. bxa8=N e5 6. Nf3 Bc5 7. Be2 O-O\n"
+    "8. O-O e4 9. d4 exd3 *\n";
+
+void testScholarsMate() {
+    PgnCheck check = checkPgnGame(SCHOLARS_MATE);
+    assert(check.ok);
+    assert(check.plies == 7);
+    assert(check.result == "1-0");
+}
+
+void testCastlingPromotionAndEnPassant() {
+    PgnCheck check = checkPgnGame(CASTLING_AND_PROMOTION);
+    assert(check.ok);
+    assert(check.plies == 18);
+}
+
+void testWrongResult() {
+    std::string text = SCHOLARS_MATE;
+    text.replace(text.find("\"1-0\""), 5, "\"0-1\"");
+    text.replace(text.rfind("1-0"), 3, "0-1");
+    PgnCheck check = checkPgnGame(text);
+    assert(!check.ok);
+}
+
+void testFenStart() {
+    std::string text =
+        "[Event \"Test\"]\n"
+        "[FEN \"6k1/5ppp/8/8/8/8/8/R5K1 w - - 0 1\"]\n"
+        "[Result \"1-0\"]\n"
+        "\n"
+        "1. Ra8# 1-0\n";
+    PgnCheck check = checkPgnGame(text);
+    assert(check.ok && check.plies == 1);
+    text.replace(text.find("6k1"), 3, "8");
+    check = checkPgnGame(text);
+    assert(!check.ok);
+}
+
+void testIllegalMoveOffset() {
+    std::string text = SCHOLARS_MATE;
+    text.replace(text.find("Qh5"), 3, "Qh6");
+    PgnCheck check = checkPgnGame(text);
+    assert(!check.ok);
+    assert(check.errorOffset == text.find("Qh6"));
+}
+
+void testSplitting() {
+    std::string data = SCHOLARS_MATE + "\n" + CASTLING_AND_PROMOTION + "\n" + SCHOLARS_MATE;
+    std::size_t second = SCHOLARS_MATE.size() + 1;
+    [[maybe_unused]] std::size_t third = second + CASTLING_AND_PROMOTION.size() + 1;
+    assert(findGameStart(data, 0) == 0);
+    // Starting inside a tag section or movetext skips to the next game
+    assert(findGameStart(data, 5) == second);
+    assert(findGameStart(data, second + 20) == third);
+    [[maybe_unused]] PgnGame game = readGame(data, second);
+    assert(game.offset == second && game.text.size() == third - second);
+    assert(pgnTag(game.text, "Result") == "*");
+}
+
+int main() {
+    testScholarsMate();
+    testCastlingPromotionAndEnPassant();
+    testWrongResult();
+    testFenStart();
+    testIllegalMoveOffset();
+    testSplitting();
+    std::cout << "All PGN tests passed\n";
+    return 0;
+}
@@ -0,0 +1,362 @@
+#include "search.h"
+#include "stats.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+const int INFINITE_SCORE = MATE_SCORE + 1;
+
+// Largest power of two number of slots that fits
+template <typename Slot>
+static std::size_t slotCount(std::size_t megabytes) {
+    std::size_t count = 1;
+    while (count * 2 * sizeof(Slot) <= megabytes * 1024 * 1024) count *= 2;
+    return count;
+}
+
+TranspositionTable::TranspositionTable(std::size_t megabytes) {
+    std::size_t count = slotCount<Slot>(megabytes);
+    owned.reset(new Slot[count]);
+    slots = owned.get();
+    mask = count - 1;
+}
+
+TranspositionTable::~TranspositionTable() {
+    if (mapping) munmap(mapping, mappingBytes);
+}
+
+static std::string shmName(const std::string& name) {
+    return name.empty() || name[0] != '/' ? "/" + name : name;
+}
+
+bool TranspositionTable::openShared(const std::string& name, std::size_t megabytes, std::string& error) {
+    // Plain atomics of lock-free words are all the slots hold, so they work
+    // across processes as they do across threads
+    static_assert(std::atomic<uint64_t>::is_always_lock_free, "table slots must be lock free");
+    static_assert(sizeof(Slot) == 16, "slots are read in place by other processes");
+    std::string path = shmName(name);
+    // Only the process that creates the segment sizes it. Truncating one that
+    // exists could shrink it under a process that has it mapped.
+    int fd = shm_open(path.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0660);
+    bool created = fd >= 0;
+    if (!created && errno == EEXIST) fd = shm_open(path.c_str(), O_RDWR | O_CLOEXEC, 0);
+    if (fd < 0) {
+        error = path + ": " + std::strerror(errno);
+        return false;
+    }
+    if (created && ftruncate(fd, static_cast<off_t>(slotCount<Slot>(megabytes) * sizeof(Slot))) < 0) {
+        error = path + ": " + std::strerror(errno);
+        ::close(fd);
+        shm_unlink(path.c_str());
+        return false;
+    }
+    // A process that created it a moment ago may not have sized it yet
+    struct stat st = {};
+    for (int waited = 0; fstat(fd, &st) == 0 && st.st_size == 0 && waited < 1000; ++waited) usleep(1000);
+    if (st.st_size == 0) {
+        error = path + ": never sized by the process that created it";
+        ::close(fd);
+        return false;
+    }
+    std::size_t bytes = static_cast<std::size_t>(st.st_size);
+    std::size_t count = bytes / sizeof(Slot);
+    if (bytes % sizeof(Slot) != 0 || (count & (count - 1)) != 0) {
+        error = path + ": not a transposition table";
+        ::close(fd);
+        return false;
+    }
+    void* p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (p == MAP_FAILED) {
+        error = path + ": " + std::strerror(errno);
+        return false;
+    }
+#ifdef MADV_HUGEPAGE
+    // Only a hint: tmpfs uses huge pages when shmem_enabled allows it
+    madvise(p, bytes, MADV_HUGEPAGE);
+#endif
+    if (mapping) munmap(mapping, mappingBytes);
+    owned.reset();
+    mapping = p;
+    mappingBytes = bytes;
+    slots = static_cast<Slot*>(p);
+    mask = count - 1;
+    return true;
+}
+
+bool TranspositionTable::removeShared(const std::string& name) {
+    return shm_unlink(shmName(name).c_str()) == 0;
+}
+
+static uint64_t packEntry(const TTEntry& e) {
+    return e.move | static_cast<uint64_t>(static_cast<uint16_t>(e.score)) << 16 |
+           static_cast<uint64_t>(static_cast<uint8_t>(e.depth)) << 32 | static_cast<uint64_t>(e.bound) << 40;
+}
+
+bool TranspositionTable::probe(uint64_t key, TTEntry& entry) const {
+    CHESS_TIME(STAT_TT_PROBE);
+    const Slot& slot = slots[key & mask];
+    uint64_t data = slot.data.load(std::memory_order_relaxed);
+    if ((slot.check.load(std::memory_order_relaxed) ^ data) != key) return false;
+    entry.move = static_cast<uint16_t>(data);
+    entry.score = static_cast<int16_t>(data >> 16);
+    entry.depth = static_cast<int8_t>(data >> 32);
+    entry.bound = static_cast<Bound>((data >> 40) & 3);
+    if (entry.bound == BOUND_NONE) return false;
+    CHESS_COUNT(STAT_TT_HIT);
+    return true;
+}
+
+void TranspositionTable::store(uint64_t key, const TTEntry& entry) {
+    CHESS_COUNT(STAT_TT_STORE);
+    Slot& slot = slots[key & mask];
+    uint64_t data = packEntry(entry);
+    slot.check.store(key ^ data, std::memory_order_relaxed);
+    slot.data.store(data, std::memory_order_relaxed);
+}
+
+void TranspositionTable::clear() {
+    if (mapping) return;
+    for (std::size_t i = 0; i <= mask; ++i) {
+        slots[i].check.store(0, std::memory_order_relaxed);
+        slots[i].data.store(0, std::memory_order_relaxed);
+    }
+}
+
+std::string scoreToString(int score) {
+    if (score >= MATE_SCORE - MAX_PLY) return "#" + std::to_string((MATE_SCORE - score + 1) / 2);
+    if (score <= -MATE_SCORE + MAX_PLY) return "#-" + std::to_string((MATE_SCORE + score) / 2);
+    return std::to_string(score);
+}
+
+// Mate scores are stored relative to the node so they stay valid when the
+// same position is reached at another ply
+static int scoreToTT(int score, int ply) {
+    if (score >= MATE_SCORE - MAX_PLY) return score + ply;
+    if (score <= -MATE_SCORE + MAX_PLY) return score - ply;
+    return score;
+}
+
+static int scoreFromTT(int score, int ply) {
+    if (score >= MATE_SCORE - MAX_PLY) return score - ply;
+    if (score <= -MATE_SCORE + MAX_PLY) return score + ply;
+    return score;
+}
+
+static bool sameSquares(const AIMove& a, const AIMove& b) {
+    return a.sr == b.sr && a.sc == b.sc && a.er == b.er && a.ec == b.ec;
+}
+
+static bool sideToMoveInCheck(const Game& game) {
+    int kRow, kCol;
+    findKing(game, game.isWhiteTurn, kRow, kCol);
+    return kRow != -1 && isSquareAttacked(game, kRow, kCol, !game.isWhiteTurn);
+}
+
+// Hash move first, then captures by most valuable victim / least valuable
+// attacker, then killers. Reuses AIMove::score as the sort key.
+static void orderMoves(const SearchContext& context, const Game& game, std::vector<AIMove>& moves,
+                       uint16_t hashMove, int ply) {
+    for (AIMove& m : moves) {
+        int from = m.sr * 8 + m.sc;
+        int to = m.er * 8 + m.ec;
+        Piece* victim = game.board[m.er][m.ec];
+        if (hashMove && (hashMove & 0xFFF) == (from | to << 6)) {
+            m.score = 1000000;
+        } else if (victim) {
+            m.score = 100000 + pieceValue(victim->type) * 100 - pieceValue(game.board[m.sr][m.sc]->type);
+        } else if (sameSquares(m, context.killers[ply][0])) {
+            m.score = 50000;
+        } else if (sameSquares(m, context.killers[ply][1])) {
+            m.score = 40000;
+        } else {
+            m.score = 0;
+        }
+    }
+    std::stable_sort(moves.begin(), moves.end(), [](const AIMove& a, const AIMove& b) { return a.score > b.score; });
+}
+
+static bool outOfNodes(SearchContext& context) {
+    if (context.nodeLimit && context.nodes >= context.nodeLimit) context.stopped = true;
+    if (context.abort && (context.nodes & 1023) == 0 && context.abort()) context.stopped = true;
+    return context.stopped;
+}
+
+static int quiesce(SearchContext& context, Game& game, const PositionKeys& keys, int alpha, int beta, int ply) {
+    ++context.nodes;
+    CHESS_COUNT(STAT_QUIESCENCE_NODE);
+    if (outOfNodes(context)) return 0;
+    int standPat = evaluate(game, keys, context.evalCaches);
+    if (standPat >= beta || ply >= MAX_PLY - 1) return standPat;
+    if (standPat > alpha) alpha = standPat;
+
+    std::vector<AIMove>& moves = context.moveLists[ply];
+    generateLegalMoves(game, game.isWhiteTurn, moves);
+    moves.erase(std::remove_if(moves.begin(), moves.end(),
+                               [&game](const AIMove& m) { return game.board[m.er][m.ec] == nullptr; }),
+                moves.end());
+    orderMoves(context, game, moves, 0, ply);
+    for (std::size_t i = 0; i < moves.size(); ++i) {
+        AIMove m = moves[i];
+        MoveUndo undo;
+        PositionKeys childKeys = keys;
+        makeMove(game, m, undo, childKeys);
+        int score = -quiesce(context, game, childKeys, -beta, -alpha, ply + 1);
+        unmakeMove(game, m, undo);
+        if (context.stopped) return 0;
+        if (score >= beta) return score;
+        if (score > alpha) alpha = score;
+    }
+    return alpha;
+}
+
+static int alphaBeta(SearchContext& context, Game& game, const PositionKeys& keys, int depth, int alpha, int beta,
+                     int ply, uint16_t* rootMove) {
+    if (depth <= 0) return quiesce(context, game, keys, alpha, beta, ply);
+    ++context.nodes;
+    CHESS_COUNT(STAT_SEARCH_NODE);
+    if (outOfNodes(context)) return 0;
+    if (ply > 0 && game.halfmoveClock >= 100) return 0;
+
+    uint64_t key = keys.key;
+    TTEntry entry;
+    uint16_t hashMove = 0;
+    if (context.tt && context.tt->probe(key, entry)) {
+        hashMove = entry.move;
+        int score = scoreFromTT(entry.score, ply);
+        if (ply > 0 && entry.depth >= depth &&
+            (entry.bound == BOUND_EXACT || (entry.bound == BOUND_LOWER && score >= beta) ||
+             (entry.bound == BOUND_UPPER && score <= alpha))) {
+            return score;
+        }
+    }
+    if (ply >= MAX_PLY - 1) return evaluate(game, keys, context.evalCaches);
+
+    std::vector<AIMove>& moves = context.moveLists[ply];
+    generateLegalMoves(game, game.isWhiteTurn, moves);
+    if (moves.empty()) return sideToMoveInCheck(game) ? -MATE_SCORE + ply : 0;
+    orderMoves(context, game, moves, hashMove, ply);
+
+    int originalAlpha = alpha;
+    int best = -INFINITE_SCORE;
+    AIMove bestMove = moves[0];
+    const std::vector<uint16_t>& excluded = context.excludedRootMoves;
+    bool excluding = ply == 0 && !excluded.empty();
+    for (std::size_t i = 0; i < moves.size(); ++i) {
+        AIMove m = moves[i];
+        if (excluding && std::find(excluded.begin(), excluded.end(), packMove(game, m)) != excluded.end()) continue;
+        bool quiet = game.board[m.er][m.ec] == nullptr;
+        MoveUndo undo;
+        PositionKeys childKeys = keys;
+        makeMove(game, m, undo, childKeys);
+        int score = -alphaBeta(context, game, childKeys, depth - 1, -beta, -alpha, ply + 1, nullptr);
+        unmakeMove(game, m, undo);
+        if (context.stopped) return 0;
+        if (score > best) {
+            best = score;
+            bestMove = m;
+            if (rootMove) *rootMove = packMove(game, m);
+        }
+        if (score > alpha) alpha = score;
+        if (alpha >= beta) {
+            if (quiet && !sameSquares(m, context.killers[ply][0])) {
+                context.killers[ply][1] = context.killers[ply][0];
+                context.killers[ply][0] = m;
+            }
+            break;
+        }
+    }
+
+    // A root searched without some of its moves has no true score to keep
+    if (context.tt && !excluding) {
+        TTEntry stored;
+        stored.move = packMove(game, bestMove);
+        stored.score = static_cast<int16_t>(scoreToTT(best, ply));
+        stored.depth = static_cast<int8_t>(depth);
+        stored.bound = best >= beta ? BOUND_LOWER : best > originalAlpha ? BOUND_EXACT : BOUND_UPPER;
+        context.tt->store(key, stored);
+    }
+    return best;
+}
+
+// Follows the table's best moves from the position after rootMove, as long
+// as they are legal and do not repeat a position
+static std::vector<uint16_t> principalVariation(SearchContext& context, Game& game, uint16_t rootMove,
+                                                int maxLength) {
+    std::vector<uint16_t> pv;
+    std::vector<std::pair<AIMove, MoveUndo>> played;
+    std::vector<uint64_t> seen;
+    uint16_t next = rootMove;
+    std::vector<AIMove> moves;
+    while (next && static_cast<int>(pv.size()) < maxLength) {
+        std::string promotion;
+        AIMove m = unpackMove(next, promotion);
+        generateLegalMoves(game, game.isWhiteTurn, moves);
+        if (std::none_of(moves.begin(), moves.end(), [&](const AIMove& l) { return sameSquares(l, m); })) break;
+        pv.push_back(next);
+        played.emplace_back(m, MoveUndo());
+        makeMove(game, m, played.back().second, promotion);
+        uint64_t key = zobristKey(game);
+        if (std::find(seen.begin(), seen.end(), key) != seen.end()) break;
+        seen.push_back(key);
+        TTEntry entry;
+        next = context.tt && context.tt->probe(key, entry) ? entry.move : 0;
+    }
+    for (auto it = played.rbegin(); it != played.rend(); ++it) unmakeMove(game, it->first, it->second);
+    return pv;
+}
+
+SearchResult searchPosition(SearchContext& context, Game& game, const SearchLimits& limits) {
+    CHESS_TIME(STAT_SEARCH);
+    context.nodes = 0;
+    context.nodeLimit = limits.nodes;
+    context.abort = limits.abort;
+    context.stopped = false;
+    context.excludedRootMoves.clear();
+    for (auto& k : context.killers) k[0] = k[1] = AIMove{};
+
+    SearchResult result;
+    PositionKeys keys = positionKeys(game);
+    int maxDepth = std::min(std::max(limits.depth, 1), MAX_PLY - 1);
+    generateLegalMoves(game, game.isWhiteTurn, context.moveLists[0]);
+    int lineCount = std::max(1, std::min(limits.multiPv, static_cast<int>(context.moveLists[0].size())));
+    for (int depth = 1; depth <= maxDepth; ++depth) {
+        std::vector<PvLine> lines;
+        uint16_t rootMove = 0;
+        for (int line = 0; line < lineCount; ++line) {
+            rootMove = 0;
+            int score = alphaBeta(context, game, keys, depth, -INFINITE_SCORE, INFINITE_SCORE, 0, &rootMove);
+            if (context.stopped) break;
+            lines.push_back({score, principalVariation(context, game, rootMove, depth)});
+            context.excludedRootMoves.push_back(rootMove);
+        }
+        context.excludedRootMoves.clear();
+        if (context.stopped) {
+            // Better than nothing if even the first iteration ran out of nodes
+            if (result.depth == 0) result.bestMove = lines.empty() ? rootMove : lines[0].moves.front();
+            break;
+        }
+        // Table hits can leave a later line scoring above an earlier one
+        std::stable_sort(lines.begin(), lines.end(), [](const PvLine& a, const PvLine& b) { return a.score > b.score; });
+        result.bestMove = lines[0].moves.empty() ? 0 : lines[0].moves[0];
+        result.score = lines[0].score;
+        result.depth = depth;
+        result.nodes = context.nodes;
+        result.lines = std::move(lines);
+        if (result.score >= MATE_SCORE - MAX_PLY || result.score <= -MATE_SCORE + MAX_PLY) break;
+        if (limits.iterationDone && !limits.iterationDone(result)) break;
+    }
+    result.nodes = context.nodes;
+    return result;
+}
+
+int quiescence(SearchContext& context, Game& game) {
+    context.nodeLimit = 0;
+    context.abort = nullptr;
+    context.stopped = false;
+    return quiesce(context, game, positionKeys(game), -INFINITE_SCORE, INFINITE_SCORE, 0);
+}
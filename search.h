@@ -0,0 +1,113 @@
+#pragma once
+
+#include "eval.h"
+#include "game.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Alpha-beta search for the headless tools. One TranspositionTable can be
+// shared by any number of threads; each thread searches with its own
+// SearchContext, which keeps its buffers between positions.
+
+const int MATE_SCORE = 30000; // mate at the root; mate in n plies is MATE_SCORE - n
+const int MAX_PLY = 64;
+
+enum Bound : uint8_t { BOUND_NONE, BOUND_UPPER, BOUND_LOWER, BOUND_EXACT };
+
+struct TTEntry {
+    uint16_t move = 0; // packed move, 0 if none
+    int16_t score = 0;
+    int8_t depth = 0;
+    Bound bound = BOUND_NONE;
+};
+
+// Fixed-size, always-replace table. A slot is two 64-bit words written without
+// locks; the first holds key ^ data, so a slot torn by two threads writing at
+// once fails the key check and reads as a miss. The same holds between
+// processes, so the table can also live in shared memory.
+class TranspositionTable {
+public:
+    explicit TranspositionTable(std::size_t megabytes);
+    TranspositionTable(const TranspositionTable&) = delete;
+    TranspositionTable& operator=(const TranspositionTable&) = delete;
+    ~TranspositionTable();
+
+    // Moves the table into the named POSIX shared-memory segment, creating it
+    // if no process has yet. Every process that opens the same name works on
+    // the same entries; the first one decides the size. The segment outlives
+    // the processes until removed with removeShared() (or from /dev/shm).
+    // Huge pages are asked for where the kernel offers them for shared memory.
+    // Returns false and fills error, keeping the private table, on failure.
+    // Call before any thread uses the table.
+    bool openShared(const std::string& name, std::size_t megabytes, std::string& error);
+    static bool removeShared(const std::string& name);
+    bool isShared() const { return mapping != nullptr; }
+
+    bool probe(uint64_t key, TTEntry& entry) const;
+    void store(uint64_t key, const TTEntry& entry);
+    // Empties a private table. A shared one is left alone, since other
+    // processes are relying on it.
+    void clear();
+    std::size_t size() const { return mask + 1; }
+
+private:
+    struct Slot {
+        std::atomic<uint64_t> check{0};
+        std::atomic<uint64_t> data{0};
+    };
+    Slot* slots = nullptr;
+    std::unique_ptr<Slot[]> owned; // unless shared
+    void* mapping = nullptr;
+    std::size_t mappingBytes = 0;
+    uint64_t mask = 0;
+};
+
+struct PvLine {
+    int score = 0;               // centipawns for the side to move
+    std::vector<uint16_t> moves; // principal variation, packed, read back from the table
+};
+
+struct SearchResult {
+    uint16_t bestMove = 0; // packed, 0 when the side to move has no moves
+    int score = 0;         // centipawns for the side to move
+    int depth = 0;         // last fully searched depth
+    uint64_t nodes = 0;
+    std::vector<PvLine> lines; // of the last completed depth, best first
+};
+
+struct SearchLimits {
+    int depth = 5;
+    uint64_t nodes = 0; // stop after about this many nodes, 0 for no limit
+    // Lines per depth. Each line searches the root without the first moves of
+    // the lines before it; they share the table, so later lines are cheap.
+    int multiPv = 1;
+    // Polled every 1024 nodes; returning true abandons the current iteration
+    std::function<bool()> abort;
+    // Called after every completed iteration; returning false stops deepening
+    std::function<bool(const SearchResult&)> iterationDone;
+};
+
+struct SearchContext {
+    TranspositionTable* tt = nullptr;
+    uint64_t nodes = 0;
+    uint64_t nodeLimit = 0;
+    std::function<bool()> abort;
+    bool stopped = false;
+    std::vector<uint16_t> excludedRootMoves; // for multi-PV
+    std::vector<AIMove> moveLists[MAX_PLY];  // reused at every ply
+    AIMove killers[MAX_PLY][2] = {};
+    EvalCaches evalCaches; // kept between searches, evaluations do not go stale
+};
+
+// Iterative deepening up to limits.depth. The game is restored on return.
+SearchResult searchPosition(SearchContext& context, Game& game, const SearchLimits& limits);
+// Static evaluation once the pending captures have played out. Differs from
+// evaluate() when the position is not quiet.
+int quiescence(SearchContext& context, Game& game);
+// "35", "-120", "#3" (mate in 3 moves) or "#-2" (mated in 2)
+std::string scoreToString(int score);
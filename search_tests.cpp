@@ -0,0 +1,326 @@
+#include "search.h"
+#include <sys/wait.h>
+#include <unistd.h>
+#include <cassert>
+#include <iostream>
+#include <string>
+
+const std::string START_FEN = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+
+// Outside assert, so the position is set up in release builds too
+static void setPosition(Game& game, const std::string& fen) {
+    std::string error;
+    [[maybe_unused]] bool ok = loadFen(game, fen, error);
+    assert(ok);
+}
+
+void testFenRoundTrip() {
+    Game game;
+    setPosition(game, START_FEN);
+    assert(toFen(game) == START_FEN);
+
+    Game standard;
+    default_board(standard);
+    assert(zobristKey(game) == zobristKey(standard));
+
+    const std::string fen = "r3k2r/8/8/3pP3/8/8/8/R3K2R w Kq d6 0 23";
+    setPosition(game, fen);
+    assert(toFen(game) == fen);
+    assert(game.castlingRights == (CASTLE_WHITE_KINGSIDE | CASTLE_BLACK_QUEENSIDE));
+    assert(game.enPassant.row == 2 && game.enPassant.col == 3);
+
+    // Move counters are optional
+    setPosition(game, "8/8/8/8/8/8/8/K6k b - -");
+    assert(!game.isWhiteTurn && game.fullmoveNumber == 1);
+}
+
+void testBadFen() {
+    Game game;
+    std::string error;
+    const char* const bad[] = {
+        "",
+        "8/8/8/8/8/8/8/8 w - - 0 1",                       // no kings
+        "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP w KQkq - 0 1", // seven ranks
+        "k6R/8/8/8/8/8/8/K7 w - - 0 1",                    // black in check, white to move
+        "k7/8/8/8/8/8/8/K7 x - - 0 1",
+    };
+    for (const char* fen : bad) {
+        [[maybe_unused]] bool ok = loadFen(game, fen, error);
+        assert(!ok);
+    }
+}
+
+void testMakeUnmakeRestoresPosition() {
+    // Castling, en passant and promotion all in reach
+    Game game;
+    const std::string fen = "r3k2r/1P6/8/3pP3/8/8/8/R3K2R w KQkq d6 0 1";
+    setPosition(game, fen);
+    [[maybe_unused]] uint64_t key = zobristKey(game);
+    std::vector<AIMove> moves = generateLegalMoves(game, true);
+    for (const AIMove& m : moves) {
+        MoveUndo undo;
+        makeMove(game, m, undo);
+        unmakeMove(game, m, undo);
+        assert(toFen(game) == fen);
+        assert(zobristKey(game) == key);
+    }
+
+    // makeMove agrees with the full move path
+    for (const AIMove& m : moves) {
+        Game played(game);
+        [[maybe_unused]] bool ok = applyMove(played, m);
+        assert(ok);
+        Game made(game);
+        MoveUndo undo;
+        makeMove(made, m, undo);
+        assert(toFen(made) == toFen(played));
+        delete undo.captured; // makeMove leaves captured pieces to the caller
+    }
+}
+
+static long perft(Game& game, int depth) {
+    if (depth == 0) return 1;
+    static const char* const promotions[] = {"queen", "rook", "bishop", "knight"};
+    long count = 0;
+    for (const AIMove& m : generateLegalMoves(game, game.isWhiteTurn)) {
+        Piece* p = game.board[m.sr][m.sc];
+        bool promotes = p->type.find("pawn") != std::string::npos && (m.er == 0 || m.er == BOARD_SIZE - 1);
+        for (int i = 0; i < (promotes ? 4 : 1); ++i) {
+            MoveUndo undo;
+            makeMove(game, m, undo, promotions[i]);
+            count += perft(game, depth - 1);
+            unmakeMove(game, m, undo);
+        }
+    }
+    return count;
+}
+
+void testPerft() {
+    // Reference counts for well-known test positions
+    Game game;
+    setPosition(game, START_FEN);
+    assert(perft(game, 3) == 8902);
+    setPosition(game, "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1");
+    assert(perft(game, 2) == 2039);
+    setPosition(game, "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1");
+    assert(perft(game, 3) == 2812);
+}
+
+// Walks the tree checking the keys kept move by move against fresh ones, and
+// the cached evaluation against the plain one
+void checkKeysAndEval(Game& game, const PositionKeys& keys, EvalCaches& caches, int depth) {
+    [[maybe_unused]] PositionKeys fresh = positionKeys(game);
+    assert(keys.key == fresh.key && keys.pawnKey == fresh.pawnKey);
+    assert(evaluate(game, keys, caches) == evaluate(game));
+    if (depth == 0) return;
+    static const char* const promotions[] = {"queen", "knight"};
+    for (const AIMove& m : generateLegalMoves(game, game.isWhiteTurn)) {
+        Piece* p = game.board[m.sr][m.sc];
+        bool promotes = p->type.find("pawn") != std::string::npos && (m.er == 0 || m.er == BOARD_SIZE - 1);
+        for (int i = 0; i < (promotes ? 2 : 1); ++i) {
+            MoveUndo undo;
+            PositionKeys childKeys = keys;
+            makeMove(game, m, undo, childKeys, promotions[i]);
+            checkKeysAndEval(game, childKeys, caches, depth - 1);
+            unmakeMove(game, m, undo);
+        }
+    }
+}
+
+void testIncrementalKeys() {
+    // Castling, en passant, promotion with and without capture
+    const char* fens[] = {"r3k2r/1P6/8/3pP3/8/8/8/R3K2R w KQkq d6 0 1",
+                          "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+                          "n1n4k/1P6/8/8/8/8/6p1/K4N1N b - - 0 1"};
+    EvalCaches caches;
+    for (const char* fen : fens) {
+        Game game;
+        setPosition(game, fen);
+        checkKeysAndEval(game, positionKeys(game), caches, 3);
+        assert(toFen(game) == fen);
+    }
+    assert(caches.evals.hits > 0 && caches.pawns.hits > 0);
+
+    // With no pawns on the board the pawn key is still not zero
+    Game bare;
+    setPosition(bare, "4k3/8/8/8/8/8/8/4K3 w - - 0 1");
+    assert(positionKeys(bare).pawnKey != 0);
+}
+
+void testPawnStructure() {
+    Game game;
+    // An isolated passed pawn two steps from home
+    setPosition(game, "4k3/8/8/8/4P3/8/8/4K3 w - - 0 1");
+    assert(evaluate(game) - evaluateMaterial(game) == PASSED_PAWN[2] - ISOLATED_PAWN);
+    // Doubled and isolated, the rear pawn blocked by its own front pawn only
+    setPosition(game, "4k3/8/8/8/4P3/4P3/8/4K3 b - - 0 1");
+    assert(evaluate(game) - evaluateMaterial(game) ==
+           -(PASSED_PAWN[2] + PASSED_PAWN[1] - 2 * ISOLATED_PAWN - DOUBLED_PAWN));
+    // Not passed: an enemy pawn ahead on the next file
+    setPosition(game, "4k3/3p4/8/8/4P3/8/8/4K3 w - - 0 1");
+    assert(evaluate(game) == evaluateMaterial(game));
+    // Shelter counts only while the other side has its queen
+    setPosition(game, "3qk3/8/8/8/8/8/8/4K3 w - - 0 1");
+    assert(evaluate(game) - evaluateMaterial(game) == -3 * SHELTER_PAWN_MISSING);
+    setPosition(game, "4k3/8/8/8/8/8/8/4K3 w - - 0 1");
+    assert(evaluate(game) == evaluateMaterial(game));
+}
+
+void testFindsMateInOne() {
+    Game game;
+    // Back rank mate: Ra1-a8
+    setPosition(game, "6k1/5ppp/8/8/8/8/8/R5K1 w - - 0 1");
+    TranspositionTable tt(1);
+    SearchContext context;
+    context.tt = &tt;
+    SearchLimits limits;
+    limits.depth = 3;
+    SearchResult result = searchPosition(context, game, limits);
+    assert(packedMoveToString(result.bestMove) == "a1a8");
+    assert(result.score == MATE_SCORE - 1);
+    assert(scoreToString(result.score) == "#1");
+    assert(toFen(game) == "6k1/5ppp/8/8/8/8/8/R5K1 w - - 0 1");
+}
+
+void testWinsHangingQueen() {
+    Game game;
+    setPosition(game, "4k3/8/8/3q4/8/8/3R4/4K3 w - - 0 1");
+    TranspositionTable tt(1);
+    SearchContext context;
+    context.tt = &tt;
+    SearchLimits limits;
+    limits.depth = 2;
+    SearchResult result = searchPosition(context, game, limits);
+    assert(packedMoveToString(result.bestMove) == "d2d5");
+    assert(result.score > 0);
+}
+
+void testNodeLimit() {
+    Game game;
+    default_board(game);
+    TranspositionTable tt(1);
+    SearchContext context;
+    context.tt = &tt;
+    SearchLimits limits;
+    limits.depth = 20;
+    limits.nodes = 2000;
+    SearchResult result = searchPosition(context, game, limits);
+    assert(result.bestMove != 0);
+    assert(result.nodes <= 2000);
+    assert(result.depth < 20);
+}
+
+void testMultiPv() {
+    Game game;
+    setPosition(game, "r1bqkbnr/pppp1ppp/2n5/4p3/4P3/5N2/PPPP1PPP/RNBQKB1R w KQkq - 2 3");
+    std::string before = toFen(game);
+    TranspositionTable tt(4);
+    SearchContext context;
+    context.tt = &tt;
+    SearchLimits limits;
+    limits.depth = 4;
+    SearchResult single = searchPosition(context, game, limits);
+    assert(single.lines.size() == 1 && single.lines[0].moves[0] == single.bestMove);
+
+    tt.clear();
+    limits.multiPv = 4;
+    SearchResult multi = searchPosition(context, game, limits);
+    assert(toFen(game) == before);
+    assert(multi.lines.size() == 4);
+    assert(multi.bestMove == single.bestMove && multi.score == single.score);
+    // Later lines reuse the table, so four lines cost far less than four searches
+    assert(multi.nodes < 3 * single.nodes);
+    for (std::size_t i = 0; i < multi.lines.size(); ++i) {
+        const PvLine& line = multi.lines[i];
+        assert(i == 0 || line.score <= multi.lines[i - 1].score);
+        for (std::size_t j = 0; j < i; ++j) assert(line.moves[0] != multi.lines[j].moves[0]);
+        // Every line is playable
+        std::vector<std::pair<AIMove, MoveUndo>> played;
+        for (uint16_t packed : line.moves) {
+            std::string promotion;
+            AIMove m = unpackMove(packed, promotion);
+            bool legal = false;
+            for (const AIMove& l : generateLegalMoves(game, game.isWhiteTurn)) {
+                legal = legal || (l.sr == m.sr && l.sc == m.sc && l.er == m.er && l.ec == m.ec);
+            }
+            assert(legal);
+            played.emplace_back(m, MoveUndo());
+            makeMove(game, m, played.back().second, promotion);
+        }
+        for (auto it = played.rbegin(); it != played.rend(); ++it) unmakeMove(game, it->first, it->second);
+    }
+
+    // No more lines than moves
+    setPosition(game, "7k/8/8/8/8/8/8/K7 w - - 0 1");
+    limits.multiPv = 10;
+    assert(searchPosition(context, game, limits).lines.size() == 3);
+}
+
+void testSharedTable() {
+    std::string name = "/chess-search-tests-" + std::to_string(getpid());
+    TranspositionTable::removeShared(name);
+    std::string error;
+
+    // Another process fills the table...
+    pid_t child = fork();
+    assert(child >= 0);
+    if (child == 0) {
+        TranspositionTable tt(1);
+        if (!tt.openShared(name, 2, error)) _exit(1);
+        Game game;
+        loadFen(game, START_FEN, error);
+        SearchContext context;
+        context.tt = &tt;
+        SearchLimits limits;
+        limits.depth = 3;
+        _exit(searchPosition(context, game, limits).bestMove ? 0 : 1);
+    }
+    int status = 0;
+    [[maybe_unused]] pid_t waited = waitpid(child, &status, 0);
+    assert(waited == child && WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+    // ...and this one finds its work, in a table of the size the first chose
+    TranspositionTable first(1);
+    [[maybe_unused]] bool ok = first.openShared(name, 8, error);
+    assert(ok && first.isShared());
+    assert(first.size() == 2 * 1024 * 1024 / 16);
+    Game game;
+    setPosition(game, START_FEN);
+    TTEntry entry;
+    assert(first.probe(zobristKey(game), entry) && entry.move != 0 && entry.depth == 3);
+
+    // Two attachments in one process see each other's stores, and clearing
+    // one leaves the shared entries alone
+    TranspositionTable second(1);
+    ok = second.openShared(name.substr(1), 2, error);
+    assert(ok);
+    TTEntry stored;
+    stored.move = 1234;
+    stored.score = -56;
+    stored.depth = 7;
+    stored.bound = BOUND_LOWER;
+    second.store(42, stored);
+    first.clear();
+    assert(first.probe(42, entry) && entry.move == 1234 && entry.score == -56 && entry.depth == 7);
+
+    ok = TranspositionTable::removeShared(name);
+    assert(ok);
+    ok = TranspositionTable::removeShared(name);
+    assert(!ok);
+}
+
+int main() {
+    testFenRoundTrip();
+    testBadFen();
+    testMakeUnmakeRestoresPosition();
+    testPerft();
+    testIncrementalKeys();
+    testPawnStructure();
+    testFindsMateInOne();
+    testWinsHangingQueen();
+    testNodeLimit();
+    testMultiPv();
+    testSharedTable();
+    std::cout << "All search tests passed\n";
+    return 0;
+}
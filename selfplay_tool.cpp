@@ -0,0 +1,246 @@
+// Generates training positions by self-play. Every worker plays whole games
+// with a fixed node budget per move, after a few random opening moves for
+// variety, and keeps the quiet positions: side to move not in check, best move
+// not a capture or promotion, and no capture sequence that changes the static
+// evaluation. Once a game ends each kept position is labelled with the result
+// and written as a PackedPosition to the worker's own shard,
+// PREFIX-NN.bin, through a large stdio buffer.
+//
+// Games are seeded from --seed and their number, so a game plays out the same
+// whichever thread picks it up. --stats-log appends the hot-path counters to
+// FILE as a JSON line every second (all zero unless built with
+// -DCHESS_STATS=ON).
+//
+// Usage: chess_selfplay [--threads N] [--games N] [--nodes N] [--random-plies N]
+//                       [--max-plies N] [--hash MB] [--seed N] [--stats-log FILE] PREFIX
+#include "search.h"
+#include "stats.h"
+#include "training.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct SelfPlaySettings {
+    long games = 100;
+    uint64_t nodes = 2000;
+    int randomPlies = 8;
+    int maxPlies = 300;
+    std::size_t hashMb = 16;
+    uint64_t seed = 1;
+};
+
+struct WorkerStats {
+    long games = 0;
+    long positions = 0;
+    long plies = 0;
+    long whiteWins = 0;
+    long blackWins = 0;
+    long draws = 0;
+};
+
+static bool sideToMoveInCheck(const Game& game) {
+    int kRow, kCol;
+    findKing(game, game.isWhiteTurn, kRow, kCol);
+    return kRow != -1 && isSquareAttacked(game, kRow, kCol, !game.isWhiteTurn);
+}
+
+static bool onlyKingsLeft(const Game& game) {
+    for (int r = 0; r < BOARD_SIZE; ++r) {
+        for (int c = 0; c < BOARD_SIZE; ++c) {
+            Piece* p = game.board[r][c];
+            if (p && p->type.find("king") == std::string::npos) return false;
+        }
+    }
+    return true;
+}
+
+// Plays move and frees whatever it captured
+static void playMove(Game& game, const AIMove& move, const std::string& promotion = "queen") {
+    MoveUndo undo;
+    makeMove(game, move, undo, promotion);
+    delete undo.captured;
+}
+
+// Plays one game and appends its quiet positions, labelled with the result
+static void playGame(SearchContext& context, const SelfPlaySettings& settings, uint64_t gameNumber,
+                    std::vector<PackedPosition>& out, WorkerStats& stats) {
+    std::mt19937_64 rng(settings.seed * 0x9E3779B97F4A7C15ull + gameNumber);
+    Game game;
+    default_board(game);
+    context.tt->clear();
+
+    std::vector<AIMove> moves;
+    for (int ply = 0; ply < settings.randomPlies; ++ply) {
+        generateLegalMoves(game, game.isWhiteTurn, moves);
+        if (moves.empty()) break;
+        playMove(game, moves[rng() % moves.size()]);
+    }
+
+    std::size_t firstKept = out.size();
+    std::vector<uint64_t> history;
+    SearchLimits limits;
+    limits.depth = MAX_PLY - 1;
+    limits.nodes = settings.nodes;
+    int result = 0;
+    for (int ply = 0; ply < settings.maxPlies; ++ply) {
+        uint64_t key = zobristKey(game);
+        // Repetition only needs checking back to the last capture or pawn move
+        std::size_t since = std::min<std::size_t>(history.size(), game.halfmoveClock);
+        int seen = 0;
+        for (std::size_t i = history.size() - since; i < history.size(); ++i) {
+            if (history[i] == key) ++seen;
+        }
+        if (seen >= 2 || game.halfmoveClock >= 100 || onlyKingsLeft(game)) break;
+        if (!hasAnyLegalMoves(game, game.isWhiteTurn)) {
+            // Mate or stalemate
+            if (sideToMoveInCheck(game)) result = game.isWhiteTurn ? -1 : 1;
+            break;
+        }
+        history.push_back(key);
+
+        SearchResult found = searchPosition(context, game, limits);
+        ++stats.plies;
+        // Without a finished iteration the score means nothing, and the move
+        // may be missing if the nodes ran out before the first root move
+        bool searched = found.depth > 0;
+        if (!found.bestMove) {
+            SearchLimits fallback;
+            fallback.depth = 1;
+            found = searchPosition(context, game, fallback);
+        }
+        std::string promotion;
+        AIMove move = unpackMove(found.bestMove, promotion);
+        bool quietMove = game.board[move.er][move.ec] == nullptr && !(found.bestMove >> 12);
+        bool decided = found.score >= MATE_SCORE - MAX_PLY || found.score <= -MATE_SCORE + MAX_PLY;
+        if (searched && quietMove && !decided && !sideToMoveInCheck(game) &&
+            quiescence(context, game) == evaluate(game)) {
+            int whiteScore = game.isWhiteTurn ? found.score : -found.score;
+            out.push_back(packPosition(game, whiteScore, 0));
+        }
+        playMove(game, move, promotion);
+    }
+    for (std::size_t i = firstKept; i < out.size(); ++i) out[i].result = static_cast<int8_t>(result);
+    ++stats.games;
+    stats.positions += static_cast<long>(out.size() - firstKept);
+    if (result > 0) ++stats.whiteWins;
+    else if (result < 0) ++stats.blackWins;
+    else ++stats.draws;
+}
+
+static void usage() {
+    std::cerr << "Usage: chess_selfplay [--threads N] [--games N] [--nodes N] [--random-plies N]\n"
+                 "                      [--max-plies N] [--hash MB] [--seed N] [--stats-log FILE] PREFIX\n";
+}
+
+int main(int argc, char* argv[]) {
+    unsigned threadCount = std::thread::hardware_concurrency();
+    SelfPlaySettings settings;
+    std::string prefix;
+    std::string statsPath;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--threads" && i + 1 < argc) {
+            threadCount = static_cast<unsigned>(std::atoi(argv[++i]));
+        } else if (arg == "--games" && i + 1 < argc) {
+            settings.games = std::atol(argv[++i]);
+        } else if (arg == "--nodes" && i + 1 < argc) {
+            settings.nodes = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--random-plies" && i + 1 < argc) {
+            settings.randomPlies = std::atoi(argv[++i]);
+        } else if (arg == "--max-plies" && i + 1 < argc) {
+            settings.maxPlies = std::atoi(argv[++i]);
+        } else if (arg == "--hash" && i + 1 < argc) {
+            settings.hashMb = static_cast<std::size_t>(std::atoi(argv[++i]));
+        } else if (arg == "--seed" && i + 1 < argc) {
+            settings.seed = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--stats-log" && i + 1 < argc) {
+            statsPath = argv[++i];
+        } else if (!arg.empty() && arg[0] == '-') {
+            usage();
+            return 1;
+        } else {
+            prefix = arg;
+        }
+    }
+    if (prefix.empty()) {
+        usage();
+        return 1;
+    }
+    if (threadCount == 0) threadCount = 1;
+    if (settings.hashMb == 0) settings.hashMb = 1;
+    std::unique_ptr<StatsDump> statsDump;
+    if (!statsPath.empty()) {
+        statsDump.reset(new StatsDump(statsPath));
+        if (!statsDump->ok()) {
+            std::cerr << statsPath << ": " << std::strerror(errno) << "\n";
+            return 1;
+        }
+    }
+
+    std::vector<FILE*> shards(threadCount);
+    for (unsigned t = 0; t < threadCount; ++t) {
+        char name[16];
+        std::snprintf(name, sizeof(name), "-%02u.bin", t);
+        std::string path = prefix + name;
+        shards[t] = fopen(path.c_str(), "wb");
+        if (!shards[t]) {
+            std::cerr << path << ": " << std::strerror(errno) << "\n";
+            return 1;
+        }
+        setvbuf(shards[t], nullptr, _IOFBF, 1 << 20);
+    }
+
+    std::atomic<long> nextGame{0};
+    std::vector<WorkerStats> stats(threadCount);
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    for (unsigned t = 0; t < threadCount; ++t) {
+        workers.emplace_back([&, t] {
+            TranspositionTable tt(settings.hashMb);
+            SearchContext context;
+            context.tt = &tt;
+            std::vector<PackedPosition> positions;
+            for (;;) {
+                long number = nextGame.fetch_add(1);
+                if (number >= settings.games) break;
+                positions.clear();
+                playGame(context, settings, static_cast<uint64_t>(number), positions, stats[t]);
+                fwrite(positions.data(), sizeof(PackedPosition), positions.size(), shards[t]);
+            }
+        });
+    }
+    for (auto& w : workers) w.join();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    bool ok = true;
+    for (FILE* f : shards) ok = fclose(f) == 0 && ok;
+    WorkerStats total;
+    for (const auto& s : stats) {
+        total.games += s.games;
+        total.positions += s.positions;
+        total.plies += s.plies;
+        total.whiteWins += s.whiteWins;
+        total.blackWins += s.blackWins;
+        total.draws += s.draws;
+    }
+    double perSecond = seconds > 0 ? total.positions / seconds : 0.0;
+    std::printf("%ld games (+%ld =%ld -%ld), %ld plies, %ld positions kept in %.2f s\n", total.games,
+                total.whiteWins, total.draws, total.blackWins, total.plies, total.positions, seconds);
+    std::printf("%.0f positions/sec, %.0f positions/sec per core (%u threads)\n", perSecond,
+                perSecond / threadCount, threadCount);
+    if (!ok) {
+        std::cerr << "failed to write shards\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,430 @@
+// Headless game server. Every connection plays one game as white against the
+// engine using a line based text protocol:
+//
+//   NEW          start a new game          -> OK
+//   MOVES        list the legal moves      -> MOVES e2e4 d2d4 ...
+//   MOVE e2e4    play a move               -> OK <engine move or -> <result>
+//                                             ERR <reason>
+//   QUIT         close the connection
+//
+// <result> is "*" while the game is running, otherwise the PGN result.
+// Engine turns run on a worker pool so the event loop never waits on a search;
+// while a connection's engine turn is running its game belongs to the worker
+// and further commands from that client are held back until it finishes.
+//
+// Usage: chess_server [--port N] [--unix PATH] [--workers N] [--verbose]
+#include "game.h"
+#include "ai.h"
+#include "log.h"
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+const std::size_t MAX_LINE = 4096;
+
+struct Connection {
+    int fd;
+    std::string in;
+    std::string out;
+    Game game;
+    bool busy = false;    // an engine turn is running on a worker
+    bool closing = false; // close once the output has been flushed
+    bool eof = false;     // the client has sent all it will; answer, then close
+    bool closed = false;
+};
+
+class WorkerPool {
+public:
+    explicit WorkerPool(unsigned count) {
+        for (unsigned i = 0; i < count; ++i) {
+            threads.emplace_back([this] { run(); });
+        }
+    }
+
+    ~WorkerPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto& t : threads) t.join();
+    }
+
+    void submit(std::function<void()> job) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            jobs.push_back(std::move(job));
+        }
+        wake.notify_one();
+    }
+
+private:
+    void run() {
+        for (;;) {
+            std::function<void()> job;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [this] { return stopping || !jobs.empty(); });
+                if (jobs.empty()) return;
+                job = std::move(jobs.front());
+                jobs.pop_front();
+            }
+            job();
+        }
+    }
+
+    std::vector<std::thread> threads;
+    std::deque<std::function<void()>> jobs;
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool stopping = false;
+};
+
+struct EngineResult {
+    std::shared_ptr<Connection> conn;
+    std::string reply;
+};
+
+int epollFd = -1;
+int wakeFd = -1;
+std::unordered_map<int, std::shared_ptr<Connection>> connections;
+std::mutex resultsMutex;
+std::vector<EngineResult> results;
+
+bool setNonBlocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    return flags != -1 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) != -1;
+}
+
+void closeConnection(const std::shared_ptr<Connection>& conn) {
+    if (conn->closed) return;
+    epoll_ctl(epollFd, EPOLL_CTL_DEL, conn->fd, nullptr);
+    close(conn->fd);
+    conn->closed = true;
+    connections.erase(conn->fd);
+}
+
+void flushOutput(const std::shared_ptr<Connection>& conn) {
+    while (!conn->out.empty()) {
+        ssize_t n = send(conn->fd, conn->out.data(), conn->out.size(), MSG_NOSIGNAL);
+        if (n > 0) {
+            conn->out.erase(0, static_cast<std::size_t>(n));
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        } else {
+            closeConnection(conn);
+            return;
+        }
+    }
+    if (conn->out.empty() && conn->closing) {
+        closeConnection(conn);
+        return;
+    }
+    // Once the client has half-closed there is nothing left to read
+    uint32_t extra = conn->out.empty() ? 0u : uint32_t(EPOLLOUT);
+    epoll_event ev{};
+    ev.events = (conn->eof ? 0u : uint32_t(EPOLLIN | EPOLLRDHUP)) | extra;
+    ev.data.fd = conn->fd;
+    epoll_ctl(epollFd, EPOLL_CTL_MOD, conn->fd, &ev);
+}
+
+void startEngineTurn(WorkerPool& pool, const std::shared_ptr<Connection>& conn) {
+    conn->busy = true;
+    pool.submit([conn] {
+        Game& game = conn->game;
+        std::string reply = "-";
+        if (auto move = chooseGreedyMove(game)) {
+            reply = moveToString(game, *move);
+            applyMove(game, *move);
+        }
+        EngineResult result{conn, "OK " + reply + " " + resultString(game) + "\n"};
+        {
+            std::lock_guard<std::mutex> lock(resultsMutex);
+            results.push_back(std::move(result));
+        }
+        uint64_t one = 1;
+        ssize_t ignored = write(wakeFd, &one, sizeof(one));
+        (void)ignored;
+    });
+}
+
+void handleCommand(WorkerPool& pool, const std::shared_ptr<Connection>& conn, const std::string& line) {
+    std::istringstream iss(line);
+    std::string command;
+    iss >> command;
+    Game& game = conn->game;
+
+    if (command == "NEW") {
+        default_board(game);
+        conn->out += "OK\n";
+    } else if (command == "MOVES") {
+        std::string reply = "MOVES";
+        if (!game.isOver()) {
+            for (const auto& m : generateLegalMoves(game, game.isWhiteTurn)) {
+                reply += ' ';
+                reply += moveToString(game, m);
+            }
+        }
+        conn->out += reply + "\n";
+    } else if (command == "MOVE") {
+        std::string text;
+        iss >> text;
+        AIMove move;
+        std::string promotion;
+        if (game.isOver()) {
+            conn->out += "ERR game over\n";
+        } else if (!game.isWhiteTurn) {
+            conn->out += "ERR not your turn\n";
+        } else if (!parseMove(text, move, promotion)) {
+            conn->out += "ERR bad move syntax\n";
+        } else {
+            bool legal = false;
+            for (const auto& m : generateLegalMoves(game, game.isWhiteTurn)) {
+                if (m.sr == move.sr && m.sc == move.sc && m.er == move.er && m.ec == move.ec) {
+                    legal = true;
+                    break;
+                }
+            }
+            if (!legal || !applyMove(game, move, promotion)) {
+                conn->out += "ERR illegal move\n";
+            } else if (game.isOver()) {
+                conn->out += "OK - " + resultString(game) + "\n";
+            } else {
+                startEngineTurn(pool, conn);
+            }
+        }
+    } else if (command == "QUIT") {
+        conn->closing = true;
+    } else {
+        conn->out += "ERR unknown command\n";
+    }
+}
+
+// Runs every complete line in the input buffer unless an engine turn is pending
+void processInput(WorkerPool& pool, const std::shared_ptr<Connection>& conn) {
+    std::size_t start = 0;
+    while (!conn->busy && !conn->closing) {
+        std::size_t end = conn->in.find('\n', start);
+        if (end == std::string::npos) break;
+        std::string line = conn->in.substr(start, end - start);
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        start = end + 1;
+        if (!line.empty()) handleCommand(pool, conn, line);
+    }
+    conn->in.erase(0, start);
+    if (conn->in.size() > MAX_LINE) {
+        conn->out += "ERR line too long\n";
+        conn->closing = true;
+    }
+    // Commands still queued behind an engine turn are answered first
+    if (conn->eof && !conn->busy) conn->closing = true;
+}
+
+void readInput(WorkerPool& pool, const std::shared_ptr<Connection>& conn) {
+    char buffer[4096];
+    for (;;) {
+        ssize_t n = recv(conn->fd, buffer, sizeof(buffer), 0);
+        if (n > 0) {
+            conn->in.append(buffer, static_cast<std::size_t>(n));
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        } else if (n == 0) {
+            // A half-close still gets the replies to what was sent before it
+            conn->eof = true;
+            break;
+        } else {
+            closeConnection(conn);
+            return;
+        }
+    }
+    processInput(pool, conn);
+    flushOutput(conn);
+}
+
+void acceptConnections(int listenFd) {
+    for (;;) {
+        int fd = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) perror("accept");
+            return;
+        }
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        auto conn = std::make_shared<Connection>();
+        conn->fd = fd;
+        default_board(conn->game);
+        epoll_event ev{};
+        ev.events = EPOLLIN | EPOLLRDHUP;
+        ev.data.fd = fd;
+        if (epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+            close(fd);
+            continue;
+        }
+        connections[fd] = conn;
+    }
+}
+
+void deliverEngineResults(WorkerPool& pool) {
+    uint64_t count;
+    ssize_t ignored = read(wakeFd, &count, sizeof(count));
+    (void)ignored;
+    std::vector<EngineResult> ready;
+    {
+        std::lock_guard<std::mutex> lock(resultsMutex);
+        ready.swap(results);
+    }
+    for (auto& result : ready) {
+        auto& conn = result.conn;
+        if (conn->closed) continue;
+        conn->busy = false;
+        conn->out += result.reply;
+        processInput(pool, conn);
+        flushOutput(conn);
+    }
+}
+
+int openListener(int port, const std::string& unixPath) {
+    int fd;
+    if (!unixPath.empty()) {
+        fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        if (unixPath.size() >= sizeof(addr.sun_path)) {
+            std::cerr << "Socket path too long\n";
+            return -1;
+        }
+        std::strcpy(addr.sun_path, unixPath.c_str());
+        unlink(unixPath.c_str());
+        if (fd < 0 || bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+            perror("bind");
+            return -1;
+        }
+    } else {
+        fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        int one = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(static_cast<uint16_t>(port));
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (fd < 0 || bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+            perror("bind");
+            return -1;
+        }
+    }
+    if (listen(fd, SOMAXCONN) < 0) {
+        perror("listen");
+        return -1;
+    }
+    return fd;
+}
+
+int main(int argc, char* argv[]) {
+    int port = 7878;
+    std::string unixPath;
+    unsigned workers = std::thread::hardware_concurrency();
+    bool verbose = false;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--port" && i + 1 < argc) {
+            port = std::atoi(argv[++i]);
+        } else if (arg == "--unix" && i + 1 < argc) {
+            unixPath = argv[++i];
+        } else if (arg == "--workers" && i + 1 < argc) {
+            workers = static_cast<unsigned>(std::atoi(argv[++i]));
+        } else if (arg == "--verbose") {
+            verbose = true;
+        } else {
+            std::cerr << "Usage: chess_server [--port N] [--unix PATH] [--workers N] [--verbose]\n";
+            return 1;
+        }
+    }
+    if (workers == 0) workers = 1;
+    // Every move is logged at info level, which thousands of games cannot afford
+    if (verbose) setLogLevel(LogLevel::INFO);
+    std::signal(SIGPIPE, SIG_IGN);
+
+    int listenFd = openListener(port, unixPath);
+    if (listenFd < 0) return 1;
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (epollFd < 0 || wakeFd < 0) {
+        perror("epoll");
+        return 1;
+    }
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.fd = listenFd;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, listenFd, &ev);
+    ev.data.fd = wakeFd;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeFd, &ev);
+
+    WorkerPool pool(workers);
+    if (unixPath.empty()) {
+        std::cerr << "Listening on 127.0.0.1:" << port << " with " << workers << " workers\n";
+    } else {
+        std::cerr << "Listening on " << unixPath << " with " << workers << " workers\n";
+    }
+
+    std::vector<epoll_event> events(1024);
+    for (;;) {
+        int n = epoll_wait(epollFd, events.data(), static_cast<int>(events.size()), -1);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            perror("epoll_wait");
+            break;
+        }
+        for (int i = 0; i < n; ++i) {
+            int fd = events[i].data.fd;
+            if (fd == listenFd) {
+                acceptConnections(listenFd);
+                continue;
+            }
+            if (fd == wakeFd) {
+                deliverEngineResults(pool);
+                continue;
+            }
+            auto it = connections.find(fd);
+            if (it == connections.end()) continue;
+            std::shared_ptr<Connection> conn = it->second;
+            if (events[i].events & (EPOLLHUP | EPOLLERR)) {
+                // Gone both ways: nobody is left to read the replies
+                closeConnection(conn);
+                continue;
+            }
+            if (events[i].events & (EPOLLIN | EPOLLRDHUP)) {
+                readInput(pool, conn);
+            }
+            if (!conn->closed && (events[i].events & EPOLLOUT)) {
+                flushOutput(conn);
+            }
+        }
+    }
+    return 0;
+}
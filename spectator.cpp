@@ -0,0 +1,161 @@
+#include "spectator.h"
+#include <algorithm>
+#include <chrono>
+#include <iterator>
+#include <random>
+
+typedef std::chrono::steady_clock SpectatorClock;
+
+struct SpectatorMatch::Board {
+    uint16_t index = 0;
+    Game game;
+    int8_t shown[BOARD_SIZE * BOARD_SIZE]; // what the viewer has been told
+    std::vector<uint64_t> history;         // keys since the game started, for repetitions
+    int plies = 0;
+    bool over = false;
+    SpectatorClock::time_point due;        // when the next move or restart is played
+};
+
+SpectatorMatch::SpectatorMatch(const SpectatorSettings& wanted) : settings(wanted) {
+    settings.boards = std::max(settings.boards, 1);
+    unsigned threads = settings.threads ? settings.threads : std::thread::hardware_concurrency();
+    threads = std::min<unsigned>(std::max(threads, 1u), static_cast<unsigned>(settings.boards));
+    settings.hashMb = std::max<std::size_t>(settings.hashMb, 1);
+    for (unsigned t = 0; t < threads; ++t) queues.emplace_back(new Queue);
+    for (unsigned t = 0; t < threads; ++t) workers.emplace_back(&SpectatorMatch::run, this, t);
+}
+
+SpectatorMatch::~SpectatorMatch() {
+    stop();
+}
+
+void SpectatorMatch::stop() {
+    quit = true;
+    for (auto& worker : workers) {
+        if (worker.joinable()) worker.join();
+    }
+}
+
+std::size_t SpectatorMatch::drain(std::vector<SquareUpdate>& out) {
+    std::size_t before = out.size();
+    SquareUpdate update;
+    for (auto& queue : queues) {
+        while (queue->pop(update)) out.push_back(update);
+    }
+    return out.size() - before;
+}
+
+void SpectatorMatch::startGame(Board& board) {
+    uint64_t number = started.fetch_add(1);
+    std::mt19937_64 rng(settings.seed * 0x9E3779B97F4A7C15ull + number);
+    default_board(board.game);
+    std::vector<AIMove> moves;
+    for (int ply = 0; ply < settings.randomPlies; ++ply) {
+        generateLegalMoves(board.game, board.game.isWhiteTurn, moves);
+        if (moves.empty()) break;
+        MoveUndo undo;
+        makeMove(board.game, moves[rng() % moves.size()], undo);
+        delete undo.captured;
+    }
+    board.history.clear();
+    board.plies = 0;
+    board.over = false;
+}
+
+static bool onlyKingsLeft(const Game& game) {
+    for (int r = 0; r < BOARD_SIZE; ++r) {
+        for (int c = 0; c < BOARD_SIZE; ++c) {
+            Piece* p = game.board[r][c];
+            if (p && p->type.find("king") == std::string::npos) return false;
+        }
+    }
+    return true;
+}
+
+// Plays the engine's move, or ends the game if it is mate, stalemate or drawn
+void SpectatorMatch::playMove(SearchContext& context, Board& board) {
+    Game& game = board.game;
+    uint64_t key = zobristKey(game);
+    std::size_t since = std::min<std::size_t>(board.history.size(), game.halfmoveClock);
+    int seen = static_cast<int>(std::count(board.history.end() - since, board.history.end(), key));
+    if (seen >= 2 || game.halfmoveClock >= 100 || board.plies >= settings.maxPlies || onlyKingsLeft(game) ||
+        !hasAnyLegalMoves(game, game.isWhiteTurn)) {
+        board.over = true;
+        return;
+    }
+    board.history.push_back(key);
+
+    SearchLimits limits;
+    limits.depth = MAX_PLY - 1;
+    limits.nodes = settings.nodes;
+    limits.abort = [this] { return quit.load(std::memory_order_relaxed); };
+    SearchResult found = searchPosition(context, game, limits);
+    if (!found.bestMove && !quit) {
+        // Out of nodes before the first root move: a one-ply search always finishes
+        limits.depth = 1;
+        limits.nodes = 0;
+        found = searchPosition(context, game, limits);
+    }
+    if (quit) return;
+    std::string promotion;
+    MoveUndo undo;
+    makeMove(game, unpackMove(found.bestMove, promotion), undo, promotion);
+    delete undo.captured;
+    ++board.plies;
+}
+
+// Queues the squares that differ from what the viewer was last told. Waits
+// while the queue is full rather than drop an update; returns false if told
+// to quit meanwhile.
+bool SpectatorMatch::publish(unsigned worker, Board& board) {
+    Queue& queue = *queues[worker];
+    for (int square = 0; square < BOARD_SIZE * BOARD_SIZE; ++square) {
+        const Piece* piece = board.game.board[square / BOARD_SIZE][square % BOARD_SIZE];
+        int8_t now = static_cast<int8_t>(piece ? pieceIndex(piece) : -1);
+        if (now == board.shown[square]) continue;
+        SquareUpdate update = {board.index, static_cast<uint8_t>(square), now};
+        while (!queue.push(update)) {
+            if (quit) return false;
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        board.shown[square] = now;
+    }
+    return true;
+}
+
+// Each worker owns every threads-th board and plays whichever is due next
+void SpectatorMatch::run(unsigned worker) {
+    TranspositionTable tt(settings.hashMb);
+    SearchContext context;
+    context.tt = &tt;
+    std::vector<Board> boards;
+    for (int b = static_cast<int>(worker); b < settings.boards; b += static_cast<int>(queues.size())) {
+        boards.emplace_back();
+        Board& board = boards.back();
+        board.index = static_cast<uint16_t>(b);
+        std::fill(std::begin(board.shown), std::end(board.shown), -1);
+        startGame(board);
+        board.due = SpectatorClock::now() + std::chrono::milliseconds(settings.minMoveMs);
+        if (!publish(worker, board)) return;
+    }
+
+    while (!quit) {
+        auto next = std::min_element(boards.begin(), boards.end(),
+                                     [](const Board& a, const Board& b) { return a.due < b.due; });
+        auto now = SpectatorClock::now();
+        if (next->due > now) {
+            // Short naps, so stop() is not kept waiting
+            std::this_thread::sleep_until(std::min(next->due, now + std::chrono::milliseconds(50)));
+            continue;
+        }
+        if (next->over) {
+            startGame(*next);
+        } else {
+            playMove(context, *next);
+            if (next->over) finished.fetch_add(1, std::memory_order_relaxed);
+        }
+        int delay = next->over ? settings.restartMs : settings.minMoveMs;
+        next->due = SpectatorClock::now() + std::chrono::milliseconds(delay);
+        if (!publish(worker, *next)) return;
+    }
+}
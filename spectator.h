@@ -0,0 +1,96 @@
+#pragma once
+
+#include "search.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+// Engine games played in the background for the GUI's spectator view. Worker
+// threads play every board against itself and publish what changed on it as
+// square updates; the render thread drains them without ever taking a lock,
+// so it keeps its frame rate however many boards are being played.
+
+// Bounded ring for one producer thread and one consumer thread. push and pop
+// never block; push fails while the ring is full and pop while it is empty.
+template <typename T, std::size_t CAPACITY>
+class SpscQueue {
+    static_assert((CAPACITY & (CAPACITY - 1)) == 0, "capacity must be a power of two");
+
+public:
+    bool push(const T& item) {
+        std::size_t tail = tailIndex.load(std::memory_order_relaxed);
+        if (tail - headIndex.load(std::memory_order_acquire) == CAPACITY) return false;
+        items[tail & (CAPACITY - 1)] = item;
+        tailIndex.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T& item) {
+        std::size_t head = headIndex.load(std::memory_order_relaxed);
+        if (head == tailIndex.load(std::memory_order_acquire)) return false;
+        item = items[head & (CAPACITY - 1)];
+        headIndex.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    // Apart, so the two threads do not share a cache line
+    alignas(64) std::atomic<std::size_t> headIndex{0};
+    alignas(64) std::atomic<std::size_t> tailIndex{0};
+    T items[CAPACITY];
+};
+
+// What is now on one square of one board. Squares are row * 8 + col.
+struct SquareUpdate {
+    uint16_t board;
+    uint8_t square;
+    int8_t piece; // pieceIndex(), -1 for empty
+};
+
+struct SpectatorSettings {
+    int boards = 16;
+    unsigned threads = 0;     // 0 for one per core, never more than boards
+    uint64_t nodes = 20000;   // per move
+    int minMoveMs = 250;      // shortest time between two moves on a board
+    int restartMs = 2000;     // a finished game stays up this long
+    int randomPlies = 4;      // random opening moves, for variety
+    int maxPlies = 300;       // longer games are given up as draws
+    std::size_t hashMb = 4;   // per thread
+    uint64_t seed = 1;
+};
+
+class SpectatorMatch {
+public:
+    explicit SpectatorMatch(const SpectatorSettings& settings);
+    SpectatorMatch(const SpectatorMatch&) = delete;
+    SpectatorMatch& operator=(const SpectatorMatch&) = delete;
+    ~SpectatorMatch();
+
+    // Appends every update published since the last call. Only one thread
+    // may drain. After stop() the remaining updates can still be drained.
+    std::size_t drain(std::vector<SquareUpdate>& out);
+    // Ends the games and waits for the workers
+    void stop();
+
+    int boards() const { return settings.boards; }
+    uint64_t gamesFinished() const { return finished.load(std::memory_order_relaxed); }
+
+private:
+    struct Board;
+    typedef SpscQueue<SquareUpdate, 8192> Queue;
+
+    void run(unsigned worker);
+    void startGame(Board& board);
+    void playMove(SearchContext& context, Board& board);
+    bool publish(unsigned worker, Board& board);
+
+    SpectatorSettings settings;
+    std::vector<std::unique_ptr<Queue>> queues; // one per worker
+    std::vector<std::thread> workers;
+    std::atomic<bool> quit{false};
+    std::atomic<uint64_t> started{0};
+    std::atomic<uint64_t> finished{0};
+};
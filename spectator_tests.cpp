@@ -0,0 +1,95 @@
+#include "spectator.h"
+#include <cassert>
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+void testQueueKeepsOrder() {
+    static SpscQueue<int, 64> queue;
+    const int count = 100000;
+    std::thread producer([] {
+        for (int i = 0; i < count; ++i) {
+            while (!queue.push(i)) std::this_thread::yield();
+        }
+    });
+    int expected = 0;
+    int item;
+    while (expected < count) {
+        if (queue.pop(item)) {
+            assert(item == expected);
+            ++expected;
+        }
+    }
+    producer.join();
+    [[maybe_unused]] bool popped = queue.pop(item);
+    assert(!popped);
+}
+
+void testQueueFull() {
+    SpscQueue<int, 4> queue;
+    for (int i = 0; i < 4; ++i) {
+        [[maybe_unused]] bool pushed = queue.push(i);
+        assert(pushed);
+    }
+    [[maybe_unused]] bool pushed = queue.push(4);
+    assert(!pushed);
+    int item;
+    [[maybe_unused]] bool popped = queue.pop(item);
+    assert(popped && item == 0);
+    pushed = queue.push(4);
+    assert(pushed);
+}
+
+// Replaying the updates must give every board a position with one king a side
+void testMatchUpdates() {
+    SpectatorSettings settings;
+    settings.boards = 5;
+    settings.threads = 2;
+    settings.nodes = 300;
+    settings.minMoveMs = 0;
+    settings.restartMs = 0;
+    settings.maxPlies = 16;
+    settings.hashMb = 1;
+    SpectatorMatch match(settings);
+    std::vector<int> boards(settings.boards * 64, -1);
+    std::vector<SquareUpdate> updates;
+    std::size_t applied = 0;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(30);
+    while (match.gamesFinished() < 2 && std::chrono::steady_clock::now() < deadline) {
+        updates.clear();
+        match.drain(updates);
+        for (const SquareUpdate& u : updates) boards[u.board * 64 + u.square] = u.piece;
+        applied += updates.size();
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    assert(match.gamesFinished() >= 2);
+    match.stop();
+    updates.clear();
+    match.drain(updates);
+    for (const SquareUpdate& u : updates) boards[u.board * 64 + u.square] = u.piece;
+    applied += updates.size();
+    assert(applied > static_cast<std::size_t>(settings.boards) * 32);
+
+    for (int b = 0; b < settings.boards; ++b) {
+        int whiteKings = 0;
+        int blackKings = 0;
+        int pieces = 0;
+        for (int sq = 0; sq < 64; ++sq) {
+            int piece = boards[b * 64 + sq];
+            if (piece >= 0) ++pieces;
+            if (piece == 5) ++whiteKings;
+            if (piece == 11) ++blackKings;
+        }
+        assert(whiteKings == 1 && blackKings == 1);
+        assert(pieces >= 2 && pieces <= 32);
+    }
+}
+
+int main() {
+    testQueueKeepsOrder();
+    testQueueFull();
+    testMatchUpdates();
+    std::cout << "All spectator tests passed\n";
+    return 0;
+}
@@ -0,0 +1,75 @@
+#include "stats.h"
+#include <algorithm>
+#include <cstdio>
+
+static StatSlot statSlots[MAX_STAT_THREADS];
+static std::atomic<int> nextStatSlot{0};
+
+StatSlot* claimStatSlot() {
+    int index = nextStatSlot.fetch_add(1, std::memory_order_relaxed);
+    return &statSlots[index < MAX_STAT_THREADS ? index : MAX_STAT_THREADS - 1];
+}
+
+const char* statName(StatId id) {
+    static const char* const NAMES[STAT_ID_COUNT] = {
+        "move_gen", "attack_check", "evaluate", "search", "search_node",
+        "quiescence_node", "tt_probe", "tt_hit", "tt_store", "render",
+    };
+    return NAMES[id];
+}
+
+StatTotals statTotals() {
+    StatTotals totals;
+    int used = std::min(nextStatSlot.load(std::memory_order_relaxed), MAX_STAT_THREADS);
+    for (int i = 0; i < used; ++i) {
+        for (int id = 0; id < STAT_ID_COUNT; ++id) {
+            totals.count[id] += statSlots[i].count[id].load(std::memory_order_relaxed);
+            totals.nanoseconds[id] += statSlots[i].nanoseconds[id].load(std::memory_order_relaxed);
+        }
+    }
+    return totals;
+}
+
+std::string statsJsonLine(const StatTotals& totals, int64_t elapsedMs) {
+    std::string line = "{\"elapsed_ms\":" + std::to_string(elapsedMs);
+    for (int id = 0; id < STAT_ID_COUNT; ++id) {
+        line += ",\"" + std::string(statName(static_cast<StatId>(id))) + "\":{\"count\":" +
+                std::to_string(totals.count[id]);
+        if (totals.nanoseconds[id]) line += ",\"ns\":" + std::to_string(totals.nanoseconds[id]);
+        line += "}";
+    }
+    return line + "}";
+}
+
+StatsDump::StatsDump(const std::string& path, int intervalMs)
+    : file(std::fopen(path.c_str(), "w")), intervalMs(intervalMs > 0 ? intervalMs : 1000),
+      started(std::chrono::steady_clock::now()) {
+    if (file) worker = std::thread(&StatsDump::run, this);
+}
+
+StatsDump::~StatsDump() {
+    if (!file) return;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        quit = true;
+    }
+    wake.notify_all();
+    worker.join();
+    writeLine();
+    std::fclose(file);
+}
+
+void StatsDump::run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!wake.wait_for(lock, std::chrono::milliseconds(intervalMs), [this] { return quit; })) {
+        writeLine();
+    }
+}
+
+void StatsDump::writeLine() {
+    using namespace std::chrono;
+    int64_t elapsed = duration_cast<milliseconds>(steady_clock::now() - started).count();
+    std::string line = statsJsonLine(statTotals(), elapsed);
+    std::fprintf(file, "%s\n", line.c_str());
+    std::fflush(file);
+}
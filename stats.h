@@ -0,0 +1,120 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// Counters and timers for the hot paths. Each thread adds to a slot of its
+// own, padded to a cache line, so counting takes no locked instruction and
+// no line bounces between cores; readers add the slots up. CHESS_COUNT and
+// CHESS_TIME compile to nothing unless CHESS_STATS is defined
+// (cmake -DCHESS_STATS=ON).
+
+enum StatId {
+    STAT_MOVE_GEN,       // generateLegalMoves
+    STAT_ATTACK_CHECK,   // isSquareAttacked
+    STAT_EVALUATE,       // static evaluation in the search
+    STAT_SEARCH,         // searchPosition
+    STAT_SEARCH_NODE,    // alpha-beta nodes
+    STAT_QUIESCENCE_NODE,
+    STAT_TT_PROBE,
+    STAT_TT_HIT,
+    STAT_TT_STORE,
+    STAT_RENDER,         // one GUI frame
+    STAT_ID_COUNT
+};
+
+const int MAX_STAT_THREADS = 64;
+
+struct alignas(64) StatSlot {
+    std::atomic<uint64_t> count[STAT_ID_COUNT];
+    std::atomic<uint64_t> nanoseconds[STAT_ID_COUNT];
+};
+
+struct StatTotals {
+    uint64_t count[STAT_ID_COUNT] = {};
+    uint64_t nanoseconds[STAT_ID_COUNT] = {}; // 0 for stats that are only counted
+};
+
+// Hands out the next free slot. Threads beyond MAX_STAT_THREADS share the
+// last one and may lose counts.
+StatSlot* claimStatSlot();
+
+inline StatSlot& threadStatSlot() {
+    thread_local StatSlot* slot = claimStatSlot();
+    return *slot;
+}
+
+// Only the owning thread writes a slot, so a relaxed load and store is enough
+inline void statAdd(std::atomic<uint64_t>& cell, uint64_t amount) {
+    cell.store(cell.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+}
+
+inline void statCount(StatId id) {
+    statAdd(threadStatSlot().count[id], 1);
+}
+
+// Counts once and adds its lifetime to the stat
+class StatTimer {
+public:
+    explicit StatTimer(StatId id) : id(id), start(std::chrono::steady_clock::now()) {}
+    ~StatTimer() {
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+        StatSlot& slot = threadStatSlot();
+        statAdd(slot.count[id], 1);
+        statAdd(slot.nanoseconds[id], static_cast<uint64_t>(ns.count()));
+    }
+    StatTimer(const StatTimer&) = delete;
+    StatTimer& operator=(const StatTimer&) = delete;
+
+private:
+    StatId id;
+    std::chrono::steady_clock::time_point start;
+};
+
+const char* statName(StatId id);
+StatTotals statTotals();
+// One JSON object on one line, without the newline:
+// {"elapsed_ms":1000,"move_gen":{"count":12,"ns":3456},"tt_hit":{"count":7},...}
+std::string statsJsonLine(const StatTotals& totals, int64_t elapsedMs);
+
+// Appends statsJsonLine() to a file every interval from a thread of its own,
+// and once more when destroyed. The totals are cumulative since startup.
+class StatsDump {
+public:
+    StatsDump(const std::string& path, int intervalMs = 1000);
+    StatsDump(const StatsDump&) = delete;
+    StatsDump& operator=(const StatsDump&) = delete;
+    ~StatsDump();
+    bool ok() const { return file != nullptr; }
+
+private:
+    void run();
+    void writeLine();
+
+    std::FILE* file = nullptr;
+    int intervalMs;
+    std::chrono::steady_clock::time_point started;
+    std::thread worker;
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool quit = false;
+};
+
+#define CHESS_STAT_CONCAT2(a, b) a##b
+#define CHESS_STAT_CONCAT(a, b) CHESS_STAT_CONCAT2(a, b)
+
+#ifdef CHESS_STATS
+const bool STATS_ENABLED = true;
+#define CHESS_COUNT(id) statCount(id)
+#define CHESS_TIME(id) StatTimer CHESS_STAT_CONCAT(chessStatTimer, __LINE__)(id)
+#else
+const bool STATS_ENABLED = false;
+#define CHESS_COUNT(id) ((void)0)
+#define CHESS_TIME(id) ((void)0)
+#endif
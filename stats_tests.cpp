@@ -0,0 +1,145 @@
+#include "search.h"
+#include "log.h"
+#include "stats.h"
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+static_assert(alignof(StatSlot) == 64 && sizeof(StatSlot) % 64 == 0, "slots must not share cache lines");
+
+void testThreadsAddUp() {
+    [[maybe_unused]] uint64_t before = statTotals().count[STAT_TT_HIT];
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([] {
+            for (int i = 0; i < 100000; ++i) CHESS_COUNT(STAT_TT_HIT);
+        });
+    }
+    for (auto& thread : threads) thread.join();
+    assert(statTotals().count[STAT_TT_HIT] - before == 400000);
+}
+
+void testTimer() {
+    [[maybe_unused]] StatTotals before = statTotals();
+    {
+        CHESS_TIME(STAT_RENDER);
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+    [[maybe_unused]] StatTotals after = statTotals();
+    assert(after.count[STAT_RENDER] - before.count[STAT_RENDER] == 1);
+    assert(after.nanoseconds[STAT_RENDER] - before.nanoseconds[STAT_RENDER] >= 2000000);
+}
+
+void testSearchIsCounted() {
+    StatTotals before = statTotals();
+    Game game;
+    default_board(game);
+    TranspositionTable tt(1);
+    SearchContext context;
+    context.tt = &tt;
+    SearchLimits limits;
+    limits.depth = 3;
+    SearchResult result = searchPosition(context, game, limits);
+    StatTotals after = statTotals();
+    // Nothing is counted unless the library was built with CHESS_STATS too
+    uint64_t searches = after.count[STAT_SEARCH] - before.count[STAT_SEARCH];
+    [[maybe_unused]] uint64_t nodes = after.count[STAT_SEARCH_NODE] - before.count[STAT_SEARCH_NODE] +
+                     after.count[STAT_QUIESCENCE_NODE] - before.count[STAT_QUIESCENCE_NODE];
+    assert(searches == 0 || searches == 1);
+    if (searches) {
+        assert(nodes == result.nodes);
+        assert(after.count[STAT_MOVE_GEN] > before.count[STAT_MOVE_GEN]);
+        assert(after.count[STAT_TT_PROBE] > before.count[STAT_TT_PROBE]);
+        assert(after.nanoseconds[STAT_EVALUATE] > before.nanoseconds[STAT_EVALUATE]);
+    } else {
+        assert(nodes == 0);
+    }
+}
+
+void testJsonLine() {
+    StatTotals totals;
+    totals.count[STAT_MOVE_GEN] = 12;
+    totals.nanoseconds[STAT_MOVE_GEN] = 3456;
+    totals.count[STAT_TT_HIT] = 7;
+    std::string line = statsJsonLine(totals, 1000);
+    assert(line.find('\n') == std::string::npos);
+    assert(line.find("{\"elapsed_ms\":1000,\"move_gen\":{\"count\":12,\"ns\":3456}") == 0);
+    assert(line.find("\"tt_hit\":{\"count\":7}") != std::string::npos);
+    const std::string end = "\"render\":{\"count\":0}}";
+    assert(line.compare(line.size() - end.size(), end.size(), end) == 0);
+}
+
+void testDump() {
+    const char* path = "stats_tests.jsonl";
+    {
+        StatsDump dump(path, 10);
+        assert(dump.ok());
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+    std::ifstream file(path);
+    std::string line;
+    int lines = 0;
+    while (std::getline(file, line)) {
+        assert(line.compare(0, 14, "{\"elapsed_ms\":") == 0 && line.back() == '}');
+        ++lines;
+    }
+    assert(lines >= 2);
+    std::remove(path);
+    assert(!StatsDump("no-such-directory/stats.jsonl").ok());
+}
+
+static int formatted = 0;
+
+static int countFormat() {
+    return ++formatted;
+}
+
+void testLogger() {
+    std::ostringstream out;
+    setLogStream(&out);
+    LogLevel level;
+    [[maybe_unused]] bool ok = parseLogLevel("debug", level);
+    assert(ok && level == LogLevel::DEBUG);
+    ok = parseLogLevel("loud", level);
+    assert(!ok);
+
+    setLogLevel(LogLevel::WARN);
+    LOG_INFO("not shown " << countFormat());
+    assert(formatted == 0 && out.str().empty());
+    LOG_WARN("shown " << countFormat());
+    assert(formatted == 1 && out.str() == "warning: shown 1\n");
+
+    // The move path only logs at info level and above
+    out.str("");
+    Game game;
+    default_board(game);
+    AIMove move;
+    std::string promotion;
+    ok = parseMove("e2e4", move, promotion) && applyMove(game, move, promotion);
+    assert(ok);
+    assert(out.str().empty());
+    setLogLevel(LogLevel::INFO);
+    ok = parseMove("e7e5", move, promotion) && applyMove(game, move, promotion);
+    assert(ok);
+    assert(out.str() == "Moved piece: black-pawn to (4, 3)\n");
+
+    setLogLevel(LogLevel::WARN);
+    setLogStream(nullptr);
+}
+
+int main() {
+    testThreadsAddUp();
+    testTimer();
+    testSearchIsCounted();
+    testJsonLine();
+    testDump();
+    testLogger();
+    std::cout << "All stats tests passed\n";
+    return 0;
+}
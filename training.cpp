@@ -0,0 +1,61 @@
+#include "training.h"
+#include "mapped_file.h"
+#include <cstring>
+
+static const char* const PIECE_TYPES[] = {"white-pawn", "white-knight", "white-bishop", "white-rook",
+                                          "white-queen", "white-king", "black-pawn", "black-knight",
+                                          "black-bishop", "black-rook", "black-queen", "black-king"};
+
+PackedPosition packPosition(const Game& game, int whiteScore, int result) {
+    PackedPosition packed{};
+    int count = 0;
+    for (int square = 0; square < 64; ++square) {
+        Piece* p = game.board[square / 8][square % 8];
+        if (!p || count == 32) continue;
+        packed.occupancy |= 1ull << square;
+        packed.pieces[count / 2] |= static_cast<uint8_t>(pieceIndex(p) << (count % 2 * 4));
+        ++count;
+    }
+    packed.score = static_cast<int16_t>(whiteScore < -32767 ? -32767 : whiteScore > 32767 ? 32767 : whiteScore);
+    packed.result = static_cast<int8_t>(result);
+    packed.blackToMove = !game.isWhiteTurn;
+    packed.castlingRights = static_cast<uint8_t>(game.castlingRights);
+    packed.enPassant = isInsideBoard(game.enPassant.row, game.enPassant.col)
+                           ? static_cast<uint8_t>(game.enPassant.row * 8 + game.enPassant.col)
+                           : 64;
+    packed.fullmoveNumber = static_cast<uint16_t>(game.fullmoveNumber);
+    return packed;
+}
+
+void unpackPosition(const PackedPosition& packed, Game& game) {
+    clearBoard(game);
+    clearSelection(game);
+    int count = 0;
+    for (int square = 0; square < 64; ++square) {
+        if (!(packed.occupancy >> square & 1)) continue;
+        int index = packed.pieces[count / 2] >> (count % 2 * 4) & 15;
+        ++count;
+        if (index < 12) game.board[square / 8][square % 8] = createPiece(PIECE_TYPES[index]);
+    }
+    game.isWhiteTurn = !packed.blackToMove;
+    game.castlingRights = packed.castlingRights & CASTLE_ALL;
+    game.enPassant = packed.enPassant < 64 ? Square{packed.enPassant / 8, packed.enPassant % 8} : Square{-1, -1};
+    game.halfmoveClock = 0;
+    game.fullmoveNumber = packed.fullmoveNumber;
+    game.status = GameStatus::IN_PROGRESS;
+    game.gameOverMessage.clear();
+}
+
+bool readPackedPositions(const std::string& path, std::vector<PackedPosition>& positions, std::string& error) {
+    MappedFile file;
+    if (!file.open(path, error)) return false;
+    if (file.size() % sizeof(PackedPosition) != 0) {
+        error = path + ": not a whole number of position records";
+        return false;
+    }
+    std::size_t count = file.size() / sizeof(PackedPosition);
+    std::size_t first = positions.size();
+    positions.resize(first + count);
+    if (count > 0) std::memcpy(&positions[first], file.data(), file.size());
+    return true;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "game.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Labelled positions for tuning the evaluation, stored as fixed-size records
+// in native (little-endian) byte order. A file is nothing but records, so it
+// can be split, concatenated or mapped without a header.
+
+struct PackedPosition {
+    uint64_t occupancy;     // bit row * 8 + col set for every occupied square
+    uint8_t pieces[16];     // pieceIndex() of each occupied square in bit order, two per byte, low nibble first
+    int16_t score;          // search score in centipawns, from white's point of view
+    int8_t result;          // 1 white won, 0 draw, -1 black won
+    uint8_t blackToMove;
+    uint8_t castlingRights;
+    uint8_t enPassant;      // row * 8 + col, or 64 for none
+    uint16_t fullmoveNumber;
+};
+
+static_assert(sizeof(PackedPosition) == 32, "packed position layout");
+
+PackedPosition packPosition(const Game& game, int whiteScore, int result);
+// Rebuilds the position; the move counters other than fullmoveNumber are lost
+void unpackPosition(const PackedPosition& packed, Game& game);
+// Appends every record in the file to positions
+bool readPackedPositions(const std::string& path, std::vector<PackedPosition>& positions, std::string& error);
+
+// The evaluation as the tuner sees it (evaluateMaterial): a sum of
+// parameters, PIECE_VALUES followed by the flattened PIECE_SQUARE_TABLES
+const int EVAL_PARAM_COUNT = 6 + 6 * 64;
+
+// Calls term(param, sign) for every term of the white-side evaluation of the
+// position; sign is +1 for white pieces and -1 for black ones
+template <typename Term>
+void forEachEvalTerm(const PackedPosition& position, Term term) {
+    uint64_t occupied = position.occupancy;
+    for (int count = 0; occupied; ++count, occupied &= occupied - 1) {
+        int square = __builtin_ctzll(occupied);
+        int index = position.pieces[count / 2] >> (count % 2 * 4) & 15;
+        int kind = index % 6;
+        int sign = index < 6 ? 1 : -1;
+        int row = index < 6 ? square / 8 : 7 - square / 8;
+        term(kind, sign);
+        term(6 + kind * 64 + row * 8 + square % 8, sign);
+    }
+}
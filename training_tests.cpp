@@ -0,0 +1,87 @@
+#include "eval_params.h"
+#include "search.h"
+#include "training.h"
+#include <cassert>
+#include <cstdio>
+#include <iostream>
+#include <string>
+
+void testPackRoundTrip() {
+    Game game;
+    std::string error;
+    const std::string fen = "r3k2r/pp3ppp/2n5/3pP3/8/8/PPP2PPP/R3K2R w Kq d6 0 17";
+    [[maybe_unused]] bool ok = loadFen(game, fen, error);
+    assert(ok);
+    PackedPosition packed = packPosition(game, -45, -1);
+    assert(__builtin_popcountll(packed.occupancy) == 20);
+    assert(packed.score == -45 && packed.result == -1);
+
+    Game unpacked;
+    unpackPosition(packed, unpacked);
+    assert(toFen(unpacked) == "r3k2r/pp3ppp/2n5/3pP3/8/8/PPP2PPP/R3K2R w Kq d6 0 17");
+    assert(zobristKey(unpacked) == zobristKey(game));
+}
+
+void testFullBoard() {
+    Game game;
+    default_board(game);
+    PackedPosition packed = packPosition(game, 100000, 1);
+    assert(packed.score == 32767); // clamped
+    Game unpacked;
+    unpackPosition(packed, unpacked);
+    assert(zobristKey(unpacked) == zobristKey(game));
+}
+
+void testReadFile() {
+    Game game;
+    default_board(game);
+    PackedPosition records[3] = {packPosition(game, 0, 0), packPosition(game, 10, 1), packPosition(game, 20, -1)};
+    const char* path = "training_tests.bin";
+    FILE* f = fopen(path, "wb");
+    assert(f);
+    fwrite(records, sizeof(PackedPosition), 3, f);
+    fclose(f);
+
+    std::vector<PackedPosition> positions;
+    std::string error;
+    [[maybe_unused]] bool ok = readPackedPositions(path, positions, error);
+    assert(ok && positions.size() == 3);
+    assert(positions[2].score == 20 && positions[2].result == -1);
+
+    // A partial record means the file is not a position file
+    f = fopen(path, "ab");
+    fputc(0, f);
+    fclose(f);
+    ok = readPackedPositions(path, positions, error);
+    assert(!ok);
+    std::remove(path);
+}
+
+void testTunerTermsMatchEvaluate() {
+    // The tuner's view of the evaluation must be the tuned part of the one
+    // the search uses
+    const char* fens[] = {"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+                          "r1bq1rk1/pp2bppp/2n1pn2/3p4/2PP4/2N1PN2/PP3PPP/R2QKB1R b KQ - 3 8",
+                          "8/5k2/3p4/1p1Pp2p/pP2Pp1P/P4P1K/8/8 w - - 0 60"};
+    for (const char* fen : fens) {
+        Game game;
+        std::string error;
+        [[maybe_unused]] bool ok = loadFen(game, fen, error);
+        assert(ok);
+        PackedPosition packed = packPosition(game, 0, 0);
+        int whiteEval = 0;
+        forEachEvalTerm(packed, [&](int param, int sign) {
+            whiteEval += sign * (param < 6 ? PIECE_VALUES[param] : PIECE_SQUARE_TABLES[(param - 6) / 64][(param - 6) % 64]);
+        });
+        assert(whiteEval == (game.isWhiteTurn ? evaluateMaterial(game) : -evaluateMaterial(game)));
+    }
+}
+
+int main() {
+    testPackRoundTrip();
+    testFullBoard();
+    testReadFile();
+    testTunerTermsMatchEvaluate();
+    std::cout << "All training tests passed\n";
+    return 0;
+}
@@ -0,0 +1,258 @@
+// Texel tuning of the evaluation parameters against labelled positions from
+// chess_selfplay. The positions stay in memory as their 32-byte records. Each
+// epoch every thread sweeps its share of them. For each position it computes
+// the linear evaluation, the logistic (cross-entropy) loss against the game
+// result, and the gradient plus a diagonal Gauss-Newton curvature into its
+// own dense arrays. The arrays are then summed and the parameters take one
+// Adam or Gauss-Newton step. The result is written as a replacement for
+// eval_params.h, to eval_params.tuned.h unless --output says otherwise, so a
+// run from the source tree never overwrites the checked-in header.
+//
+// The predicted score of a position is 1 / (1 + 10^(-K * eval / 400)). K is
+// fitted to the starting parameters unless given. With --lambda below 1 the
+// target blends the result with the recorded search score.
+//
+// Usage: chess_tune [--threads N] [--epochs N] [--optimizer adam|newton] [--lr X] [--k X]
+//                   [--lambda X] [--output FILE] positions.bin...
+#include "eval_params.h"
+#include "training.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct Totals {
+    double loss = 0;
+    std::vector<double> gradient;
+    std::vector<double> curvature;
+};
+
+struct Tuner {
+    std::vector<PackedPosition> positions;
+    std::vector<float> targets;
+    std::vector<double> params;
+    unsigned threadCount = 1;
+};
+
+static double whiteEval(const PackedPosition& position, const double* params) {
+    double eval = 0;
+    forEachEvalTerm(position, [&](int param, int sign) { eval += sign * params[param]; });
+    return eval;
+}
+
+// Mean loss over all positions and, with withGradient, its gradient and
+// diagonal curvature with respect to every parameter
+static Totals evaluateLoss(const Tuner& tuner, double k, bool withGradient) {
+    // Slope of the sigmoid in the exponent: 10^(-k*e/400) = e^(-scale*e)
+    const double scale = k * std::log(10.0) / 400.0;
+    std::vector<Totals> partial(tuner.threadCount);
+    std::vector<std::thread> workers;
+    std::size_t count = tuner.positions.size();
+    for (unsigned t = 0; t < tuner.threadCount; ++t) {
+        workers.emplace_back([&, t] {
+            Totals& mine = partial[t];
+            if (withGradient) {
+                mine.gradient.assign(EVAL_PARAM_COUNT, 0.0);
+                mine.curvature.assign(EVAL_PARAM_COUNT, 0.0);
+            }
+            const double* params = tuner.params.data();
+            std::size_t begin = count * t / tuner.threadCount;
+            std::size_t end = count * (t + 1) / tuner.threadCount;
+            for (std::size_t i = begin; i < end; ++i) {
+                const PackedPosition& position = tuner.positions[i];
+                double predicted = 1.0 / (1.0 + std::exp(-scale * whiteEval(position, params)));
+                double target = tuner.targets[i];
+                double p = std::min(std::max(predicted, 1e-12), 1.0 - 1e-12);
+                mine.loss -= target * std::log(p) + (1.0 - target) * std::log(1.0 - p);
+                if (!withGradient) continue;
+                double slope = (predicted - target) * scale;
+                double bend = predicted * (1.0 - predicted) * scale * scale;
+                forEachEvalTerm(position, [&](int param, int sign) {
+                    mine.gradient[param] += sign * slope;
+                    mine.curvature[param] += bend;
+                });
+            }
+        });
+    }
+    for (auto& w : workers) w.join();
+
+    Totals total;
+    total.gradient.assign(EVAL_PARAM_COUNT, 0.0);
+    total.curvature.assign(EVAL_PARAM_COUNT, 0.0);
+    double n = count > 0 ? static_cast<double>(count) : 1.0;
+    for (const Totals& part : partial) {
+        total.loss += part.loss / n;
+        if (!withGradient) continue;
+        for (int i = 0; i < EVAL_PARAM_COUNT; ++i) {
+            total.gradient[i] += part.gradient[i] / n;
+            total.curvature[i] += part.curvature[i] / n;
+        }
+    }
+    return total;
+}
+
+// Golden section search for the K that best fits the current parameters
+static double fitK(const Tuner& tuner) {
+    const double ratio = (std::sqrt(5.0) - 1.0) / 2.0;
+    double lo = 0.05;
+    double hi = 3.0;
+    for (int i = 0; i < 30; ++i) {
+        double a = hi - ratio * (hi - lo);
+        double b = lo + ratio * (hi - lo);
+        if (evaluateLoss(tuner, a, false).loss < evaluateLoss(tuner, b, false).loss) hi = b;
+        else lo = a;
+    }
+    return (lo + hi) / 2.0;
+}
+
+static bool writeHeader(const std::string& path, const std::vector<double>& params, std::size_t positions,
+                        double loss, double k) {
+    FILE* out = fopen(path.c_str(), "w");
+    if (!out) return false;
+    std::fprintf(out, "// Evaluation parameters, written by chess_tune. Regenerate instead of editing.\n");
+    std::fprintf(out, "// Source: %zu positions, loss %.6f, K %.3f\n", positions, loss, k);
+    std::fprintf(out, "#pragma once\n\n");
+    std::fprintf(out, "// Centipawns for pawn, knight, bishop, rook, queen and king\n");
+    std::fprintf(out, "const int PIECE_VALUES[6] = {");
+    for (int i = 0; i < 6; ++i) std::fprintf(out, "%s%ld", i ? ", " : "", std::lround(params[i]));
+    std::fprintf(out, "};\n\n");
+    std::fprintf(out, "// Bonus by square for a white piece, index row * 8 + col with row 0 on rank 8.\n");
+    std::fprintf(out, "// Black pieces read the table with the row mirrored.\n");
+    std::fprintf(out, "const int PIECE_SQUARE_TABLES[6][64] = {\n");
+    for (int kind = 0; kind < 6; ++kind) {
+        std::fprintf(out, "    {\n");
+        for (int row = 0; row < 8; ++row) {
+            std::fprintf(out, "       ");
+            for (int col = 0; col < 8; ++col) {
+                std::fprintf(out, " %4ld,", std::lround(params[6 + kind * 64 + row * 8 + col]));
+            }
+            std::fprintf(out, "\n");
+        }
+        std::fprintf(out, "    },\n");
+    }
+    std::fprintf(out, "};\n");
+    return fclose(out) == 0;
+}
+
+static void usage() {
+    std::cerr << "Usage: chess_tune [--threads N] [--epochs N] [--optimizer adam|newton] [--lr X] [--k X]\n"
+                 "                  [--lambda X] [--output FILE] positions.bin...\n";
+}
+
+int main(int argc, char* argv[]) {
+    Tuner tuner;
+    tuner.threadCount = std::thread::hardware_concurrency();
+    int epochs = 300;
+    std::string optimizer = "adam";
+    double learningRate = 2.0;
+    double k = 0;
+    double lambda = 1.0;
+    std::string outputPath = "eval_params.tuned.h";
+    std::vector<std::string> files;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--threads" && i + 1 < argc) {
+            tuner.threadCount = static_cast<unsigned>(std::atoi(argv[++i]));
+        } else if (arg == "--epochs" && i + 1 < argc) {
+            epochs = std::atoi(argv[++i]);
+        } else if (arg == "--optimizer" && i + 1 < argc) {
+            optimizer = argv[++i];
+        } else if (arg == "--lr" && i + 1 < argc) {
+            learningRate = std::atof(argv[++i]);
+        } else if (arg == "--k" && i + 1 < argc) {
+            k = std::atof(argv[++i]);
+        } else if (arg == "--lambda" && i + 1 < argc) {
+            lambda = std::atof(argv[++i]);
+        } else if (arg == "--output" && i + 1 < argc) {
+            outputPath = argv[++i];
+        } else if (!arg.empty() && arg[0] == '-') {
+            usage();
+            return 1;
+        } else {
+            files.push_back(arg);
+        }
+    }
+    if (files.empty() || (optimizer != "adam" && optimizer != "newton")) {
+        usage();
+        return 1;
+    }
+    if (tuner.threadCount == 0) tuner.threadCount = 1;
+
+    auto start = std::chrono::steady_clock::now();
+    for (const auto& path : files) {
+        std::string error;
+        if (!readPackedPositions(path, tuner.positions, error)) {
+            std::cerr << error << "\n";
+            return 1;
+        }
+    }
+    if (tuner.positions.empty()) {
+        std::cerr << "no positions to tune on\n";
+        return 1;
+    }
+    tuner.params.assign(EVAL_PARAM_COUNT, 0.0);
+    for (int i = 0; i < 6; ++i) tuner.params[i] = PIECE_VALUES[i];
+    for (int i = 0; i < 6 * 64; ++i) tuner.params[6 + i] = PIECE_SQUARE_TABLES[i / 64][i % 64];
+    std::printf("%zu positions loaded in %.2f s\n", tuner.positions.size(),
+                std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+
+    // Targets need K when they include the search score, so fit it on the
+    // results first
+    tuner.targets.resize(tuner.positions.size());
+    for (std::size_t i = 0; i < tuner.positions.size(); ++i) tuner.targets[i] = (tuner.positions[i].result + 1) / 2.0f;
+    if (k <= 0) k = fitK(tuner);
+    if (lambda < 1.0) {
+        for (std::size_t i = 0; i < tuner.positions.size(); ++i) {
+            double fromScore = 1.0 / (1.0 + std::pow(10.0, -k * tuner.positions[i].score / 400.0));
+            tuner.targets[i] = static_cast<float>(lambda * tuner.targets[i] + (1.0 - lambda) * fromScore);
+        }
+    }
+    std::printf("K %.3f, starting loss %.6f\n", k, evaluateLoss(tuner, k, false).loss);
+
+    // The king is always on the board for both sides, so its value cancels out
+    std::vector<bool> frozen(EVAL_PARAM_COUNT, false);
+    frozen[5] = true;
+    std::vector<double> m(EVAL_PARAM_COUNT, 0.0);
+    std::vector<double> v(EVAL_PARAM_COUNT, 0.0);
+    const double beta1 = 0.9;
+    const double beta2 = 0.999;
+    start = std::chrono::steady_clock::now();
+    double loss = 0;
+    for (int epoch = 1; epoch <= epochs; ++epoch) {
+        Totals totals = evaluateLoss(tuner, k, true);
+        loss = totals.loss;
+        for (int i = 0; i < EVAL_PARAM_COUNT; ++i) {
+            if (frozen[i] || totals.curvature[i] == 0) continue;
+            double g = totals.gradient[i];
+            if (optimizer == "adam") {
+                m[i] = beta1 * m[i] + (1 - beta1) * g;
+                v[i] = beta2 * v[i] + (1 - beta2) * g * g;
+                double mHat = m[i] / (1 - std::pow(beta1, epoch));
+                double vHat = v[i] / (1 - std::pow(beta2, epoch));
+                tuner.params[i] -= learningRate * mHat / (std::sqrt(vHat) + 1e-12);
+            } else {
+                // Damped so rarely seen terms do not jump
+                tuner.params[i] -= std::max(-50.0, std::min(50.0, g / (totals.curvature[i] + 1e-7)));
+            }
+        }
+        if (epoch == 1 || epoch % 25 == 0 || epoch == epochs) {
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            std::printf("epoch %d loss %.6f (%.3f s/epoch)\n", epoch, loss, seconds / epoch);
+            std::fflush(stdout);
+        }
+    }
+    loss = evaluateLoss(tuner, k, false).loss;
+    if (!writeHeader(outputPath, tuner.params, tuner.positions.size(), loss, k)) {
+        std::cerr << outputPath << ": " << std::strerror(errno) << "\n";
+        return 1;
+    }
+    std::printf("final loss %.6f, parameters written to %s\n", loss, outputPath.c_str());
+    return 0;
+}